@@ -1,12 +1,14 @@
 #include "pwm.h"
 #include "dac.h"
 #include "lambda_conversion.h"
+#include "lambda_filter.h"
 #include "port.h"
 #include "io_pins.h"
 
 #include "wideband_config.h"
 
 #include "max3185x.h"
+#include "thread_monitor.h"
 
 #include "hal.h"
 
@@ -121,18 +123,29 @@ void SetAuxDac(int channel, float voltage)
 
 #if (defined(AUXOUT_DAC_PWM_DEVICE) || defined(AUXOUT_DAC_DEVICE))
 
+#define AUXOUT_PERIOD_MS 10
+
+static_assert(1000 / AUXOUT_PERIOD_MS == LAMBDA_FILTER_RATE_HZ, "lambda filters assume 100 Hz aux updates");
+// Per sensor, both outputs showing the same sensor show the same value
+static LambdaFilter lambdaFilter[AFR_CHANNELS];
+
+static float AuxGetLambda(int ch)
+{
+    return ch < AFR_CHANNELS ? lambdaFilter[ch].Get() : 0;
+}
+
 static float AuxGetInputSignal(AuxOutputMode sel)
 {
     switch (sel)
     {
         case AuxOutputMode::Afr0:
-            return 14.7f * GetLambda(0);
+            return 14.7f * AuxGetLambda(0);
         case AuxOutputMode::Afr1:
-            return 14.7f * GetLambda(1);
+            return 14.7f * AuxGetLambda(1);
         case AuxOutputMode::Lambda0:
-            return GetLambda(0);
+            return AuxGetLambda(0);
         case AuxOutputMode::Lambda1:
-            return GetLambda(1);
+            return AuxGetLambda(1);
 #if HAL_USE_SPI
         case AuxOutputMode::Egt0:
             return getEgtDrivers()[0].temperature;
@@ -154,8 +167,18 @@ void AuxOutThread(void*)
 
     chRegSetThreadName("Aux out");
 
+    ThreadDeadlineInit(ThreadId::AuxOut, AUXOUT_PERIOD_MS);
+
     while(1)
     {
+        ThreadLoopBegin(ThreadId::AuxOut);
+
+        for (int ch = 0; ch < AFR_CHANNELS; ch++)
+        {
+            lambdaFilter[ch].Configure(cfg->lambdaFilter[static_cast<int>(LambdaOutput::AuxOut)]);
+            lambdaFilter[ch].Update(GetLambda(ch));
+        }
+
         for (int ch = 0; ch < AFR_CHANNELS; ch++)
         {
             float input = AuxGetInputSignal(cfg->auxOutputSource[ch]);
@@ -164,7 +187,9 @@ void AuxOutThread(void*)
             SetAuxDac(ch, voltage);
         }
 
-        chThdSleepMilliseconds(10);
+        ThreadLoopEnd(ThreadId::AuxOut);
+
+        chThdSleepMilliseconds(AUXOUT_PERIOD_MS);
     }
 }
 
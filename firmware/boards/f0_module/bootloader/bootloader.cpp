@@ -6,8 +6,9 @@
 #include "io_pins.h"
 #include "../../for_rusefi/wideband_can.h"
 
+#include "app_image.h"
+
 #include <cstring>
-#include <rusefi/crc.h>
 
 // These are defined in the linker script
 extern uint32_t __appflash_start__[64];
@@ -15,18 +16,62 @@ extern uint32_t __appflash_size__;
 extern uint32_t __ram_vectors_start__[64];
 extern uint32_t __ram_vectors_size__;
 
-#define SWAP_UINT32(x) ((((x) >> 24) & 0xff) | (((x) << 8) & 0xff0000) | (((x) >> 8) & 0xff00) | (((x) << 24) & 0xff000000))
+// Size of app flash region, image is padded to fill all of it
+static const size_t appSize = reinterpret_cast<size_t>(&__appflash_size__);
+
+// Survives a warm reset: skip the CRC check if this image was checked before
+static AppImageValidCache appValidCache __attribute__((section(".bootflags")));
+
+#ifdef CRC
+// CRC32 using the CRC calculation unit. Configured for the same (zlib) CRC32
+// that the image is built with: input and output bit reversed, inverted result.
+static uint32_t AppImageCrcHardware(const uint8_t* data, size_t size)
+{
+    // The unit is fed whole words, fall back for anything odd
+    if ((size % sizeof(uint32_t)) || (reinterpret_cast<uintptr_t>(data) % sizeof(uint32_t)))
+    {
+        return AppImageCrcSoftware(data, size);
+    }
+
+    RCC->AHBENR |= RCC_AHBENR_CRCEN;
+
+    CRC->INIT = 0xFFFFFFFF;
+    CRC->CR = CRC_CR_REV_IN_0 | CRC_CR_REV_IN_1 | CRC_CR_REV_OUT | CRC_CR_RESET;
+
+    const uint32_t* words = reinterpret_cast<const uint32_t*>(data);
+    for (size_t i = 0; i < size / sizeof(uint32_t); i++)
+    {
+        CRC->DR = words[i];
+    }
+
+    uint32_t result = ~CRC->DR;
+
+    RCC->AHBENR &= ~RCC_AHBENR_CRCEN;
+
+    return result;
+}
+#else
+#define AppImageCrcHardware AppImageCrcSoftware
+#endif
 
 bool isAppValid() {
-    const uint32_t* appFlash = 
-    __appflash_start__;
+    const uint8_t* appFlash = reinterpret_cast<const uint8_t*>(__appflash_start__);
+    uint32_t storedCrc = AppImageStoredCrc(appFlash, appSize);
 
-    int appSize = 25600;
+    // Checked since last power up and not erased since
+    if (AppImageCacheHit(appValidCache, storedCrc))
+    {
+        return true;
+    }
 
-    uint32_t expectedCrc = appFlash[appSize / 4 - 1];
-    uint32_t actualCrc = SWAP_UINT32(crc32(reinterpret_cast<const uint8_t*>(appFlash), appSize - 4));
+    if (!AppImageIsValid(appFlash, appSize, AppImageCrcHardware))
+    {
+        return false;
+    }
 
-    return actualCrc == expectedCrc;
+    AppImageCacheSet(appValidCache, storedCrc);
+
+    return true;
 }
 
 __attribute__((noreturn))
@@ -69,8 +114,10 @@ void EraseAppPages()
     uintptr_t blSize = (uintptr_t)(appFlashAddr - 0x08000000);
     size_t pageIdx = blSize / 1024;
 
-    // size_t appSizeKb = __appflash_size__ / 1024;
-    size_t appSizeKb = 25;
+    size_t appSizeKb = appSize / 1024;
+
+    // Image is about to change, previous check is no longer valid
+    AppImageCacheClear(appValidCache);
 
     for (size_t i = 0; i < appSizeKb; i++)
     {
@@ -191,7 +238,7 @@ void RunBootloaderLoop()
                     sendNak();
                 }
                 // Don't allow out of bounds writes
-                else if (embeddedData >= 26 * 1024)
+                else if (embeddedData + frame.DLC > appSize)
                 {
                     sendNak();
                 }
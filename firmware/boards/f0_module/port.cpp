@@ -1,11 +1,16 @@
 #include "port.h"
 #include "shared/flash.h"
+#include "shared/config_journal.h"
 
 #include "wideband_config.h"
+#include "heater_control.h"
+#include "sample_blanking.h"
 
 #include "ch.hpp"
 #include "hal.h"
 
+#include <cstring>
+
 #define ADC_CHANNEL_COUNT 3
 
 void PortPrepareAnalogSampling()
@@ -17,8 +22,13 @@ static adcsample_t adcBuffer[ADC_CHANNEL_COUNT * ADC_OVERSAMPLE];
 
 static chibios_rt::BinarySemaphore adcDoneSemaphore(/* taken =*/ true);
 
+// Heater PWM counter when the conversions started and finished
+static uint16_t heaterCounterStart = 0;
+static uint16_t heaterCounterEnd = 0;
+
 static void adcDoneCallback(ADCDriver*)
 {
+    heaterCounterEnd = GetHeaterPwmCounter();
     adcDoneSemaphore.signal();
 }
 
@@ -49,8 +59,17 @@ static float AverageSamples(adcsample_t* buffer, size_t idx)
     return (float)sum * scale;
 }
 
+// Same, leaving out the oversamples taken close to a heater PWM edge
+static float AverageCleanSamples(adcsample_t* buffer, size_t idx, uint32_t cleanMask)
+{
+    constexpr float scale = VCC_VOLTS / ADC_MAX_COUNT;
+
+    return AverageClean(buffer, idx, ADC_CHANNEL_COUNT, ADC_OVERSAMPLE, cleanMask, HEATER_EDGE_MIN_CLEAN_SAMPLES) * scale;
+}
+
 void AnalogSampleStart()
 {
+    heaterCounterStart = GetHeaterPwmCounter();
     adcStartConversion(&ADCD1, &convGroup, adcBuffer, ADC_OVERSAMPLE);
 }
 
@@ -58,13 +77,15 @@ AnalogResult AnalogSampleFinish()
 {
     adcDoneSemaphore.wait(TIME_INFINITE);
 
+    uint32_t clean = GetHeaterCleanSampleMask(heaterCounterStart, heaterCounterEnd, ADC_OVERSAMPLE);
+
     return
     {
         .ch =
         {
             {
-                .NernstVoltage = AverageSamples(adcBuffer, 0) * (1.0 / NERNST_INPUT_GAIN),
-                .PumpCurrentVoltage = AverageSamples(adcBuffer, 1),
+                .NernstVoltage = AverageCleanSamples(adcBuffer, 0, clean) * (1.0 / NERNST_INPUT_GAIN),
+                .PumpCurrentVoltage = AverageCleanSamples(adcBuffer, 1, clean),
                 .HeaterSupplyVoltage = 0,
                 .NernstClamped = false,
             },
@@ -112,24 +133,56 @@ static uint8_t readSelPin(ioportid_t port, iopadid_t pad)
 
 extern Configuration __configflash__start__;
 
-int InitConfiguration()
+// Config lives in the last 1k page (31). There is no second page to compact
+// into, so compaction erases and rewrites this one.
+class ConfigPageFlash : public IJournalFlash
 {
-    return 0;
-}
+public:
+    int BankCount() const override
+    {
+        return 1;
+    }
+
+    size_t BankSize() const override
+    {
+        return 1024;
+    }
+
+    void Read(int, size_t offset, uint8_t* buffer, size_t size) const override
+    {
+        memcpy(buffer, reinterpret_cast<const uint8_t*>(&__configflash__start__) + offset, size);
+    }
+
+    bool Erase(int) override
+    {
+        Flash::ErasePage(31);
+        return true;
+    }
+
+    bool Write(int, size_t offset, const uint8_t* buffer, size_t size) override
+    {
+        Flash::Write(reinterpret_cast<flashaddr_t>(&__configflash__start__) + offset, buffer, size);
+        return true;
+    }
+};
+
+static ConfigPageFlash configFlash;
+static ConfigJournal journal(configFlash, sizeof(Configuration));
 
 static Configuration config;
 
-Configuration* GetConfiguration()
+int InitConfiguration()
 {
-    const auto& cfg = __configflash__start__;
-
-    // If config has been written before, use the stored configuration
-    if (cfg.IsValid())
+    if (!journal.Mount() || !journal.Load(reinterpret_cast<uint8_t*>(&config)))
     {
-        // If we have valid config in flash - do not read ID pins, use ID from settings
-        config = cfg;
+        // Older firmware stored a plain copy of the configuration at the start of the page
+        config = __configflash__start__;
     }
-    else
+
+    // If config has been written before, use the stored configuration.
+    // Settings from older firmware are converted, so they survive the update.
+    // If we have valid config in flash - do not read ID pins, use ID from settings
+    if (!config.IsValid() && !MigrateConfiguration(config))
     {
         config.LoadDefaults();
 
@@ -152,20 +205,23 @@ Configuration* GetConfiguration()
         }
     }
 
+    return 0;
+}
+
+Configuration* GetConfiguration()
+{
     return &config;
 }
 
-void SetConfiguration()
+int SaveConfiguration()
 {
-    // erase config page
-    Flash::ErasePage(31);
+    // Only the bytes that changed are appended to the journal
+    if (!journal.Save(reinterpret_cast<const uint8_t*>(&config)))
+    {
+        return -1;
+    }
 
-    // Copy data to flash
-    Flash::Write(
-        reinterpret_cast<flashaddr_t>(&__configflash__start__),
-        reinterpret_cast<const uint8_t*>(&config),
-        sizeof(Configuration)
-    );
+    return 0;
 }
 
 SensorType GetSensorType()
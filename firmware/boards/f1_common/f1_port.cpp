@@ -1,6 +1,7 @@
 #include "port.h"
 
 #include "wideband_config.h"
+#include "shared/config_journal.h"
 
 #include "hal.h"
 #include "hal_mfs.h"
@@ -13,13 +14,82 @@ extern "C" {
 
 // Storage
 // TODO: runtime detection?
+/* Last 8 pages of flash, split in two banks of 4 pages.
+ * Same area older firmware used for MFS. */
+#ifdef STM32F103xB
+    /* 128K flash device with 1K pages
+     * one bank is 4K */
+    #define CONFIG_SECTOR_SIZE      1024U
+#endif
+#ifdef STM32F103xE
+    /* 256K flash device with 2K pages
+     * one bank is 8K */
+    #define CONFIG_SECTOR_SIZE      2048U
+#endif
+#define CONFIG_BANK0_START          120U
+#define CONFIG_BANK_SECTORS         4U
+
+class EflJournalFlash : public IJournalFlash
+{
+public:
+    int BankCount() const override
+    {
+        return 2;
+    }
+
+    size_t BankSize() const override
+    {
+        return CONFIG_BANK_SECTORS * CONFIG_SECTOR_SIZE;
+    }
+
+    void Read(int bank, size_t offset, uint8_t* buffer, size_t size) const override
+    {
+        flashRead(&EFLD1, BankOffset(bank) + offset, size, buffer);
+    }
+
+    bool Erase(int bank) override
+    {
+        for (size_t i = 0; i < CONFIG_BANK_SECTORS; i++)
+        {
+            flash_sector_t sector = CONFIG_BANK0_START + bank * CONFIG_BANK_SECTORS + i;
+
+            if (flashStartEraseSector(&EFLD1, sector) != FLASH_NO_ERROR)
+            {
+                return false;
+            }
+
+            if (flashWaitErase((BaseFlash *)&EFLD1) != FLASH_NO_ERROR)
+            {
+                return false;
+            }
+        }
+
+        return true;
+    }
+
+    bool Write(int bank, size_t offset, const uint8_t* buffer, size_t size) override
+    {
+        return flashProgram(&EFLD1, BankOffset(bank) + offset, size, buffer) == FLASH_NO_ERROR;
+    }
+
+private:
+    static flash_offset_t BankOffset(int bank)
+    {
+        return (CONFIG_BANK0_START + bank * CONFIG_BANK_SECTORS) * CONFIG_SECTOR_SIZE;
+    }
+};
+
+// Settings
+static Configuration cfg;
+
+static EflJournalFlash journalFlash;
+static ConfigJournal journal(journalFlash, sizeof(cfg));
+
+// Older firmware stored the configuration as an MFS record, only read to migrate it
 static const MFSConfig mfscfg1 = {
     .flashp           = (BaseFlash *)&EFLD1,
     .erased           = 0xFFFFFFFFU,
 #ifdef STM32F103xB
-    /* 128K flash device with 1K pages
-     * use last 8 pages for settings
-     * one bank is 4K */
     .bank_size        = 4096U,
     .bank0_start      = 120U,
     .bank0_sectors    = 4U,
@@ -27,9 +97,6 @@ static const MFSConfig mfscfg1 = {
     .bank1_sectors    = 4U
 #endif
 #ifdef STM32F103xE
-    /* 256K flash device with 2K pages
-     * use last 8 pages for settings
-     * one bank is 8K */
     .bank_size        = 8096U,
     .bank0_start      = 120U,
     .bank0_sectors    = 4U,
@@ -41,30 +108,50 @@ static const MFSConfig mfscfg1 = {
 static MFSDriver mfs1;
 static mfs_nocache_buffer_t __nocache_mfsbuf;
 
-// Settings
-static Configuration cfg;
 #define MFS_CONFIGURATION_RECORD_ID     1
 
-int InitConfiguration()
+static bool LoadLegacyConfiguration()
 {
     size_t size = GetConfigurationSize();
 
+    mfsObjectInit(&mfs1, &__nocache_mfsbuf);
+
+    if (mfsStart(&mfs1, &mfscfg1) != MFS_NO_ERROR) {
+        return false;
+    }
+
+    mfs_error_t err = mfsReadRecord(&mfs1, MFS_CONFIGURATION_RECORD_ID, &size, GetConfigurationPtr());
+    mfsStop(&mfs1);
+
+    /* older layouts were smaller */
+    if ((err != MFS_NO_ERROR) || (size > GetConfigurationSize())) {
+        return false;
+    }
+
+    return cfg.IsValid() || MigrateConfiguration(cfg);
+}
+
+int InitConfiguration()
+{
     /* Starting EFL driver.*/
     eflStart(&EFLD1, NULL);
 
-    mfsObjectInit(&mfs1, &__nocache_mfsbuf);
-
-    mfs_error_t err = mfsStart(&mfs1, &mfscfg1);
-    if (err != MFS_NO_ERROR) {
-        return -1;
+    if (journal.Mount() && journal.Load(GetConfigurationPtr())) {
+        /* settings from older firmware are converted, so they survive the update */
+        if (cfg.IsValid() || MigrateConfiguration(cfg)) {
+            return 0;
+        }
     }
 
-    err = mfsReadRecord(&mfs1, MFS_CONFIGURATION_RECORD_ID, &size, GetConfigurationPtr());
-    if ((err != MFS_NO_ERROR) || (size != GetConfigurationSize() || !cfg.IsValid())) {
-        /* load defaults */
-        cfg.LoadDefaults();
+    if (LoadLegacyConfiguration()) {
+        /* move it to the journal now, the first journal write erases MFS bank 0 anyway */
+        SaveConfiguration();
+        return 0;
     }
 
+    /* load defaults */
+    cfg.LoadDefaults();
+
     return 0;
 }
 
@@ -73,16 +160,10 @@ Configuration* GetConfiguration()
     return &cfg;
 }
 
-void SetConfiguration()
-{
-    SaveConfiguration();
-}
-
 /* TS stuff */
 int SaveConfiguration() {
-    /* TODO: handle error */
-    mfs_error_t err = mfsWriteRecord(&mfs1, MFS_CONFIGURATION_RECORD_ID, GetConfigurationSize(), GetConfigurationPtr());
-    if (err != MFS_NO_ERROR) {
+    /* Only the bytes that changed since the last save are written */
+    if (!journal.Save(GetConfigurationPtr())) {
         return -1;
     }
     return 0;
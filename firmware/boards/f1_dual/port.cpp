@@ -2,6 +2,8 @@
 
 
 #include "wideband_config.h"
+#include "heater_control.h"
+#include "sample_blanking.h"
 
 #include "hal.h"
 #include "ch.hpp"
@@ -18,8 +20,13 @@ static adcsample_t adcBuffer[ADC_CHANNEL_COUNT * ADC_OVERSAMPLE];
 
 static chibios_rt::BinarySemaphore adcDoneSemaphore(/* taken =*/ true);
 
+// Heater PWM counter when the conversions started and finished
+static uint16_t heaterCounterStart = 0;
+static uint16_t heaterCounterEnd = 0;
+
 static void adcDoneCallback(ADCDriver*)
 {
+    heaterCounterEnd = GetHeaterPwmCounter();
     adcDoneSemaphore.signal();
 }
 
@@ -58,19 +65,12 @@ const ADCConversionGroup convGroup =
         ADC_SQR3_SQ6_N(7),  /* PA7 - ADC12_IN7 - L_AUX_ADC */
 };
 
-static float AverageSamples(adcsample_t* buffer, size_t idx)
+// Average of one channel's oversamples, leaving out those taken close to a heater PWM edge
+static float AverageCleanSamples(adcsample_t* buffer, size_t idx, uint32_t cleanMask)
 {
-    uint32_t sum = 0;
-
-    for (size_t i = 0; i < ADC_OVERSAMPLE; i++)
-    {
-        sum += buffer[idx];
-        idx += ADC_CHANNEL_COUNT;
-    }
-
-    constexpr float scale = VCC_VOLTS / (ADC_MAX_COUNT * ADC_OVERSAMPLE);
+    constexpr float scale = VCC_VOLTS / ADC_MAX_COUNT;
 
-    return (float)sum * scale;
+    return AverageClean(buffer, idx, ADC_CHANNEL_COUNT, ADC_OVERSAMPLE, cleanMask, HEATER_EDGE_MIN_CLEAN_SAMPLES) * scale;
 }
 
 static float GetMaxSample(adcsample_t* buffer, size_t idx)
@@ -106,6 +106,7 @@ void AnalogSampleStart()
     l_heater = !palReadPad(L_HEATER_PORT, L_HEATER_PIN);
     r_heater = !palReadPad(R_HEATER_PORT, R_HEATER_PIN);
 
+    heaterCounterStart = GetHeaterPwmCounter();
     adcStartConversion(&ADCD1, &convGroup, adcBuffer, ADC_OVERSAMPLE);
 }
 
@@ -113,6 +114,8 @@ AnalogResult AnalogSampleFinish()
 {
     adcDoneSemaphore.wait(TIME_INFINITE);
 
+    uint32_t clean = GetHeaterCleanSampleMask(heaterCounterStart, heaterCounterEnd, ADC_OVERSAMPLE);
+
     bool l_heater_new = !palReadPad(L_HEATER_PORT, L_HEATER_PIN);
     bool r_heater_new = !palReadPad(R_HEATER_PORT, R_HEATER_PIN);
 
@@ -133,16 +136,16 @@ AnalogResult AnalogSampleFinish()
         .ch = {
             {
                 /* left */
-                .NernstVoltage = AverageSamples(adcBuffer, 3) * (1.0 / NERNST_INPUT_GAIN),
-                .PumpCurrentVoltage = AverageSamples(adcBuffer, 2),
+                .NernstVoltage = AverageCleanSamples(adcBuffer, 3, clean) * (1.0 / NERNST_INPUT_GAIN),
+                .PumpCurrentVoltage = AverageCleanSamples(adcBuffer, 2, clean),
                 .HeaterSupplyVoltage = l_heater_voltage,
                 /* TODO: */
                 .NernstClamped = false,
             },
             {
                 /* right */
-                .NernstVoltage = AverageSamples(adcBuffer, 1) * (1.0 / NERNST_INPUT_GAIN),
-                .PumpCurrentVoltage = AverageSamples(adcBuffer, 0),
+                .NernstVoltage = AverageCleanSamples(adcBuffer, 1, clean) * (1.0 / NERNST_INPUT_GAIN),
+                .PumpCurrentVoltage = AverageCleanSamples(adcBuffer, 0, clean),
                 .HeaterSupplyVoltage = r_heater_voltage,
                 /* TODO: */
                 .NernstClamped = false,
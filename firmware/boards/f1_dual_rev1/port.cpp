@@ -2,6 +2,8 @@
 
 
 #include "wideband_config.h"
+#include "heater_control.h"
+#include "sample_blanking.h"
 
 #include "hal.h"
 #include "ch.hpp"
@@ -18,8 +20,13 @@ static adcsample_t adcBuffer[ADC_CHANNEL_COUNT * ADC_OVERSAMPLE];
 
 static chibios_rt::BinarySemaphore adcDoneSemaphore(/* taken =*/ true);
 
+// Heater PWM counter when the conversions started and finished
+static uint16_t heaterCounterStart = 0;
+static uint16_t heaterCounterEnd = 0;
+
 static void adcDoneCallback(ADCDriver*)
 {
+    heaterCounterEnd = GetHeaterPwmCounter();
     adcDoneSemaphore.signal();
 }
 
@@ -68,19 +75,12 @@ const ADCConversionGroup convGroup =
         ADC_SQR3_SQ6_N(7),   /* PA7 - ADC12_IN7 - L_AUX_ADC */
 };
 
-static float AverageSamples(adcsample_t* buffer, size_t idx)
+// Average of one channel's oversamples, leaving out those taken close to a heater PWM edge
+static float AverageCleanSamples(adcsample_t* buffer, size_t idx, uint32_t cleanMask)
 {
-    uint32_t sum = 0;
-
-    for (size_t i = 0; i < ADC_OVERSAMPLE; i++)
-    {
-        sum += buffer[idx];
-        idx += ADC_CHANNEL_COUNT;
-    }
-
-    constexpr float scale = VCC_VOLTS / (ADC_MAX_COUNT * ADC_OVERSAMPLE);
+    constexpr float scale = VCC_VOLTS / ADC_MAX_COUNT;
 
-    return (float)sum * scale;
+    return AverageClean(buffer, idx, ADC_CHANNEL_COUNT, ADC_OVERSAMPLE, cleanMask, HEATER_EDGE_MIN_CLEAN_SAMPLES) * scale;
 }
 
 static float GetMaxSample(adcsample_t* buffer, size_t idx)
@@ -122,6 +122,7 @@ void AnalogSampleStart()
     l_heater = !palReadPad(L_HEATER_PORT, L_HEATER_PIN);
     r_heater = !palReadPad(R_HEATER_PORT, R_HEATER_PIN);
 
+    heaterCounterStart = GetHeaterPwmCounter();
     adcStartConversion(&ADCD1, &convGroup, adcBuffer, ADC_OVERSAMPLE);
 }
 
@@ -129,6 +130,8 @@ AnalogResult AnalogSampleFinish()
 {
     adcDoneSemaphore.wait(TIME_INFINITE);
 
+    uint32_t clean = GetHeaterCleanSampleMask(heaterCounterStart, heaterCounterEnd, ADC_OVERSAMPLE);
+
     bool l_heater_new = !palReadPad(L_HEATER_PORT, L_HEATER_PIN);
     bool r_heater_new = !palReadPad(R_HEATER_PORT, R_HEATER_PIN);
 
@@ -153,13 +156,13 @@ AnalogResult AnalogSampleFinish()
 
     for (int i = 0; i < AFR_CHANNELS; i++) {
         res.ch[i].NernstClamped = false;
-        float NernstRaw = AverageSamples(adcBuffer, (i == 0) ? 3 : 1);
+        float NernstRaw = AverageCleanSamples(adcBuffer, (i == 0) ? 3 : 1, clean);
         if (!isClamped(NernstRaw)) {
             /* not clamped */
             res.ch[i].NernstVoltage = (NernstRaw - NERNST_INPUT_OFFSET) * (1.0 / NERNST_INPUT_GAIN);
         } else {
             /* Clamped, use ungained input */
-            NernstRaw = AverageSamples(adcBuffer, (i == 0) ? 9 : 8);
+            NernstRaw = AverageCleanSamples(adcBuffer, (i == 0) ? 9 : 8, clean);
             if (isClamped(NernstRaw)) {
                 res.ch[i].NernstClamped = true;
             }
@@ -168,10 +171,10 @@ AnalogResult AnalogSampleFinish()
         }
     }
     /* left */
-    res.ch[0].PumpCurrentVoltage = AverageSamples(adcBuffer, 2);
+    res.ch[0].PumpCurrentVoltage = AverageCleanSamples(adcBuffer, 2, clean);
     res.ch[0].HeaterSupplyVoltage = l_heater_voltage;
     /* right */
-    res.ch[1].PumpCurrentVoltage = AverageSamples(adcBuffer, 0);
+    res.ch[1].PumpCurrentVoltage = AverageCleanSamples(adcBuffer, 0, clean);
     res.ch[1].HeaterSupplyVoltage = r_heater_voltage;
 
     return res;
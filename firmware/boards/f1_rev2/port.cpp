@@ -2,6 +2,8 @@
 
 
 #include "wideband_config.h"
+#include "heater_control.h"
+#include "sample_blanking.h"
 
 #include "hal.h"
 #include "ch.hpp"
@@ -18,8 +20,13 @@ static adcsample_t adcBuffer[ADC_CHANNEL_COUNT * ADC_OVERSAMPLE];
 
 static chibios_rt::BinarySemaphore adcDoneSemaphore(/* taken =*/ true);
 
+// Heater PWM counter when the conversions started and finished
+static uint16_t heaterCounterStart = 0;
+static uint16_t heaterCounterEnd = 0;
+
 static void adcDoneCallback(ADCDriver*)
 {
+    heaterCounterEnd = GetHeaterPwmCounter();
     adcDoneSemaphore.signal();
 }
 
@@ -67,8 +74,17 @@ static float AverageSamples(adcsample_t* buffer, size_t idx)
     return (float)sum * scale;
 }
 
+// Same, leaving out the oversamples taken close to a heater PWM edge
+static float AverageCleanSamples(adcsample_t* buffer, size_t idx, uint32_t cleanMask)
+{
+    constexpr float scale = VCC_VOLTS / ADC_MAX_COUNT;
+
+    return AverageClean(buffer, idx, ADC_CHANNEL_COUNT, ADC_OVERSAMPLE, cleanMask, HEATER_EDGE_MIN_CLEAN_SAMPLES) * scale;
+}
+
 void AnalogSampleStart()
 {
+    heaterCounterStart = GetHeaterPwmCounter();
     adcStartConversion(&ADCD1, &convGroup, adcBuffer, ADC_OVERSAMPLE);
 }
 
@@ -76,12 +92,14 @@ AnalogResult AnalogSampleFinish()
 {
     adcDoneSemaphore.wait(TIME_INFINITE);
 
+    uint32_t clean = GetHeaterCleanSampleMask(heaterCounterStart, heaterCounterEnd, ADC_OVERSAMPLE);
+
     return
     {
         .ch = {
             {
-                .NernstVoltage = AverageSamples(adcBuffer, 2) * (1.0 / NERNST_INPUT_GAIN),
-                .PumpCurrentVoltage = AverageSamples(adcBuffer, 1),
+                .NernstVoltage = AverageCleanSamples(adcBuffer, 2, clean) * (1.0 / NERNST_INPUT_GAIN),
+                .PumpCurrentVoltage = AverageCleanSamples(adcBuffer, 1, clean),
                 /* We also can measure output virtual ground voltage for diagnostic purposes */
                 //.VirtualGroundVoltageExt = AverageSamples(adcBuffer, 0) / VM_INPUT_DIVIDER,
                 /* Heater measurement circuit has incorrect RC filter making inposible accurate
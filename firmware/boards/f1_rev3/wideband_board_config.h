@@ -48,5 +48,6 @@
 // *******************************
 //   TunerStudio Primary Port
 // *******************************
-#define TS_PRIMARY_SERIAL_PORT	SD1
+// DMA driven, no per-byte interrupts
+#define TS_PRIMARY_UART_PORT	UARTD1
 #define TS_PRIMARY_BAUDRATE		115200
@@ -6,6 +6,7 @@
 #include "port_shared.h"
 #include "wideband_config.h"
 #include "heater_control.h"
+#include "lambda_filter.h"
 
 struct AnalogChannelResult
 {
@@ -55,10 +56,16 @@ enum class AuxOutputMode : uint8_t {
 };
 
 class Configuration {
+public:
+    // Increment this any time the configuration format changes, and add a
+    // migration from the previous version to config_migration.cpp
+    static constexpr uint8_t Version = 4;
+
 private:
-    // Increment this any time the configuration format changes
-    // It is stored along with the data to ensure that it has been written before
-    static constexpr uint32_t ExpectedTag = 0xDEADBE03;
+    // It is stored along with the data to ensure that it has been written before,
+    // the low byte is the layout version
+    static constexpr uint32_t TagBase = 0xDEADBE00;
+    static constexpr uint32_t ExpectedTag = TagBase | Version;
     uint32_t Tag = ExpectedTag;
 
 public:
@@ -67,6 +74,22 @@ public:
         return this->Tag == ExpectedTag;
     }
 
+    // Layout version this was written with, 0 if it's not a configuration at all
+    uint8_t GetVersion() const
+    {
+        if ((this->Tag & 0xFFFFFF00) != TagBase)
+        {
+            return 0;
+        }
+
+        return this->Tag & 0xFF;
+    }
+
+    void SetVersion(uint8_t version)
+    {
+        this->Tag = TagBase | version;
+    }
+
     // Configuration defaults
     void LoadDefaults()
     {
@@ -111,6 +134,12 @@ public:
         heaterConfig.HeaterSupplyOffVoltage = HEATER_SUPPLY_OFF_VOLTAGE;
         heaterConfig.HeaterSupplyOnVoltage = HEATER_SUPPLY_ON_VOLTAGE;
         heaterConfig.PreheatTimeSec = HEATER_PREHEAT_TIME;
+
+        for (i = 0; i < LAMBDA_OUTPUT_COUNT; i++) {
+            lambdaFilter[i].Type = LambdaFilterType::Bypass;
+            lambdaFilter[i].MedianLength = LAMBDA_FILTER_DEFAULT_MEDIAN;
+            lambdaFilter[i].CutoffHz = LAMBDA_FILTER_DEFAULT_CUTOFF_HZ;
+        }
         
         /* Finaly */
         Tag = ExpectedTag;
@@ -150,6 +179,9 @@ public:
             } egt[2];
 
             struct HeaterConfig heaterConfig;
+
+            // indexed by LambdaOutput
+            LambdaFilterConfig lambdaFilter[LAMBDA_OUTPUT_COUNT];
         } __attribute__((packed));
 
         // pad to 256 bytes including tag
@@ -158,14 +190,19 @@ public:
 };
 static_assert(sizeof(Configuration) == 256, "Configuration size incorrect");
 
+// Bring a configuration written by older firmware up to the current layout.
+// Returns false if it isn't a known older version, in that case load defaults.
+bool MigrateConfiguration(Configuration& cfg);
+
 int InitConfiguration();
 Configuration* GetConfiguration();
-void SetConfiguration();
+// Write the configuration to flash right away, use SetConfiguration()
+// from config_persistence.h to do it from a background thread
+int SaveConfiguration();
 
 /* TS stuff */
 uint8_t *GetConfigurationPtr();
 size_t GetConfigurationSize();
-int SaveConfiguration();
 const char *getTsSignature();
 
 void rebootNow();
@@ -0,0 +1,91 @@
+#include "boot_timeline.h"
+
+#include "timer.h"
+
+static_assert(sizeof(livedata_boot_s) == 32, "livedata_boot_s size incorrect");
+
+static Timer bootTimer;
+static livedata_boot_s timeline;
+static int reachedCount = 0;
+
+void BootTimelineStart()
+{
+    bootTimer.reset();
+    reachedCount = 0;
+
+    for (auto& t : timeline.stageMs)
+    {
+        t = BOOT_STAGE_PENDING;
+    }
+}
+
+void BootTimelineMark(BootStage stage)
+{
+    auto& t = timeline.stageMs[static_cast<int>(stage)];
+
+    if (t != BOOT_STAGE_PENDING)
+    {
+        return;
+    }
+
+    float ms = bootTimer.getElapsedUs() / 1000;
+
+    // Saturate just below the pending marker
+    t = ms < BOOT_STAGE_PENDING - 1 ? ms : BOOT_STAGE_PENDING - 1;
+    reachedCount++;
+}
+
+uint16_t BootTimelineGetMs(BootStage stage)
+{
+    return timeline.stageMs[static_cast<int>(stage)];
+}
+
+int BootTimelineCount()
+{
+    return reachedCount;
+}
+
+const livedata_boot_s* GetBootTimeline()
+{
+    return &timeline;
+}
+
+const char* describeBootStage(BootStage stage)
+{
+    switch (stage) {
+        case BootStage::Config:
+            return "Config";
+        case BootStage::Sampling:
+            return "Sampling";
+        case BootStage::Can:
+            return "CAN";
+        case BootStage::PumpDac:
+            return "PumpDac";
+        case BootStage::HeaterControl:
+            return "HeaterCtrl";
+        case BootStage::PumpControl:
+            return "PumpCtrl";
+        case BootStage::AuxDac:
+            return "AuxDac";
+        case BootStage::TunerStudio:
+            return "TS";
+        case BootStage::Uart:
+            return "UART";
+        case BootStage::Indication:
+            return "Indication";
+        case BootStage::Egt:
+            return "EGT";
+        case BootStage::SamplingStable:
+            return "SamplingStable";
+        case BootStage::HeaterStart:
+            return "HeaterStart";
+        case BootStage::FirstCanTx:
+            return "FirstCanTx";
+        case BootStage::ClosedLoop:
+            return "ClosedLoop";
+        case BootStage::Count:
+            break;
+    }
+
+    return "Unknown";
+}
@@ -0,0 +1,58 @@
+#pragma once
+
+#include <cstdint>
+
+// Init stages and startup milestones, in the order they normally happen
+enum class BootStage : uint8_t
+{
+    // main() init sequence, marked as each stage completes
+    Config,
+    Sampling,
+    Can,
+    PumpDac,
+    HeaterControl,
+    PumpControl,
+    AuxDac,
+    TunerStudio,
+    Uart,
+    Indication,
+    Egt,
+
+    // Runtime milestones
+    SamplingStable,
+    HeaterStart,
+    FirstCanTx,
+    ClosedLoop,
+
+    Count,
+};
+
+// Stage not reached (yet)
+#define BOOT_STAGE_PENDING 0xFFFF
+
+/* +128 offset */
+struct livedata_boot_s {
+    union {
+        struct {
+            // ms since chSysInit() when each BootStage was reached
+            uint16_t stageMs[static_cast<int>(BootStage::Count)];
+        };
+        uint8_t pad[32];
+    };
+};
+
+// Start the timeline, call right after chSysInit()
+void BootTimelineStart();
+
+// Record the first time a stage is reached, later calls are ignored
+void BootTimelineMark(BootStage stage);
+
+// Returns BOOT_STAGE_PENDING if the stage hasn't been reached
+uint16_t BootTimelineGetMs(BootStage stage);
+
+// Number of stages reached so far
+int BootTimelineCount();
+
+const livedata_boot_s* GetBootTimeline();
+
+const char* describeBootStage(BootStage stage);
@@ -7,32 +7,119 @@
 #include "can_aemnet.h"
 #include "heater_control.h"
 #include "lambda_conversion.h"
+#include "lambda_filter.h"
 #include "sampling.h"
 #include "pump_dac.h"
+#include "pump_control.h"
 #include "port.h"
+#include "config_persistence.h"
+#include "boot_timeline.h"
+#include "thread_monitor.h"
+
+#ifdef EFI_CAN_SERIAL
+#include "tunerstudio_io.h"
+#endif
 
 // this same header is imported by rusEFI to get struct layouts and firmware version
 #include "../for_rusefi/wideband_can.h"
 
 static Configuration* configuration;
 
+static_assert(1000 / WBO_TX_PERIOD_MS == LAMBDA_FILTER_RATE_HZ, "lambda filters assume 100 Hz CAN updates");
+static LambdaFilter lambdaFilter[AFR_CHANNELS];
+
+static void SendThreadStats(int cycle)
+{
+    // Refresh once a second, send one thread every 100 ms
+    if ((cycle % 100) == 0)
+    {
+        ThreadStatsUpdate();
+    }
+
+    if ((cycle % 10) != 0 || !configuration->afr[0].RusEfiTxDiag)
+    {
+        return;
+    }
+
+    const auto stats = GetThreadStats();
+    if (!stats)
+    {
+        return;
+    }
+
+    int thread = (cycle / 10) % THREAD_STATS_COUNT;
+
+    CanTxTyped<wbo::ThreadStatsData> frame(WB_THREAD_STATS_BASE + configuration->afr[0].RusEfiIdx, true);
+
+    frame.get().Thread = thread;
+    frame.get().CpuLoad = stats->cpuLoad[thread];
+    frame.get().StackFree = stats->stackFree[thread];
+    frame.get().LoopMaxUs = stats->loopMaxUs[thread];
+
+    const auto deadlineStats = GetDeadlineStats();
+
+    for (int i = 0; deadlineStats && i < DEADLINE_LOOPS; i++)
+    {
+        if (static_cast<int>(deadlineLoops[i]) == thread)
+        {
+            frame.get().DeadlineMisses = deadlineStats->loop[i].misses;
+        }
+    }
+}
+
+static void SendSensorResponse(int cycle)
+{
+    // Results are worked out here rather than in the pump loop, it can't spare the time
+    ProcessSensorResponse();
+
+    // Changes once a minute at most
+    if ((cycle % 100) != 50)
+    {
+        return;
+    }
+
+    for (int ch = 0; ch < AFR_CHANNELS; ch++)
+    {
+        if (!configuration->afr[ch].RusEfiTxDiag)
+        {
+            continue;
+        }
+
+        const auto& response = GetSensorResponse(ch);
+
+        CanTxTyped<wbo::SensorResponseData> frame(WB_SENSOR_RESPONSE_BASE + configuration->afr[ch].RusEfiIdx, true);
+
+        float tau = response.GetTimeConstantMs() * 10;
+        float delay = response.GetDelayMs() * 10;
+        frame.get().TimeConstant = tau < 0xFFFF ? tau : 0xFFFF;
+        frame.get().Delay = delay < 0xFFFF ? delay : 0xFFFF;
+        frame.get().Count = response.GetResultCount() < 255 ? response.GetResultCount() : 255;
+    }
+}
+
 static THD_WORKING_AREA(waCanTxThread, 512);
 void CanTxThread(void*)
 {
-    int cycle;
+    int cycle = 0;
     chRegSetThreadName("CAN Tx");
 
+    ThreadDeadlineInit(ThreadId::CanTx, WBO_TX_PERIOD_MS);
+
     // Current system time.
     systime_t prev = chVTGetSystemTime();
 
     while(1)
     {
+        ThreadLoopBegin(ThreadId::CanTx);
+
         // AFR - 100 Hz
         for (int ch = 0; ch < AFR_CHANNELS; ch++)
         {
             SendCanForChannel(ch);
         }
 
+        BootTimelineMark(BootStage::FirstCanTx);
+
         // EGT - 20 Hz
         if ((cycle % 5) == 0) {
             for (int ch = 0; ch < EGT_CHANNELS; ch++) {
@@ -40,6 +127,11 @@ void CanTxThread(void*)
             }
         }
 
+        SendThreadStats(cycle);
+        SendSensorResponse(cycle);
+
+        ThreadLoopEnd(ThreadId::CanTx);
+
         cycle++;
         prev = chThdSleepUntilWindowed(prev, chTimeAddX(prev, TIME_MS2I(WBO_TX_PERIOD_MS)));
     }
@@ -62,6 +154,15 @@ static void SendAck()
     canTransmitTimeout(&CAND1, CAN_ANY_MAILBOX, &frame, TIME_INFINITE);
 }
 
+static void ConfigSavedAck(bool ok)
+{
+    // Only acknowledge once the new index is on flash
+    if (ok)
+    {
+        SendAck();
+    }
+}
+
 // Start in Unknown state. If no CAN message is ever received, we operate
 // on internal battery sense etc.
 static HeaterAllow heaterAllow = HeaterAllow::Unknown;
@@ -89,6 +190,14 @@ void CanRxThread(void*)
             continue;
         }
 
+#ifdef EFI_CAN_SERIAL
+        // TunerStudio traffic goes to its own thread
+        if (canTsFrameReceived(frame))
+        {
+            continue;
+        }
+#endif
+
         if (frame.DLC == 2 && CAN_ID(frame) == WB_MGS_ECU_STATUS)
         {
             // This is status from ECU - battery voltage and heater enable signal
@@ -121,6 +230,10 @@ void CanRxThread(void*)
             // If 0xFF (force update all) or our ID, reset to bootloader, otherwise ignore
             if (frame.DLC == 0 || frame.data8[0] == 0xFF || frame.data8[0] == GetConfiguration()->afr[0].RusEfiIdx)
             {
+                // Don't reset in the middle of a pending configuration write.
+                // Nothing changed since, so this save itself writes nothing.
+                WaitConfigurationSaved(SetConfiguration());
+
                 SendAck();
 
                 // Let the message get out before we reset the chip
@@ -140,8 +253,8 @@ void CanRxThread(void*)
             for (int i = 0; i < EGT_CHANNELS; i++) {
                 configuration->egt[i].RusEfiIdx = offset + i;
             }
-            SetConfiguration();
-            SendAck();
+            // Written (and acknowledged) from the persistence thread, reception goes on meanwhile
+            SetConfiguration(ConfigSavedAck);
         }
     }
 }
@@ -170,20 +283,18 @@ void SendRusefiFormat(uint8_t ch)
     auto baseAddress = WB_DATA_BASE_ADDR + 2 * configuration->afr[ch].RusEfiIdx;
 
     const auto& sampler = GetSampler(ch);
-    const auto& heater = GetHeaterController(ch);
+    const auto& estimator = GetSensorEstimator(ch);
 
     auto nernstDc = sampler.GetNernstDc();
     auto pumpDuty = GetPumpOutputDuty(ch);
-    auto lambda = GetLambda(ch);
 
-    // Lambda is valid if:
-    // 1. Nernst voltage is near target
-    // 2. Pump driver isn't slammed in to the stop
-    // 3. Lambda is >0.6 (sensor isn't specified below that)
-    bool lambdaValid =
-            nernstDc > (NERNST_TARGET - 0.1f) && nernstDc < (NERNST_TARGET + 0.1f) &&
-            pumpDuty > 0.1f && pumpDuty < 0.9f &&
-            lambda > 0.6f;
+    auto& filter = lambdaFilter[ch];
+    filter.Configure(configuration->lambdaFilter[static_cast<int>(LambdaOutput::RusEfi)]);
+    auto lambda = filter.Update(GetLambda(ch));
+
+    // Nernst voltage near target, pump driver off its stops, lambda in the
+    // sensor's range and temperature near target, see SensorEstimator
+    bool lambdaValid = estimator.IsValid();
 
     if (configuration->afr[ch].RusEfiTx) {
         CanTxTyped<wbo::StandardData> frame(baseAddress + 0);
@@ -194,8 +305,8 @@ void SendRusefiFormat(uint8_t ch)
         uint16_t lambdaInt = lambdaValid ? (lambda * 10000) : 0;
         frame.get().Lambda = lambdaInt;
         frame.get().TemperatureC = sampler.GetSensorTemperature();
-        bool heaterClosedLoop = heater.IsRunningClosedLoop();
-        frame.get().Valid = (heaterClosedLoop && lambdaValid) ? 0x01 : 0x00;
+        frame.get().Valid = lambdaValid ? 0x01 : 0x00;
+        frame.get().Confidence = estimator.GetConfidence() * 100;
     }
 
     if (configuration->afr[ch].RusEfiTxDiag) {
@@ -206,6 +317,9 @@ void SendRusefiFormat(uint8_t ch)
         frame.get().PumpDuty = pumpDuty * 255;
         frame.get().Status = GetCurrentFault(ch);
         frame.get().HeaterDuty = GetHeaterDuty(ch) * 255;
+
+        float delay = filter.GetGroupDelayMs() + 0.5f;
+        frame.get().LambdaDelay = delay < 255 ? delay : 255;
     }
 }
 
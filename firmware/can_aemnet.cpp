@@ -8,8 +8,10 @@
 #include "fault.h"
 #include "heater_control.h"
 #include "lambda_conversion.h"
+#include "lambda_filter.h"
 #include "sampling.h"
 #include "pump_dac.h"
+#include "pump_control.h"
 #include "max3185x.h"
 
 // AEMNet protocol
@@ -58,25 +60,25 @@ static_assert(sizeof(EgtData) == 8);
 
 static int LambdaIsValid(int ch)
 {
-    const auto& sampler = GetSampler(ch);
-    const auto& heater = GetHeaterController(ch);
-
-    float nernstDc = sampler.GetNernstDc();
-
-    return ((heater.IsRunningClosedLoop()) &&
-            (nernstDc > (NERNST_TARGET - 0.1f)) &&
-            (nernstDc < (NERNST_TARGET + 0.1f)));
+    return GetSensorEstimator(ch).IsValid();
 }
 
+static LambdaFilter lambdaFilter[AFR_CHANNELS];
+
 void SendAemNetUEGOFormat(Configuration* cfg, uint8_t ch)
 {
+    // Runs at the AemNet rate whether or not it's sent, so it's settled once enabled
+    auto& filter = lambdaFilter[ch];
+    filter.Configure(cfg->lambdaFilter[static_cast<int>(LambdaOutput::AemNet)]);
+    float lambda = filter.Update(GetLambda(ch));
+
     if (cfg->afr[ch].AemNetTx) {
         auto id = AEMNET_UEGO_BASE_ID + cfg->afr[ch].AemNetIdOffset;
         const auto& sampler = GetSampler(ch);
 
         CanTxTyped<aemnet::UEGOData> frame(id, true);
 
-        frame.get().Lambda = GetLambda(ch) * 10000;
+        frame.get().Lambda = lambda * 10000;
         frame.get().Oxygen = 0; // TODO:
         frame.get().SystemVolts = sampler.GetInternalHeaterVoltage() * 10;
         frame.get().Flags =
@@ -0,0 +1,122 @@
+#include "port.h"
+
+#include <cstring>
+
+/*
+ * Configuration layout history. Tag is always the first word, its low byte
+ * is the version.
+ *
+ * v1 (0xDEADBE01), 128 bytes
+ *   +4    uint8_t CanIndexOffset, index of the first AFR channel
+ *
+ * v2 (0xDEADBE02), 168 bytes
+ *   +4    CanIndexOffset no longer used, replaced by per channel settings
+ *   +5    aux output curves and sources, sensor type,
+ *         per AFR/EGT channel CAN settings
+ *
+ * v3 (0xDEADBE03), 176 bytes
+ *   +168  heaterConfig
+ *
+ * v4 (0xDEADBE04), 256 bytes
+ *   +176  lambdaFilter, per output
+ */
+
+struct ConfigMigration
+{
+    // Migrates from this version to the next one
+    uint8_t FromVersion;
+    // Size of that version's layout, anything past it is undefined
+    size_t Size;
+    void (*Migrate)(Configuration& cfg);
+};
+
+static void MigrateV1(Configuration& cfg)
+{
+    uint8_t canIndexOffset = cfg.NoLongerUsed0;
+
+    // Everything else is new
+    cfg.LoadDefaults();
+
+    // Same mapping as a WB_MSG_SET_INDEX
+    for (int i = 0; i < AFR_CHANNELS; i++) {
+        cfg.afr[i].RusEfiIdx = canIndexOffset + i;
+    }
+    for (int i = 0; i < EGT_CHANNELS; i++) {
+        cfg.egt[i].RusEfiIdx = canIndexOffset + i;
+    }
+}
+
+static void MigrateV2(Configuration& cfg)
+{
+    cfg.heaterConfig = {};
+    cfg.heaterConfig.HeaterSupplyOffVoltage = HEATER_SUPPLY_OFF_VOLTAGE;
+    cfg.heaterConfig.HeaterSupplyOnVoltage = HEATER_SUPPLY_ON_VOLTAGE;
+    cfg.heaterConfig.PreheatTimeSec = HEATER_PREHEAT_TIME;
+}
+
+static void MigrateV3(Configuration& cfg)
+{
+    // Unfiltered, as before
+    for (int i = 0; i < LAMBDA_OUTPUT_COUNT; i++) {
+        cfg.lambdaFilter[i] = {};
+        cfg.lambdaFilter[i].Type = LambdaFilterType::Bypass;
+        cfg.lambdaFilter[i].MedianLength = LAMBDA_FILTER_DEFAULT_MEDIAN;
+        cfg.lambdaFilter[i].CutoffHz = LAMBDA_FILTER_DEFAULT_CUTOFF_HZ;
+    }
+}
+
+static const ConfigMigration migrations[] = {
+    { 1, 128, MigrateV1 },
+    { 2, 168, MigrateV2 },
+    { 3, 176, MigrateV3 },
+};
+
+static const ConfigMigration* FindMigration(uint8_t fromVersion)
+{
+    for (const auto& m : migrations)
+    {
+        if (m.FromVersion == fromVersion)
+        {
+            return &m;
+        }
+    }
+
+    return nullptr;
+}
+
+bool MigrateConfiguration(Configuration& cfg)
+{
+    uint8_t version = cfg.GetVersion();
+
+    // Not a configuration, or written by newer firmware
+    if (version == 0 || version > Configuration::Version)
+    {
+        return false;
+    }
+
+    bool first = true;
+
+    while (version < Configuration::Version)
+    {
+        auto m = FindMigration(version);
+
+        if (!m)
+        {
+            return false;
+        }
+
+        if (first)
+        {
+            // Don't let whatever was stored past the old layout leak in to new fields
+            memset(reinterpret_cast<uint8_t*>(&cfg) + m->Size, 0, sizeof(Configuration) - m->Size);
+            first = false;
+        }
+
+        m->Migrate(cfg);
+
+        version++;
+        cfg.SetVersion(version);
+    }
+
+    return true;
+}
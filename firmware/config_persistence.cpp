@@ -0,0 +1,103 @@
+#include "ch.h"
+
+#include "config_persistence.h"
+#include "port.h"
+
+#define MAX_SAVE_CALLBACKS 4
+
+static binary_semaphore_t requestSem;
+
+// Protected by the system lock
+static uint32_t requestedTicket = 0;
+static uint32_t completedTicket = 0;
+static bool lastSaveOk = true;
+static ConfigSavedCallback pendingCallbacks[MAX_SAVE_CALLBACKS];
+static int pendingCallbackCount = 0;
+
+static THD_WORKING_AREA(waConfigPersistThread, CONFIG_PERSIST_THREAD_STACK);
+static void ConfigPersistThread(void*)
+{
+    chRegSetThreadName("Config save");
+
+    while (true)
+    {
+        chBSemWait(&requestSem);
+
+        // Give a burst of requests (re-indexing several modules, repeated burns)
+        // a chance to collapse into a single write
+        chThdSleepMilliseconds(CONFIG_PERSIST_HOLDOFF_MS);
+
+        ConfigSavedCallback callbacks[MAX_SAVE_CALLBACKS];
+        int callbackCount;
+
+        chSysLock();
+        // Requests arriving from here on trigger another round, since the
+        // configuration may change while it's being written
+        uint32_t ticket = requestedTicket;
+        callbackCount = pendingCallbackCount;
+        for (int i = 0; i < callbackCount; i++)
+        {
+            callbacks[i] = pendingCallbacks[i];
+        }
+        pendingCallbackCount = 0;
+        chSysUnlock();
+
+        bool ok = SaveConfiguration() == 0;
+
+        chSysLock();
+        completedTicket = ticket;
+        lastSaveOk = ok;
+        chSysUnlock();
+
+        for (int i = 0; i < callbackCount; i++)
+        {
+            callbacks[i](ok);
+        }
+    }
+}
+
+void StartConfigPersistence()
+{
+    chBSemObjectInit(&requestSem, true);
+
+    chThdCreateStatic(waConfigPersistThread, sizeof(waConfigPersistThread), CONFIG_PERSIST_THREAD_PRIO, ConfigPersistThread, nullptr);
+}
+
+uint32_t SetConfiguration(ConfigSavedCallback done)
+{
+    chSysLock();
+
+    uint32_t ticket = ++requestedTicket;
+
+    if (done)
+    {
+        bool found = false;
+        for (int i = 0; i < pendingCallbackCount; i++)
+        {
+            found |= pendingCallbacks[i] == done;
+        }
+
+        if (!found && pendingCallbackCount < MAX_SAVE_CALLBACKS)
+        {
+            pendingCallbacks[pendingCallbackCount++] = done;
+        }
+    }
+
+    chBSemSignalI(&requestSem);
+    chSchRescheduleS();
+
+    chSysUnlock();
+
+    return ticket;
+}
+
+int WaitConfigurationSaved(uint32_t ticket)
+{
+    // Signed difference so that the ticket counter may wrap
+    while (static_cast<int32_t>(completedTicket - ticket) < 0)
+    {
+        chThdSleepMilliseconds(2);
+    }
+
+    return lastSaveOk ? 0 : -1;
+}
@@ -0,0 +1,25 @@
+#pragma once
+
+#include <cstdint>
+
+// Flash writes happen on this thread, below everything time critical
+#define CONFIG_PERSIST_THREAD_STACK     (512)
+#define CONFIG_PERSIST_THREAD_PRIO      (NORMALPRIO - 10)
+
+// Requests arriving within this time of each other result in a single write
+#define CONFIG_PERSIST_HOLDOFF_MS       10
+
+// Called from the persistence thread once the save has been committed (or failed)
+using ConfigSavedCallback = void (*)(bool ok);
+
+void StartConfigPersistence();
+
+// Queue a save of GetConfiguration(), returns immediately.
+// Pending requests are coalesced: several calls before the write starts
+// result in one write, and each distinct callback is called once.
+// Returns a ticket that can be passed to WaitConfigurationSaved().
+uint32_t SetConfiguration(ConfigSavedCallback done = nullptr);
+
+// Block the calling thread until the save identified by ticket is on flash,
+// returns 0 on success like SaveConfiguration()
+int WaitConfigurationSaved(uint32_t ticket);
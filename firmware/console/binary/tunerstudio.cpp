@@ -65,6 +65,7 @@
 
 /* configuration */
 #include "port.h"
+#include "config_persistence.h"
 
 /* chprintf */
 #include "chprintf.h"
@@ -75,7 +76,7 @@
 
 #include "indication.h"
 
-#include <rusefi/crc.h>
+#include "fast_crc.h"
 
 #ifndef EFI_BLUETOOTH_SETUP
 	#define EFI_BLUETOOTH_SETUP 0
@@ -166,21 +167,22 @@ void TunerStudio::handleCrc32Check(TsChannelBase *tsChannel, ts_response_format_
 
 	const uint8_t* start = getWorkingPageAddr() + offset;
 
-	uint32_t crc = SWAP_UINT32(crc32(start, count));
+	uint32_t crc = SWAP_UINT32(FastCrc32(start, count));
 	tsChannel->sendResponse(mode, (const uint8_t *) &crc, 4);
 }
 
 void TunerStudio::handlePageReadCommand(TsChannelBase* tsChannel, ts_response_format_e mode, uint16_t offset, uint16_t count) {
 	tsState.readPageCommandsCounter++;
 
-	if (!validateOffsetCount(offset, count)) {
+	if (!validateOffsetCount(offset, count) || count > TS_READ_BLOCKING_FACTOR) {
 		tunerStudioError(tsChannel, "ERROR: out of range");
 		sendErrorCode(tsChannel, TS_RESPONSE_OUT_OF_RANGE);
 		return;
 	}
 
 	const uint8_t* addr = getWorkingPageAddr() + offset;
-	tsChannel->sendResponse(mode, addr, count);
+	/* long packets are streamed from the page without staging */
+	tsChannel->sendResponse(mode, addr, count, true);
 }
 
 static void sendResponseCode(ts_response_format_e mode, TsChannelBase *tsChannel, const uint8_t responseCode) {
@@ -195,7 +197,8 @@ static void sendResponseCode(ts_response_format_e mode, TsChannelBase *tsChannel
 static void handleBurnCommand(TsChannelBase* tsChannel, ts_response_format_e mode) {
 	tsState.burnCommandCounter++;
 
-	int ret = SaveConfiguration();
+	// Goes through the persistence thread so it can't race with other writes
+	int ret = WaitConfigurationSaved(SetConfiguration());
 	if (ret) {
 		tunerStudioError(tsChannel, "ERROR: failed to save settings");
 	}
@@ -243,7 +246,10 @@ static bool isKnownCommand(char command) {
 			|| command == TS_GET_SCATTERED_GET_COMMAND
 			|| command == TS_CRC_CHECK_COMMAND
 			|| command == TS_GET_FIRMWARE_VERSION
-			|| command == TS_IO_TEST_COMMAND;
+			|| command == TS_GET_BLOCKING_FACTOR_COMMAND
+			|| command == TS_IO_TEST_COMMAND
+			|| command == TS_SAMPLE_STREAM_COMMAND
+			|| command == TS_PROFILE_COMMAND;
 }
 
 /**
@@ -429,7 +435,7 @@ static int tsProcessOne(TsChannelBase* tsChannel) {
 
 	expectedCrc = SWAP_UINT32(expectedCrc);
 
-	uint32_t actualCrc = crc32(tsChannel->scratchBuffer, incomingPacketSize);
+	uint32_t actualCrc = FastCrc32(tsChannel->scratchBuffer, incomingPacketSize);
 	if (actualCrc != expectedCrc) {
 		//efiPrintf("TunerStudio: CRC %x %x %x %x", tsChannel->scratchBuffer[incomingPacketSize + 0],
 		//		tsChannel->scratchBuffer[incomingPacketSize + 1], tsChannel->scratchBuffer[incomingPacketSize + 2],
@@ -501,6 +507,19 @@ static void handleGetVersion(TsChannelBase* tsChannel) {
 	tsChannel->sendResponse(TS_CRC, (const uint8_t *) versionBuffer, strlen(versionBuffer) + 1);
 }
 
+/**
+ * Lets the host size its requests: serial protocol version, then the read
+ * and write blocking factors, big endian
+ */
+static void handleGetBlockingFactor(TsChannelBase* tsChannel) {
+	const uint8_t response[] = {
+		2,
+		TS_READ_BLOCKING_FACTOR >> 8, TS_READ_BLOCKING_FACTOR & 0xff,
+		BLOCKING_FACTOR >> 8, BLOCKING_FACTOR & 0xff,
+	};
+	tsChannel->sendResponse(TS_CRC, response, sizeof(response));
+}
+
 int TunerStudio::handleCrcCommand(TsChannelBase* tsChannel, char *data, size_t incomingPacketSize) {
 	bool handled = true;
 	(void)incomingPacketSize;
@@ -520,6 +539,9 @@ int TunerStudio::handleCrcCommand(TsChannelBase* tsChannel, char *data, size_t i
 	case TS_GET_FIRMWARE_VERSION:
 		handleGetVersion(tsChannel);
 		break;
+	case TS_GET_BLOCKING_FACTOR_COMMAND:
+		handleGetBlockingFactor(tsChannel);
+		break;
 	case TS_BURN_COMMAND:
 		handleBurnCommand(tsChannel, TS_CRC);
 		break;
@@ -528,6 +550,12 @@ int TunerStudio::handleCrcCommand(TsChannelBase* tsChannel, char *data, size_t i
 	case 'T':
 		handleTestCommand(tsChannel);
 		break;
+	case TS_SAMPLE_STREAM_COMMAND:
+		handleSampleStreamCommand(tsChannel, data, incomingPacketSize);
+		break;
+	case TS_PROFILE_COMMAND:
+		handleProfileCommand(tsChannel, data, incomingPacketSize);
+		break;
 	default:
 		/* noone of simple commands */
 		handled = false;
@@ -572,6 +600,8 @@ int TunerStudio::handleCrcCommand(TsChannelBase* tsChannel, char *data, size_t i
 		case TS_CHUNK_WRITE_COMMAND:
 			if (header->page == 0)
 				handleWriteChunkCommand(tsChannel, TS_CRC, header->offset, header->count, data + sizeof(TunerStudioDataPacketHeader));
+			else if (SWAP_UINT16(header->page) == TS_PAGE_SCOPE)
+				handleScopeWriteCommand(tsChannel, header->offset, header->count, data + sizeof(TunerStudioDataPacketHeader));
 			else
 				handleScatterListWriteCommand(tsChannel, header->offset, header->count, data + sizeof(TunerStudioDataPacketHeader));
 			break;
@@ -584,6 +614,8 @@ int TunerStudio::handleCrcCommand(TsChannelBase* tsChannel, char *data, size_t i
 		case TS_READ_COMMAND:
 			if (header->page == 0)
 				handlePageReadCommand(tsChannel, TS_CRC, header->offset, header->count);
+			else if (SWAP_UINT16(header->page) == TS_PAGE_SCOPE)
+				handleScopeReadCommand(tsChannel, header->offset, header->count);
 			else
 				handleScatterListReadCommand(tsChannel, header->offset, header->count);
 			break;
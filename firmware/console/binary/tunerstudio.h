@@ -20,8 +20,12 @@ typedef struct {
 	int totalCounter;
 	int textCommandCounter;
 	int testCommandCounter;
+	int sampleStreamCommandCounter;
+	int profileCommandCounter;
 } tunerstudio_counters_s;
 
+extern tunerstudio_counters_s tsState;
+
 void tunerStudioDebug(TsChannelBase* tsChannel, const char *msg);
 void tunerStudioError(TsChannelBase* tsChannel, const char *msg);
 
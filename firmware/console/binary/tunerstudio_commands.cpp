@@ -5,37 +5,42 @@
 
 /* configuration */
 #include "port.h"
+#include "sample_stream.h"
+#include "sensor_scope.h"
+#include "livedata.h"
+#include "sampling.h"
 
 #include <cstring>
 
-#include <rusefi/crc.h>
-#include <rusefi/fragments.h>
+#include "fast_crc.h"
 
 void sendErrorCode(TsChannelBase *tsChannel, uint8_t code);
 void sendOkResponse(TsChannelBase *tsChannel, ts_response_format_e mode);
 
-FragmentList getFragments();
+/* TS reads the output channels in blockingFactor (TS_READ_BLOCKING_FACTOR) chunks */
+static_assert(LIVEDATA_SIZE <= TS_READ_BLOCKING_FACTOR, "output channels no longer fit one read");
 
 /**
  * @brief 'Output' command sends out a snapshot of current values
  * Gauges refresh
  */
 void TunerStudio::cmdOutputChannels(TsChannelBase* tsChannel, uint16_t offset, uint16_t count) {
-	// TODO: check against total framents size
-//	if (offset + count > TS_TOTAL_OUTPUT_SIZE) {
-//		sendErrorCode(tsChannel, TS_RESPONSE_OUT_OF_RANGE);
-//		return;
-//	}
+	if (offset + count > LIVEDATA_SIZE) {
+		sendErrorCode(tsChannel, TS_RESPONSE_OUT_OF_RANGE);
+		return;
+	}
 
-	tsChannel->assertPacketSize(count, false);
 	// this method is invoked too often to print any debug information
-	uint8_t * scratchBuffer = (uint8_t *)tsChannel->scratchBuffer;
-	/**
-	 * collect data from all models
-	 */
-	copyRange(scratchBuffer + 3, getFragments(), offset, count);
 
-	tsChannel->crcAndWriteBuffer(TS_RESPONSE_OK, count);
+	/* the image stays untouched until released, send it straight from there.
+	 * Nothing is staged in scratchBuffer, so the whole image may go in one packet */
+	tsChannel->assertPacketSize(count, true);
+	const uint8_t* image = LiveDataAcquire();
+	tsChannel->writeHeader(TS_RESPONSE_OK, count);
+	tsChannel->writeBody(image + offset, count);
+	tsChannel->writeTail();
+	tsChannel->flush();
+	LiveDataRelease(image);
 }
 
 // Validate whether the specified offset and count would cause an overrun in the tune.
@@ -47,16 +52,15 @@ bool TunerStudio::validateScatterOffsetCount(size_t offset, size_t count) {
 }
 
 void TunerStudio::handleScatteredReadCommand(TsChannelBase* tsChannel) {
+	const uint8_t* image = LiveDataAcquire();
+
 #ifdef HIGH_SPEED_OPTIMIZED
-	uint8_t *buffer = (uint8_t *)tsChannel->scratchBuffer;
 	tsChannel->writeHeader(TS_RESPONSE_OK, highSpeedTotalSize);
 	for (size_t i = 0; i < highSpeedChunks; i++) {
-		chDbgAssert(NULL != highSpeedPtrs[i], "NULL pointer in scatter list");
-		// copy to temp buffer to avoid changes before transmission, couse it can affect CRC
-		memcpy(buffer, highSpeedPtrs[i], highSpeedSizes[i]);
-		tsChannel->writeBody(buffer, highSpeedSizes[i]);
+		tsChannel->writeBody(image + highSpeedImageOffsets[i], highSpeedSizes[i]);
 	}
 	tsChannel->writeTail();
+	tsChannel->flush();
 #else
 	size_t count = 0;
 	uint8_t *buffer = (uint8_t *)tsChannel->scratchBuffer + 3;	/* reserve 3 bytes for header */
@@ -70,12 +74,13 @@ void TunerStudio::handleScatteredReadCommand(TsChannelBase* tsChannel) {
 		int size = 1 << (type - 1);
 
 		int offset = packed & 0x1FFF;
-		// write each data point and CRC incrementally
-		copyRange(buffer + count, getFragments(), offset, size);
+		memcpy(buffer + count, image + offset, size);
 		count += size;
 	}
 	tsChannel->crcAndWriteBuffer(TS_RESPONSE_OK, count);
 #endif
+
+	LiveDataRelease(image);
 }
 
 void TunerStudio::handleScatterListWriteCommand(TsChannelBase* tsChannel, uint16_t offset, uint16_t count, void *content)
@@ -83,10 +88,13 @@ void TunerStudio::handleScatterListWriteCommand(TsChannelBase* tsChannel, uint16
 	uint8_t * addr = (uint8_t *)highSpeedOffsets + offset;
 	memcpy(addr, content, count);
 
+	bool valid = true;
+
 #ifdef HIGH_SPEED_OPTIMIZED
 	highSpeedChunks = 0;
 	highSpeedTotalSize = 0;
-	/* translate to CPU pointers */
+#endif
+
 	for (int i = 0; i < HIGH_SPEED_COUNT; i++) {
 		int packed = highSpeedOffsets[i];
 		int type = packed >> 13;
@@ -96,29 +104,34 @@ void TunerStudio::handleScatterListWriteCommand(TsChannelBase* tsChannel, uint16
 
 		int size = 1 << (type - 1);
 		int offset = packed & 0x1FFF;
+
+		if (offset + size > LIVEDATA_SIZE) {
+			/* drop it rather than read past the image */
+			highSpeedOffsets[i] = 0;
+			valid = false;
+			continue;
+		}
+
+#ifdef HIGH_SPEED_OPTIMIZED
 		highSpeedTotalSize += size;
 
-		uint8_t *ptr;
-
-		do {
-			size_t availSize = getRangePtr(&ptr, getFragments(), offset, size);
-
-			/* note: no need to check ptr for NULL */
-			if ((highSpeedChunks == 0) ||	/* first chunk */
-				((highSpeedChunks > 0) &&
-				 (highSpeedPtrs[highSpeedChunks - 1] + highSpeedSizes[highSpeedChunks - 1] != ptr))) /* or not contiguous chunks */ {
-				highSpeedPtrs[highSpeedChunks] = ptr;
-				highSpeedSizes[highSpeedChunks] = size;
-				highSpeedChunks++;
-			} else {
-				/* unite */
-				highSpeedSizes[highSpeedChunks - 1] += size;
-			}
-		size -= availSize;
-		offset += availSize;
-		} while (size);
-	}
+		/* the image is contiguous, merge with the previous chunk if adjacent */
+		if ((highSpeedChunks > 0) &&
+			(highSpeedImageOffsets[highSpeedChunks - 1] + highSpeedSizes[highSpeedChunks - 1] == (size_t)offset)) {
+			highSpeedSizes[highSpeedChunks - 1] += size;
+		} else {
+			highSpeedImageOffsets[highSpeedChunks] = offset;
+			highSpeedSizes[highSpeedChunks] = size;
+			highSpeedChunks++;
+		}
 #endif
+	}
+
+	if (!valid) {
+		tunerStudioError(tsChannel, "ERROR: out of range");
+		sendErrorCode(tsChannel, TS_RESPONSE_OUT_OF_RANGE);
+		return;
+	}
 
 	sendOkResponse(tsChannel, TS_CRC);
 }
@@ -146,6 +159,105 @@ void TunerStudio::handleScatterListCrc32Check(TsChannelBase *tsChannel, uint16_t
 
 	const uint8_t* start = (uint8_t *)highSpeedOffsets + offset;
 
-	uint32_t crc = SWAP_UINT32(crc32(start, count));
+	uint32_t crc = SWAP_UINT32(FastCrc32(start, count));
 	tsChannel->sendResponse(TS_CRC, (const uint8_t *) &crc, 4);
 }
+
+/**
+ * 'x' [channel mask] [decimation] starts (or with a zero mask stops) streaming raw samples,
+ * a bare 'x' reads the next chunk. Both reply with a SampleStreamHeader and the records
+ * buffered since the previous read, the host keeps polling to get a continuous trace.
+ * The stream belongs to the channel that configured it last, any other gets an error.
+ */
+void TunerStudio::handleSampleStreamCommand(TsChannelBase* tsChannel, char *data, size_t incomingPacketSize)
+{
+	tsState.sampleStreamCommandCounter++;
+
+	auto& stream = GetSampleStream();
+
+	if (incomingPacketSize >= 3 && !stream.Configure(data[1], data[2], tsChannel)) {
+		tunerStudioError(tsChannel, "ERROR: sample stream busy");
+		sendErrorCode(tsChannel, TS_RESPONSE_OUT_OF_RANGE);
+		return;
+	}
+
+	uint8_t *buffer = (uint8_t *)tsChannel->scratchBuffer + 3;	/* reserve 3 bytes for header */
+	size_t size = stream.Read(buffer, BLOCKING_FACTOR, tsChannel);
+
+	// Streaming to another channel
+	if (size == 0) {
+		tunerStudioError(tsChannel, "ERROR: sample stream busy");
+		sendErrorCode(tsChannel, TS_RESPONSE_OUT_OF_RANGE);
+		return;
+	}
+
+	tsChannel->crcAndWriteBuffer(TS_RESPONSE_OK, size);
+}
+
+/**
+ * Sampling thread cycle profile, see CycleProfiler::Report()
+ * Ports without a cycle counter profile nothing and don't know the command.
+ */
+void TunerStudio::handleProfileCommand(TsChannelBase* tsChannel, char *data, size_t incomingPacketSize)
+{
+	tsState.profileCommandCounter++;
+
+#if PORT_SUPPORTS_RT
+	bool reset = incomingPacketSize >= 2 && data[1];
+
+	uint8_t *buffer = (uint8_t *)tsChannel->scratchBuffer + 3;	/* reserve 3 bytes for header */
+	size_t size = GetSamplingProfile(buffer, BLOCKING_FACTOR, reset);
+
+	tsChannel->crcAndWriteBuffer(TS_RESPONSE_OK, size);
+#else
+	(void)data;
+	(void)incomingPacketSize;
+
+	sendErrorCode(tsChannel, TS_RESPONSE_UNRECOGNIZED_COMMAND);
+#endif
+}
+
+/**
+ * Sensor scope page: a ScopeControl block followed by the captured records, oldest first.
+ * Only the host settings at the start of the control block are writable.
+ */
+void TunerStudio::handleScopeReadCommand(TsChannelBase* tsChannel, uint16_t offset, uint16_t count)
+{
+	tsState.readPageCommandsCounter++;
+
+	auto& scope = GetSensorScope();
+
+	if (count > TS_READ_BLOCKING_FACTOR || offset + count > scope.GetPageSize()) {
+		tunerStudioError(tsChannel, "ERROR: out of range");
+		sendErrorCode(tsChannel, TS_RESPONSE_OUT_OF_RANGE);
+		return;
+	}
+
+	/* the page isn't contiguous in RAM, stream it through a small buffer */
+	uint8_t chunk[32];
+	tsChannel->writeHeader(TS_RESPONSE_OK, count);
+	for (size_t done = 0; done < count; ) {
+		size_t size = count - done;
+		if (size > sizeof(chunk))
+			size = sizeof(chunk);
+
+		scope.ReadPage(offset + done, chunk, size);
+		tsChannel->writeBody(chunk, size);
+		done += size;
+	}
+	tsChannel->writeTail();
+	tsChannel->flush();
+}
+
+void TunerStudio::handleScopeWriteCommand(TsChannelBase* tsChannel, uint16_t offset, uint16_t count, void *content)
+{
+	tsState.writeChunkCommandCounter++;
+
+	if (!GetSensorScope().WritePage(offset, (const uint8_t *)content, count)) {
+		tunerStudioError(tsChannel, "ERROR: out of range");
+		sendErrorCode(tsChannel, TS_RESPONSE_OUT_OF_RANGE);
+		return;
+	}
+
+	sendOkResponse(tsChannel, TS_CRC);
+}
@@ -44,6 +44,13 @@ public:
 	void handleScatterListWriteCommand(TsChannelBase* tsChannel, uint16_t offset, uint16_t count, void *content);
 	void handleScatterListReadCommand(TsChannelBase* tsChannel, uint16_t offset, uint16_t count);
 	void handleScatterListCrc32Check(TsChannelBase *tsChannel, uint16_t offset, uint16_t count);
+	// Raw sample streaming
+	void handleSampleStreamCommand(TsChannelBase* tsChannel, char *data, size_t incomingPacketSize);
+	// Sampling thread cycle profile
+	void handleProfileCommand(TsChannelBase* tsChannel, char *data, size_t incomingPacketSize);
+	// Sensor scope capture page
+	void handleScopeReadCommand(TsChannelBase* tsChannel, uint16_t offset, uint16_t count);
+	void handleScopeWriteCommand(TsChannelBase* tsChannel, uint16_t offset, uint16_t count, void *content);
 
 private:
 	void sendErrorCode(TsChannelBase* tsChannel, uint8_t code);
@@ -51,7 +58,8 @@ private:
 	bool validateScatterOffsetCount(size_t offset, size_t count);
 	uint16_t highSpeedOffsets[HIGH_SPEED_COUNT];
 #ifdef HIGH_SPEED_OPTIMIZED
-	uint8_t *highSpeedPtrs[HIGH_SPEED_COUNT];
+	/* offsets into the livedata image, adjacent entries merged */
+	uint16_t highSpeedImageOffsets[HIGH_SPEED_COUNT];
 	size_t highSpeedSizes[HIGH_SPEED_COUNT];
 	size_t highSpeedChunks;
 	size_t highSpeedTotalSize;
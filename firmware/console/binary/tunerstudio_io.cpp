@@ -11,7 +11,9 @@
 #include "tunerstudio_io.h"
 #include "byteswap.h"
 
-#include <rusefi/crc.h>
+#include "fast_crc.h"
+
+ts_io_counters_s tsIoCounters;
 
 size_t TsChannelBase::read(uint8_t* buffer, size_t size) {
 	return readTimeout(buffer, size, SR5_READ_TIMEOUT);
@@ -46,7 +48,7 @@ void TsChannelBase::crcAndWriteBuffer(uint8_t responseCode, size_t size) {
 	scratchBuffer[2] = responseCode;
 
 	// CRC is computed on the responseCode and payload but not length
-	uint32_t crc = crc32(&scratchBuffer[2], size + 1); // command part of CRC
+	uint32_t crc = FastCrc32(&scratchBuffer[2], size + 1); // command part of CRC
 
 	// Place the CRC at the end
 	*reinterpret_cast<uint32_t*>(&scratchBuffer[size + 3]) = SWAP_UINT32(crc);
@@ -67,7 +69,7 @@ int TsChannelBase::writeHeader(uint8_t responseCode, size_t size)
 
 	// start calculating CRC
 	// CRC is computed on the responseCode and payload but not length
-	crcAcc = crc32(&buffer[2], sizeof(buffer) - 2);
+	crcAcc = FastCrc32(&buffer[2], sizeof(buffer) - 2);
 	// save packet size
 	packetSize = size; 	/* + 3 bytes for head + 4 bytes of CRC */
 
@@ -77,11 +79,11 @@ int TsChannelBase::writeHeader(uint8_t responseCode, size_t size)
 	return sizeof(buffer);
 }
 
-int TsChannelBase::writeBody(uint8_t *buffer, size_t size)
+int TsChannelBase::writeBody(const uint8_t *buffer, size_t size)
 {
 	chDbgAssert(size <= packetSize, "writeBody packet size is more than provided in header");
 	// append CRC
-	crcAcc = crc32inc(buffer, crcAcc, size);
+	crcAcc = FastCrc32Inc(buffer, crcAcc, size);
 	// adjust packet size
 	packetSize -= size;
 
@@ -107,28 +109,16 @@ int TsChannelBase::writeTail(void)
 }
 
 void TsChannelBase::writeCrcPacketLarge(uint8_t responseCode, const uint8_t* buf, size_t size) {
-	uint8_t headerBuffer[3];
-	uint8_t crcBuffer[4];
-
-	*(uint16_t*)headerBuffer = SWAP_UINT16(size + 1);
-	*(uint8_t*)(headerBuffer + 2) = responseCode;
-
-	// Command part of CRC
-	uint32_t crc = crc32((void*)(headerBuffer + 2), 1);
-	// Data part of CRC
-	crc = crc32inc((void*)buf, crc, size);
-	*(uint32_t*)crcBuffer = SWAP_UINT32(crc);
-
-	// Write header
-	write(headerBuffer, sizeof(headerBuffer), false);
+	// Send straight from buf, the CRC is accumulated as the body goes out
+	writeHeader(responseCode, size);
 
 	// If data, write that
 	if (size) {
-		write(buf, size, false);
+		writeBody(buf, size);
 	}
 
 	// Lastly the CRC footer
-	write(crcBuffer, sizeof(crcBuffer), true);
+	writeTail();
 	flush();
 }
 
@@ -14,13 +14,21 @@
 #include "tunerstudio_impl.h"
 
 /* TODO: find better place */
+/* Largest packet staged in scratchBuffer: incoming commands (page writes) and small replies.
+ * Replies that go through crcAndWriteBuffer(), copyAndWriteSmallCrcPacket() or
+ * sendResponse() without allowLongPackets must stay within this: scatter list,
+ * CRCs, sample stream and profile chunks, version and signature */
 #define BLOCKING_FACTOR 256
+/* Largest page or output channel read reply. Those are streamed from the source with a
+ * running CRC instead of being staged, so a larger value costs no RAM. See 'blockingFactor' in the ini */
+#define TS_READ_BLOCKING_FACTOR 2048
 
 #define TS_BURN_COMMAND 'B'
 #define TS_CHUNK_WRITE_COMMAND 'C'
 #define TS_COMMAND_F 'F'
 #define TS_CRC_CHECK_COMMAND 'k'
 #define TS_GET_FIRMWARE_VERSION 'V'
+#define TS_GET_BLOCKING_FACTOR_COMMAND 'f'
 #define TS_HELLO_COMMAND 'S'
 #define TS_OUTPUT_COMMAND 'O'
 #define TS_PROTOCOL "001"
@@ -29,6 +37,12 @@
 #define TS_TEST_COMMAND 't'
 #define TS_GET_SCATTERED_GET_COMMAND '9'
 #define TS_IO_TEST_COMMAND 'Z'
+#define TS_SAMPLE_STREAM_COMMAND 'x'
+// Sampling thread cycle profile, optional u8 argument: non-zero resets it after the read
+#define TS_PROFILE_COMMAND 'y'
+
+/* page 0 is the configuration, 1 the scatter list */
+#define TS_PAGE_SCOPE 2
 
 #define TS_RESPONSE_BURN_OK 4
 #define TS_RESPONSE_COMMAND_OK 7
@@ -39,6 +53,18 @@
 #define TS_RESPONSE_UNDERRUN 0x80
 #define TS_RESPONSE_UNRECOGNIZED_COMMAND 0x83
 
+/* DMA receive ring of UartTsChannel, holds more than one full incoming packet */
+#define TS_UART_RX_RING_SIZE 512
+
+/* Port interrupts and bytes moved, totals over all TS channels */
+typedef struct {
+	uint32_t interrupts;
+	uint32_t rxBytes;
+	uint32_t txBytes;
+} ts_io_counters_s;
+
+extern ts_io_counters_s tsIoCounters;
+
 class TsChannelBase {
 public:
 	TsChannelBase(const char *name);
@@ -73,7 +99,7 @@ public:
 	void copyAndWriteSmallCrcPacket(uint8_t responseCode, const uint8_t* buf, size_t size);
 
 	int writeHeader(uint8_t responseCode, size_t size);
-	int writeBody(uint8_t *buffer, size_t size);
+	int writeBody(const uint8_t *buffer, size_t size);
 	int writeTail(void);
 
 private:
@@ -119,6 +145,8 @@ private:
 
 #if HAL_USE_UART
 // This class implements a ChibiOS UART Driver
+// RX is a DMA ring that keeps running between reads, the reader is woken
+// by the idle line interrupt. TX is one DMA transfer per write.
 class UartTsChannel : public SerialTsChannelBase {
 public:
 	UartTsChannel(UARTDriver& driver) : SerialTsChannelBase("UART"), m_driver(&driver) { }
@@ -131,11 +159,66 @@ public:
 	size_t readTimeout(uint8_t* buffer, size_t size, int timeout) override;
 
 protected:
+	// Lets the driver callbacks find their channel
+	struct Config : UARTConfig {
+		UartTsChannel* channel;
+	};
+
 	UARTDriver* const m_driver;
-	UARTConfig m_config;
+	Config m_config;
+
+private:
+	static UartTsChannel* fromDriver(UARTDriver* uartp);
+	static void rxEndCb(UARTDriver* uartp);
+	static void rxIdleCb(UARTDriver* uartp);
+	static void rxErrorCb(UARTDriver* uartp, uartflags_t e);
+	static void txEndCb(UARTDriver* uartp);
+
+	// Where DMA writes the next byte
+	size_t rxHead() const;
+
+	binary_semaphore_t m_rxSem;
+	size_t m_rxTail = 0;
+	uint8_t m_rxRing[TS_UART_RX_RING_SIZE];
 };
 #endif // HAL_USE_UART
 
+#ifdef EFI_CAN_SERIAL
+#include "isotp.h"
+
+// Frames the CAN Rx thread hands over before the TS thread gets to them
+#define CAN_TS_RX_QUEUE 8
+
+// TunerStudio over ISO-TP on the ECU's CAN bus, see WB_TS_* in wideband_can.h
+// Each write() goes out as one ISO-TP message.
+class CanTsChannel : public TsChannelBase, private IIsoTpLink {
+public:
+	CanTsChannel();
+
+	void write(const uint8_t* buffer, size_t size, bool isEndOfPacket) override;
+	size_t readTimeout(uint8_t* buffer, size_t size, int timeout) override;
+
+	// From the CAN Rx thread, false if the queue is full
+	bool queueFrame(const uint8_t* data, uint8_t length);
+
+private:
+	bool Transmit(const IsoTpFrame& frame) override;
+	bool Receive(IsoTpFrame& frame, int timeout) override;
+	void DelayUs(uint32_t us) override;
+
+	IsoTp m_isoTp;
+
+	binary_semaphore_t m_rxSem;
+	IsoTpFrame m_rxQueue[CAN_TS_RX_QUEUE];
+	size_t m_rxHead = 0;
+	size_t m_rxCount = 0;
+};
+
+void startCanTsChannel();
+// Takes frames addressed to the TS channel, returns false for anything else
+bool canTsFrameReceived(const CANRxFrame& frame);
+#endif // EFI_CAN_SERIAL
+
 #define CRC_VALUE_SIZE 4
 // todo: double-check this
 #define CRC_WRAPPING_SIZE (CRC_VALUE_SIZE + 3)
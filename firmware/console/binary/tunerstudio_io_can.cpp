@@ -0,0 +1,117 @@
+/**
+ * TunerStudio over ISO-TP on CAN
+ */
+
+#include <string.h>
+
+#include "tunerstudio.h"
+#include "tunerstudio_io.h"
+#include "can.h"
+#include "can_helper.h"
+#include "port.h"
+
+#include "../for_rusefi/wideband_can.h"
+
+#ifdef EFI_CAN_SERIAL
+
+/* follows the index set over CAN, same as the data frames */
+static uint32_t canTsIdOffset() {
+	return GetConfiguration()->afr[0].RusEfiIdx;
+}
+
+CanTsChannel::CanTsChannel() : TsChannelBase("CAN"), m_isoTp(*this) {
+	chBSemObjectInit(&m_rxSem, true);
+}
+
+bool CanTsChannel::queueFrame(const uint8_t* data, uint8_t length) {
+	chSysLock();
+
+	if (m_rxCount == CAN_TS_RX_QUEUE) {
+		chSysUnlock();
+		/* lost frame, ISO-TP sequence check drops the message */
+		return false;
+	}
+
+	IsoTpFrame& frame = m_rxQueue[(m_rxHead + m_rxCount) % CAN_TS_RX_QUEUE];
+	frame.Length = length > sizeof(frame.Data) ? sizeof(frame.Data) : length;
+	memcpy(frame.Data, data, frame.Length);
+	m_rxCount++;
+
+	chBSemSignalI(&m_rxSem);
+	chSchRescheduleS();
+	chSysUnlock();
+
+	return true;
+}
+
+bool CanTsChannel::Receive(IsoTpFrame& frame, int timeout) {
+	chSysLock();
+
+	while (!m_rxCount) {
+		if (chBSemWaitTimeoutS(&m_rxSem, timeout) != MSG_OK) {
+			chSysUnlock();
+			return false;
+		}
+	}
+
+	frame = m_rxQueue[m_rxHead];
+	m_rxHead = (m_rxHead + 1) % CAN_TS_RX_QUEUE;
+	m_rxCount--;
+
+	chSysUnlock();
+
+	return true;
+}
+
+bool CanTsChannel::Transmit(const IsoTpFrame& frame) {
+	CanTxMessage msg(WB_TS_TX_BASE + canTsIdOffset(), frame.Length, true);
+
+	for (size_t i = 0; i < frame.Length; i++) {
+		msg[i] = frame.Data[i];
+	}
+
+	/* sent when msg goes out of scope */
+	return true;
+}
+
+void CanTsChannel::DelayUs(uint32_t us) {
+	chThdSleepMicroseconds(us);
+}
+
+void CanTsChannel::write(const uint8_t* buffer, size_t size, bool) {
+	if (!m_isoTp.Send(buffer, size, BINARY_IO_TIMEOUT)) {
+		tsState.errorCounter++;
+	}
+}
+
+size_t CanTsChannel::readTimeout(uint8_t* buffer, size_t size, int timeout) {
+	return m_isoTp.Receive(buffer, size, timeout);
+}
+
+static CanTsChannel canChannel;
+
+bool canTsFrameReceived(const CANRxFrame& frame) {
+	if (!CAN_EXT(frame) || CAN_ID(frame) != WB_TS_RX_BASE + canTsIdOffset()) {
+		return false;
+	}
+
+	canChannel.queueFrame(frame.data8, frame.DLC);
+
+	return true;
+}
+
+struct CanChannelThread : public TunerstudioThread {
+	CanChannelThread() : TunerstudioThread("CAN TS Channel") { }
+
+	TsChannelBase* setupChannel() {
+		return &canChannel;
+	}
+};
+
+static CanChannelThread canChannelThread;
+
+void startCanTsChannel() {
+	canChannelThread.Start();
+}
+
+#endif // EFI_CAN_SERIAL
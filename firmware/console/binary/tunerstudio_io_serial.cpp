@@ -242,48 +242,159 @@ void SerialTsChannel::stop() {
 }
 
 void SerialTsChannel::write(const uint8_t* buffer, size_t size, bool) {
-	chnWriteTimeout(m_driver, buffer, size, BINARY_IO_TIMEOUT);
+	size = chnWriteTimeout(m_driver, buffer, size, BINARY_IO_TIMEOUT);
+
+	/* one TXE interrupt per byte, plus TC at the end */
+	chSysLock();
+	tsIoCounters.txBytes += size;
+	tsIoCounters.interrupts += size + 1;
+	chSysUnlock();
 }
 
 size_t SerialTsChannel::readTimeout(uint8_t* buffer, size_t size, int timeout) {
-	return chnReadTimeout(m_driver, buffer, size, timeout);
+	size = chnReadTimeout(m_driver, buffer, size, timeout);
+
+	/* one RXNE interrupt per byte */
+	chSysLock();
+	tsIoCounters.rxBytes += size;
+	tsIoCounters.interrupts += size;
+	chSysUnlock();
+
+	return size;
 }
 #endif // HAL_USE_SERIAL
 
 #if (HAL_USE_UART == TRUE) && (UART_USE_WAIT == TRUE)
+UartTsChannel* UartTsChannel::fromDriver(UARTDriver* uartp) {
+	return static_cast<const Config*>(uartp->config)->channel;
+}
+
+/* DMA filled the whole ring, start over at the beginning */
+void UartTsChannel::rxEndCb(UARTDriver* uartp) {
+	auto channel = fromDriver(uartp);
+
+	chSysLockFromISR();
+	tsIoCounters.interrupts++;
+	uartStartReceiveI(uartp, sizeof(channel->m_rxRing), channel->m_rxRing);
+	chBSemSignalI(&channel->m_rxSem);
+	chSysUnlockFromISR();
+}
+
+/* line went idle after a burst, the packet (or what we have of it) is in the ring */
+void UartTsChannel::rxIdleCb(UARTDriver* uartp) {
+	auto channel = fromDriver(uartp);
+
+	chSysLockFromISR();
+	tsIoCounters.interrupts++;
+	chBSemSignalI(&channel->m_rxSem);
+	chSysUnlockFromISR();
+}
+
+/* framing/noise errors, DMA keeps going and the CRC catches the damage */
+void UartTsChannel::rxErrorCb(UARTDriver*, uartflags_t) {
+	chSysLockFromISR();
+	tsIoCounters.interrupts++;
+	chSysUnlockFromISR();
+}
+
+void UartTsChannel::txEndCb(UARTDriver*) {
+	chSysLockFromISR();
+	tsIoCounters.interrupts++;
+	chSysUnlockFromISR();
+}
+
+size_t UartTsChannel::rxHead() const {
+	/* remaining count of the running transfer, the ring wraps when it hits zero */
+	size_t remaining = dmaStreamGetTransactionSize(m_driver->dmarx);
+
+	return (sizeof(m_rxRing) - remaining) % sizeof(m_rxRing);
+}
+
 int UartTsChannel::start(uint32_t newBaud) {
-	m_config.txend1_cb 		= NULL;
+	m_config.txend1_cb 		= txEndCb;
 	m_config.txend2_cb 		= NULL;
-	m_config.rxend_cb 		= NULL;
+	m_config.rxend_cb 		= rxEndCb;
 	m_config.rxchar_cb		= NULL;
-	m_config.rxerr_cb		= NULL;
-	m_config.timeout_cb		= NULL;
+	m_config.rxerr_cb		= rxErrorCb;
+	m_config.timeout_cb		= rxIdleCb;
 	m_config.speed 			= newBaud;
-	m_config.cr1 			= 0;
+	m_config.cr1 			= USART_CR1_IDLEIE;
 	m_config.cr2 			= 0/*USART_CR2_STOP1_BITS*/ | USART_CR2_LINEN;
 	m_config.cr3 			= 0;
+	m_config.channel		= this;
+
+	chBSemObjectInit(&m_rxSem, true);
+	m_rxTail = 0;
 
 	uartStart(m_driver, &m_config);
 
+	/* receive runs from now on, readTimeout just catches up with it */
+	chSysLock();
+	uartStartReceiveI(m_driver, sizeof(m_rxRing), m_rxRing);
+	chSysUnlock();
+
 	return 0;
 }
 
 int UartTsChannel::reStart() {
 	stop();
 	/* TODO: add BT setup? */
-	start(baud);
+	start(m_config.speed);
+
+	return 0;
 }
 
 void UartTsChannel::stop() {
+	uartStopReceive(m_driver);
 	uartStop(m_driver);
 }
 
 void UartTsChannel::write(const uint8_t* buffer, size_t size, bool) {
+	if (!size) {
+		return;
+	}
+
+	/* whole buffer in one DMA transfer, we sleep until it is out */
 	uartSendTimeout(m_driver, &size, buffer, BINARY_IO_TIMEOUT);
+
+	chSysLock();
+	tsIoCounters.txBytes += size;
+	chSysUnlock();
 }
 
 size_t UartTsChannel::readTimeout(uint8_t* buffer, size_t size, int timeout) {
-	uartReceiveTimeout(m_driver, &size, buffer, timeout);
-	return size;
+	size_t done = 0;
+	systime_t start = chVTGetSystemTime();
+
+	while (true) {
+		size_t head = rxHead();
+
+		while (done < size && m_rxTail != head) {
+			/* copy up to the head or the end of the ring, whichever comes first */
+			size_t chunk = (head > m_rxTail ? head : sizeof(m_rxRing)) - m_rxTail;
+			if (chunk > size - done)
+				chunk = size - done;
+
+			memcpy(buffer + done, m_rxRing + m_rxTail, chunk);
+			done += chunk;
+			m_rxTail = (m_rxTail + chunk) % sizeof(m_rxRing);
+		}
+
+		if (done == size)
+			break;
+
+		sysinterval_t elapsed = chVTTimeElapsedSinceX(start);
+		if (elapsed >= (sysinterval_t)timeout)
+			break;
+
+		/* sleep until the line goes idle or the ring wraps */
+		chBSemWaitTimeout(&m_rxSem, (sysinterval_t)timeout - elapsed);
+	}
+
+	chSysLock();
+	tsIoCounters.rxBytes += done;
+	chSysUnlock();
+
+	return done;
 }
 #endif // HAL_USE_UART
@@ -0,0 +1,125 @@
+#include "cycle_profiler.h"
+
+#include <cstring>
+
+void CycleStageStats::Add(uint32_t cycles)
+{
+    if (Count == 0 || cycles < Min)
+    {
+        Min = cycles;
+    }
+
+    if (cycles > Max)
+    {
+        Max = cycles;
+    }
+
+    Sum += cycles;
+    Count++;
+
+    // Bit length of cycles, less the part below the first bucket
+    size_t bucket = 0;
+    for (uint32_t c = cycles >> PROFILER_HISTOGRAM_SHIFT; c; c >>= 1)
+    {
+        bucket++;
+    }
+
+    if (bucket >= PROFILER_HISTOGRAM_BUCKETS)
+    {
+        bucket = PROFILER_HISTOGRAM_BUCKETS - 1;
+    }
+
+    if (Histogram[bucket] == UINT16_MAX)
+    {
+        for (auto& h : Histogram)
+        {
+            h /= 2;
+        }
+    }
+
+    Histogram[bucket]++;
+}
+
+CycleProfiler::CycleProfiler(size_t stages)
+    : m_stages(stages < PROFILER_MAX_STAGES ? stages : PROFILER_MAX_STAGES)
+{
+    Reset();
+}
+
+void CycleProfiler::Reset()
+{
+    memset(m_stats, 0, sizeof(m_stats));
+}
+
+void CycleProfiler::Begin(uint32_t now)
+{
+    if (m_resetRequested)
+    {
+        m_resetRequested = false;
+        Reset();
+    }
+
+    m_begin = now;
+    m_last = now;
+}
+
+void CycleProfiler::Mark(size_t stage, uint32_t now)
+{
+    if (stage < m_stages)
+    {
+        m_stats[stage].Add(now - m_last);
+    }
+
+    m_last = now;
+}
+
+void CycleProfiler::End()
+{
+    m_stats[m_stages].Add(m_last - m_begin);
+}
+
+static uint8_t* PutU16(uint8_t* p, uint16_t value)
+{
+    p[0] = value & 0xFF;
+    p[1] = value >> 8;
+    return p + 2;
+}
+
+static uint8_t* PutU32(uint8_t* p, uint32_t value)
+{
+    p = PutU16(p, value & 0xFFFF);
+    return PutU16(p, value >> 16);
+}
+
+size_t CycleProfiler::Report(uint8_t* buffer, size_t size) const
+{
+    size_t length = 4 + (m_stages + 1) * PROFILER_STAGE_REPORT_SIZE;
+
+    if (length > size)
+    {
+        return 0;
+    }
+
+    uint8_t* p = buffer;
+    *p++ = m_stages + 1;
+    *p++ = PROFILER_HISTOGRAM_BUCKETS;
+    *p++ = PROFILER_HISTOGRAM_SHIFT;
+    *p++ = 0;
+
+    for (size_t i = 0; i <= m_stages; i++)
+    {
+        const auto& s = m_stats[i];
+
+        p = PutU32(p, s.Min);
+        p = PutU32(p, s.Count ? s.Sum / s.Count : 0);
+        p = PutU32(p, s.Max);
+        p = PutU32(p, s.Count);
+
+        for (auto h : s.Histogram)
+        {
+            p = PutU16(p, h);
+        }
+    }
+
+    return length;
+}
@@ -0,0 +1,81 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+
+#include "wideband_config.h"
+
+// Per stage record in a CycleProfiler report
+#define PROFILER_STAGE_REPORT_SIZE (16 + 2 * PROFILER_HISTOGRAM_BUCKETS)
+
+struct CycleStageStats
+{
+    uint32_t Min;
+    uint32_t Max;
+    uint64_t Sum;
+    uint32_t Count;
+    // Relative, all buckets are halved when one fills up
+    uint16_t Histogram[PROFILER_HISTOGRAM_BUCKETS];
+
+    void Add(uint32_t cycles);
+};
+
+/**
+ * Times the stages of a loop from a free running cycle counter, the DWT
+ * CYCCNT on target or anything counting on the host.
+ *
+ *   Begin(now), Mark(0, now), Mark(1, now) ... End()
+ *
+ * Each Mark() charges the time since the previous Begin()/Mark() to its
+ * stage, End() charges Begin() to the last Mark() to the total.
+ */
+class CycleProfiler
+{
+public:
+    explicit CycleProfiler(size_t stages);
+
+    void Begin(uint32_t now);
+    void Mark(size_t stage, uint32_t now);
+    void End();
+
+    // Safe from another thread, takes effect on the next Begin()
+    void RequestReset()
+    {
+        m_resetRequested = true;
+    }
+
+    size_t GetStageCount() const
+    {
+        return m_stages;
+    }
+
+    // stage == GetStageCount() is the total
+    const CycleStageStats& GetStage(size_t stage) const
+    {
+        return m_stats[stage];
+    }
+
+    /**
+     * Little endian report, returns its length or 0 if it doesn't fit:
+     *
+     *   u8   stage count, including the total which comes last
+     *   u8   PROFILER_HISTOGRAM_BUCKETS
+     *   u8   PROFILER_HISTOGRAM_SHIFT
+     *   u8   reserved
+     *   per stage:
+     *     u32  min, avg, max cycles, all 0 if never run
+     *     u32  passes counted
+     *     u16  histogram[PROFILER_HISTOGRAM_BUCKETS]
+     */
+    size_t Report(uint8_t* buffer, size_t size) const;
+
+private:
+    void Reset();
+
+    size_t m_stages;
+    uint32_t m_begin = 0;
+    uint32_t m_last = 0;
+    volatile bool m_resetRequested = false;
+
+    CycleStageStats m_stats[PROFILER_MAX_STAGES + 1];
+};
@@ -0,0 +1,154 @@
+#include "data_log.h"
+
+#include <cstring>
+
+#include <rusefi/crc.h>
+
+namespace
+{
+
+// Buffers the block in small pieces on its way to the sink, CRC on the fly
+class BlockWriter
+{
+public:
+    explicit BlockWriter(IDataLogSink& sink)
+        : m_sink(sink)
+    {
+    }
+
+    void Byte(uint8_t value)
+    {
+        m_buffer[m_size++] = value;
+
+        if (m_size == sizeof(m_buffer))
+        {
+            Drain();
+        }
+    }
+
+    void U16(uint16_t value)
+    {
+        Byte(value & 0xFF);
+        Byte(value >> 8);
+    }
+
+    void U32(uint32_t value)
+    {
+        U16(value & 0xFFFF);
+        U16(value >> 16);
+    }
+
+    void Varint(uint32_t value)
+    {
+        while (value >= 0x80)
+        {
+            Byte((value & 0x7F) | 0x80);
+            value >>= 7;
+        }
+
+        Byte(value);
+    }
+
+    void Signed(int32_t value)
+    {
+        // zigzag: small magnitudes of either sign stay short
+        Varint((static_cast<uint32_t>(value) << 1) ^ static_cast<uint32_t>(value >> 31));
+    }
+
+    void Finish()
+    {
+        Drain();
+
+        // CRC itself isn't part of the CRC
+        uint32_t crc = m_crc;
+        U32(crc);
+        Drain();
+    }
+
+private:
+    void Drain()
+    {
+        m_crc = crc32inc(m_buffer, m_crc, m_size);
+        m_sink.Write(m_buffer, m_size);
+        m_size = 0;
+    }
+
+    IDataLogSink& m_sink;
+    uint8_t m_buffer[32];
+    size_t m_size = 0;
+    uint32_t m_crc = 0;
+};
+
+}
+
+DataLogEncoder::DataLogEncoder(const uint8_t* columnTypes, size_t columnCount, uint16_t intervalMs)
+    : m_columnCount(columnCount > DATALOG_MAX_COLUMNS ? DATALOG_MAX_COLUMNS : columnCount)
+    , m_intervalMs(intervalMs)
+{
+    memcpy(m_types, columnTypes, m_columnCount);
+}
+
+bool DataLogEncoder::Add(const int16_t* values)
+{
+    if (m_count < DATALOG_BLOCK_RECORDS)
+    {
+        memcpy(m_values[m_count], values, m_columnCount * sizeof(int16_t));
+        m_count++;
+        m_total++;
+    }
+
+    return m_count == DATALOG_BLOCK_RECORDS;
+}
+
+void DataLogEncoder::Flush(IDataLogSink& sink)
+{
+    if (!m_count)
+    {
+        return;
+    }
+
+    BlockWriter w(sink);
+
+    w.Byte('W');
+    w.Byte('L');
+    w.Byte(DATALOG_VERSION);
+    w.Byte(m_columnCount);
+    w.Byte(m_count);
+    w.Byte(0);
+    w.U16(m_intervalMs);
+    w.U32(m_total - m_count);
+
+    for (size_t c = 0; c < m_columnCount; c++)
+    {
+        w.Byte(m_types[c]);
+    }
+
+    for (size_t c = 0; c < m_columnCount; c++)
+    {
+        w.Signed(m_values[0][c]);
+
+        size_t r = 1;
+        while (r < m_count)
+        {
+            int32_t delta = m_values[r][c] - m_values[r - 1][c];
+            w.Signed(delta);
+            r++;
+
+            if (delta == 0)
+            {
+                uint32_t run = 0;
+                while (r < m_count && m_values[r][c] == m_values[r - 1][c])
+                {
+                    run++;
+                    r++;
+                }
+
+                w.Varint(run);
+            }
+        }
+    }
+
+    w.Finish();
+
+    m_count = 0;
+}
@@ -0,0 +1,75 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+
+#include "wideband_config.h"
+
+/**
+ * Compact binary data log, decoded to CSV by tools/datalog_decode.py
+ *
+ * Records are collected DATALOG_BLOCK_RECORDS at a time and written as one
+ * block, column by column so consecutive values of a column sit together
+ * and their deltas stay small:
+ *
+ *   u8   'W' 'L'
+ *   u8   DATALOG_VERSION
+ *   u8   column count N
+ *   u8   record count R
+ *   u8   reserved
+ *   u16  record interval, ms
+ *   u32  index of the first record since boot
+ *   u8   column types [N], DataLogColumn with the channel in the top nibble
+ *   N columns of R values each: the first value, then deltas to the previous
+ *        one, all zigzag varints. A zero delta is followed by a varint count
+ *        of further zero deltas, so steady columns cost a couple of bytes.
+ *   u32  CRC32 of everything above
+ *
+ * Multi-byte fields are little endian.
+ */
+
+#define DATALOG_VERSION 1
+#define DATALOG_MAX_COLUMNS 12
+#define DATALOG_COLUMN_CHANNEL_SHIFT 4
+
+enum class DataLogColumn : uint8_t
+{
+    // 0.001
+    Lambda = 1,
+    // deg C
+    SensorTemp = 2,
+    Fault = 3,
+    HeaterState = 4,
+    // deg C
+    EgtTemp = 5,
+};
+
+class IDataLogSink
+{
+public:
+    virtual void Write(const uint8_t* buffer, size_t size) = 0;
+};
+
+class DataLogEncoder
+{
+public:
+    // Column layout is fixed for the life of the encoder, at most DATALOG_MAX_COLUMNS
+    DataLogEncoder(const uint8_t* columnTypes, size_t columnCount, uint16_t intervalMs);
+
+    // One value per column, returns true once a block is full
+    bool Add(const int16_t* values);
+
+    // Write out what has been collected and start the next block
+    void Flush(IDataLogSink& sink);
+
+private:
+    uint8_t m_types[DATALOG_MAX_COLUMNS];
+    size_t m_columnCount;
+    uint16_t m_intervalMs;
+
+    int16_t m_values[DATALOG_BLOCK_RECORDS][DATALOG_MAX_COLUMNS];
+    size_t m_count = 0;
+
+    // Records since boot, including the ones in this block
+    uint32_t m_total = 0;
+};
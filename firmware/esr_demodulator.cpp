@@ -0,0 +1,86 @@
+#include "esr_demodulator.h"
+
+#include <cmath>
+
+EsrDemodulator::EsrDemodulator(uint32_t samplesPerHalfPeriod, uint32_t decimation, float bandwidthHz, float sampleRateHz)
+    : m_samplesPerHalfPeriod(samplesPerHalfPeriod ? samplesPerHalfPeriod : 1)
+    , m_decimation(decimation ? decimation : 1)
+{
+    float outputRate = sampleRateHz / (2 * m_samplesPerHalfPeriod * m_decimation);
+
+    // Matched to an RC low pass at bandwidthHz, no filtering at all past Nyquist
+    m_alpha = bandwidthHz < outputRate / 2
+        ? 1 - expf(-2 * 3.14159265f * bandwidthHz / outputRate)
+        : 1;
+}
+
+bool EsrDemodulator::Add(float nernst)
+{
+    m_halfSum += nernst;
+    m_halfSamples++;
+
+    if (m_halfSamples < m_samplesPerHalfPeriod)
+    {
+        return false;
+    }
+
+    bool output = AddHalfPeriod(m_halfSum / m_halfSamples);
+
+    m_halfSum = 0;
+    m_halfSamples = 0;
+    m_phase = !m_phase;
+
+    return output;
+}
+
+bool EsrDemodulator::AddHalfPeriod(float mean)
+{
+    m_history[2] = m_history[1];
+    m_history[1] = m_history[0];
+    m_history[0] = mean;
+
+    // Same three point estimate as with one sample per half-period: the
+    // middle one against the average of its neighbours cancels a slope
+    m_dc = ((m_history[0] + m_history[2]) / 2 + m_history[1]) / 2;
+
+    float correlated = m_phase ? mean : -mean;
+
+    if (m_windowHalves == 0)
+    {
+        m_window = correlated / 2;
+        m_windowHalves = 1;
+        return false;
+    }
+
+    if (m_windowHalves < 2 * m_decimation)
+    {
+        m_window += correlated;
+        m_windowHalves++;
+        return false;
+    }
+
+    // Window complete, the sum of the weights is 2 * decimation
+    m_window += correlated / 2;
+    float ac = fabsf(m_window) / m_decimation;
+
+    // The last half-period also starts the next window
+    m_window = correlated / 2;
+    m_windowHalves = 1;
+
+    // Warm up: until 1/n drops below alpha the output is a plain average of
+    // the windows so far, so it settles right away instead of decaying from zero
+    float alpha = m_alpha;
+    if (m_outputs < 1 / m_alpha)
+    {
+        m_outputs++;
+
+        if (1.0f / m_outputs > alpha)
+        {
+            alpha = 1.0f / m_outputs;
+        }
+    }
+
+    m_ac += alpha * (ac - m_ac);
+
+    return true;
+}
@@ -0,0 +1,69 @@
+#pragma once
+
+#include <cstdint>
+
+#include "wideband_config.h"
+
+/**
+ * Synchronous (lock-in) demodulator for the ESR square wave on the nernst
+ * voltage. Samples go in in ADC order, the first samplesPerHalfPeriod
+ * of them are one ESR driver half-period, the next as many the other.
+ *
+ * Each half-period is averaged, then 2 * decimation + 1 half-period means
+ * are correlated with the driver phase, the outer two at half weight. The
+ * weights cancel the DC and any linear drift of it exactly, the averaging
+ * rejects anything not at the injection frequency, heater PWM included.
+ * Windows overlap by one half-period, so one output comes every
+ * decimation ESR periods, followed by a first order low pass.
+ */
+class EsrDemodulator
+{
+public:
+    EsrDemodulator(
+        uint32_t samplesPerHalfPeriod = ESR_SAMPLES_PER_HALF_PERIOD,
+        uint32_t decimation = ESR_DEMOD_DECIMATION,
+        float bandwidthHz = ESR_DEMOD_BANDWIDTH_HZ,
+        float sampleRateHz = SAMPLING_RATE_HZ);
+
+    // Returns true if this sample produced a new output
+    bool Add(float nernst);
+
+    // Filtered peak to peak amplitude of the square wave
+    float GetAc() const
+    {
+        return m_ac;
+    }
+
+    // Nernst voltage with the square wave removed, updated every half-period
+    float GetDc() const
+    {
+        return m_dc;
+    }
+
+    // Outputs so far, stops counting once the low pass has warmed up
+    uint32_t GetOutputCount() const
+    {
+        return m_outputs;
+    }
+
+private:
+    bool AddHalfPeriod(float mean);
+
+    uint32_t m_samplesPerHalfPeriod;
+    uint32_t m_decimation;
+    float m_alpha;
+
+    bool m_phase = false;
+    uint32_t m_halfSamples = 0;
+    float m_halfSum = 0;
+
+    // Last three half-period means, newest first
+    float m_history[3] = {};
+
+    uint32_t m_windowHalves = 0;
+    float m_window = 0;
+
+    uint32_t m_outputs = 0;
+    float m_ac = 0;
+    float m_dc = 0;
+};
@@ -1,6 +1,7 @@
 #pragma once
 
 #include <cstdint>
+#include <cstddef>
 
 #include "wideband_config.h"
 
@@ -92,5 +93,12 @@ const IHeaterController& GetHeaterController(int ch);
 
 void StartHeaterControl();
 float GetHeaterDuty(int ch);
+// Heater PWM counter position, 0..255 over one period
+uint8_t GetHeaterPwmPhase();
+// Same in timer ticks, safe from an ISR
+uint16_t GetHeaterPwmCounter();
+// Which of count ADC oversamples, taken from heater PWM counter start to
+// end, were clear of every heater edge, see CleanSampleMask()
+uint32_t GetHeaterCleanSampleMask(uint16_t start, uint16_t end, size_t count);
 HeaterState GetHeaterState(int ch);
 const char* describeHeaterState(HeaterState state);
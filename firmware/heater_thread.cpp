@@ -5,6 +5,10 @@
 #include "heater_control.h"
 #include "port.h"
 #include "sampling.h"
+#include "boot_timeline.h"
+#include "thread_monitor.h"
+#include "sample_blanking.h"
+#include "timer.h"
 
 // 400khz / 1024 = 390hz PWM
 static Pwm heaterPwm(HEATER_PWM_DEVICE);
@@ -25,6 +29,12 @@ static const PWMConfig heaterPwmConfig = {
     .dier = 0
 };
 
+// Where the heater outputs switch, rebuilt whenever a duty changes so the
+// sampling thread doesn't have to on every ADC cycle
+static PwmEdges heaterEdges = {};
+
+static void UpdateHeaterEdges();
+
 class HeaterController : public HeaterControllerBase {
 public:
     HeaterController(int ch, int pwm_ch)
@@ -36,6 +46,7 @@ public:
     void SetDuty(float duty) const override
     {
         heaterPwm.SetDuty(pwm_ch, duty);
+        UpdateHeaterEdges();
     }
 
 // TODO: private:
@@ -65,6 +76,26 @@ const IHeaterController& GetHeaterController(int ch)
     return heaterControllers[ch];
 }
 
+static void UpdateHeaterEdges()
+{
+    PwmEdges edges = {};
+    edges.Period = heaterPwm.GetPeriod();
+
+    // Not started yet, no edges
+    if (edges.Period)
+    {
+        for (int i = 0; i < AFR_CHANNELS; i++)
+        {
+            edges.AddChannel(heaterPwm.GetCompare(heaterControllers[i].pwm_ch));
+        }
+    }
+
+    // The sampling thread may preempt us, never let it see half an update
+    chSysLock();
+    heaterEdges = edges;
+    chSysUnlock();
+}
+
 static THD_WORKING_AREA(waHeaterThread, 256);
 static void HeaterThread(void*)
 {
@@ -72,7 +103,32 @@ static void HeaterThread(void*)
 
     // Wait for temperature sensing to stabilize so we don't
     // immediately think we overshot the target temperature
-    chThdSleepMilliseconds(1000);
+#if HEATER_FAST_BOOT
+    // Start as soon as every channel's ESR estimate has settled,
+    // fall back to the fixed delay if that never happens
+    Timer stableTimer;
+    stableTimer.reset();
+
+    while (!stableTimer.hasElapsedMs(HEATER_STARTUP_DELAY))
+    {
+        bool allStable = true;
+
+        for (int i = 0; i < AFR_CHANNELS; i++)
+        {
+            allStable &= GetSampler(i).IsStable();
+        }
+
+        if (allStable)
+        {
+            BootTimelineMark(BootStage::SamplingStable);
+            break;
+        }
+
+        chThdSleepMilliseconds(5);
+    }
+#else
+    chThdSleepMilliseconds(HEATER_STARTUP_DELAY);
+#endif
 
     struct HeaterConfig* configuration = &GetConfiguration()->heaterConfig;
 
@@ -96,8 +152,14 @@ static void HeaterThread(void*)
         }
     }
 
+    BootTimelineMark(BootStage::HeaterStart);
+
+    ThreadDeadlineInit(ThreadId::Heater, HEATER_CONTROL_PERIOD);
+
     while (true)
     {
+        ThreadLoopBegin(ThreadId::Heater);
+
         auto heaterAllowState = GetHeaterAllowed();
 
         for (int i = 0; i < AFR_CHANNELS; i++)
@@ -106,8 +168,15 @@ static void HeaterThread(void*)
             auto& heater = heaterControllers[i];
 
             heater.Update(sampler, heaterAllowState);
+
+            if (heater.IsRunningClosedLoop())
+            {
+                BootTimelineMark(BootStage::ClosedLoop);
+            }
         }
 
+        ThreadLoopEnd(ThreadId::Heater);
+
         // Loop at ~20hz
         chThdSleepMilliseconds(HEATER_CONTROL_PERIOD);
     }
@@ -121,6 +190,7 @@ void StartHeaterControl()
     {
         heaterPwm.SetDuty(heaterControllers[i].pwm_ch, 0);
     }
+    UpdateHeaterEdges();
 
     chThdCreateStatic(waHeaterThread, sizeof(waHeaterThread), NORMALPRIO + 1, HeaterThread, nullptr);
 }
@@ -130,6 +200,26 @@ float GetHeaterDuty(int ch)
     return heaterPwm.GetLastDuty(heaterControllers[ch].pwm_ch);
 }
 
+uint8_t GetHeaterPwmPhase()
+{
+    // All channels share one timer
+    return heaterPwm.GetPhase();
+}
+
+uint16_t GetHeaterPwmCounter()
+{
+    return heaterPwm.GetCounter();
+}
+
+uint32_t GetHeaterCleanSampleMask(uint16_t start, uint16_t end, size_t count)
+{
+    chSysLock();
+    PwmEdges edges = heaterEdges;
+    chSysUnlock();
+
+    return CleanSampleMask(edges, start, end, count, HEATER_EDGE_BLANKING_TICKS);
+}
+
 HeaterState GetHeaterState(int ch)
 {
     return heaterControllers[ch].GetHeaterState();
@@ -0,0 +1,339 @@
+#include "isotp.h"
+
+#include <cstring>
+
+IsoTp::IsoTp(IIsoTpLink& link)
+    : m_link(link)
+{
+}
+
+void IsoTp::SetFlowControl(uint8_t blockSize, uint8_t separationTime)
+{
+    m_blockSize = blockSize;
+    m_separationTime = separationTime;
+}
+
+uint32_t IsoTp::GetErrorCount() const
+{
+    return m_errors;
+}
+
+uint32_t IsoTp::SeparationUs(uint8_t stmin)
+{
+    if (stmin <= 0x7F)
+    {
+        return stmin * 1000;
+    }
+
+    if (stmin >= 0xF1 && stmin <= 0xF9)
+    {
+        return (stmin - 0xF0) * 100;
+    }
+
+    // Reserved values are to be treated as the longest separation
+    return 127000;
+}
+
+size_t IsoTp::Free() const
+{
+    return sizeof(m_stream) - m_count - m_rxPending;
+}
+
+void IsoTp::Stage(const uint8_t* data, size_t size)
+{
+    // Behind the readable bytes, only counted once the message is complete
+    for (size_t i = 0; i < size; i++)
+    {
+        m_stream[(m_head + m_count + m_rxPending) % sizeof(m_stream)] = data[i];
+        m_rxPending++;
+    }
+}
+
+void IsoTp::Commit()
+{
+    m_count += m_rxPending;
+    m_rxPending = 0;
+    m_rxRemaining = 0;
+}
+
+void IsoTp::Abort()
+{
+    m_rxPending = 0;
+    m_rxRemaining = 0;
+}
+
+void IsoTp::SendFlowControl(uint8_t flag)
+{
+    // Frames are always padded to 8 bytes
+    IsoTpFrame frame = {};
+    frame.Length = 8;
+    frame.Data[0] = ISOTP_PCI_FLOW_CONTROL | flag;
+    frame.Data[1] = m_blockSize;
+    frame.Data[2] = m_separationTime;
+
+    m_link.Transmit(frame);
+}
+
+void IsoTp::OnFirstFrame(const IsoTpFrame& frame)
+{
+    size_t length = ((frame.Data[0] & 0x0F) << 8) | frame.Data[1];
+
+    // A new message replaces one still in progress
+    Abort();
+
+    if (frame.Length < 8 || length < 8)
+    {
+        m_errors++;
+        return;
+    }
+
+    if (length > Free())
+    {
+        m_errors++;
+        SendFlowControl(ISOTP_FC_OVERFLOW);
+        return;
+    }
+
+    Stage(frame.Data + 2, 6);
+    m_rxRemaining = length - 6;
+    m_rxSequence = 1;
+    m_rxBlockCount = 0;
+
+    SendFlowControl(ISOTP_FC_CONTINUE);
+}
+
+void IsoTp::OnConsecutiveFrame(const IsoTpFrame& frame)
+{
+    if (!m_rxRemaining)
+    {
+        // Nothing in progress, stray or late frame
+        m_errors++;
+        return;
+    }
+
+    size_t chunk = m_rxRemaining < 7 ? m_rxRemaining : 7;
+
+    if ((frame.Data[0] & 0x0F) != m_rxSequence || frame.Length < chunk + 1)
+    {
+        // Lost a frame, the rest of the message is useless
+        m_errors++;
+        Abort();
+        return;
+    }
+
+    Stage(frame.Data + 1, chunk);
+    m_rxRemaining -= chunk;
+    m_rxSequence = (m_rxSequence + 1) & 0x0F;
+
+    if (!m_rxRemaining)
+    {
+        Commit();
+        return;
+    }
+
+    if (m_blockSize && ++m_rxBlockCount == m_blockSize)
+    {
+        m_rxBlockCount = 0;
+        SendFlowControl(ISOTP_FC_CONTINUE);
+    }
+}
+
+void IsoTp::OnFrame(const IsoTpFrame& frame)
+{
+    if (frame.Length < 1)
+    {
+        m_errors++;
+        return;
+    }
+
+    switch (frame.Data[0] & 0xF0)
+    {
+    case ISOTP_PCI_SINGLE:
+    {
+        size_t length = frame.Data[0] & 0x0F;
+
+        Abort();
+
+        if (length == 0 || length > 7 || frame.Length < length + 1 || length > Free())
+        {
+            m_errors++;
+            return;
+        }
+
+        Stage(frame.Data + 1, length);
+        Commit();
+        break;
+    }
+    case ISOTP_PCI_FIRST:
+        OnFirstFrame(frame);
+        break;
+    case ISOTP_PCI_CONSECUTIVE:
+        OnConsecutiveFrame(frame);
+        break;
+    case ISOTP_PCI_FLOW_CONTROL:
+        if (frame.Length < 3)
+        {
+            m_errors++;
+            return;
+        }
+
+        m_fcFlag = frame.Data[0] & 0x0F;
+        m_fcBlockSize = frame.Data[1];
+        m_fcSeparationTime = frame.Data[2];
+        m_fcPending = true;
+        break;
+    default:
+        m_errors++;
+        break;
+    }
+}
+
+bool IsoTp::WaitFlowControl(int timeout)
+{
+    int waits = 0;
+
+    while (true)
+    {
+        // Anything else that shows up meanwhile is still received normally
+        while (!m_fcPending)
+        {
+            IsoTpFrame frame;
+            if (!m_link.Receive(frame, timeout))
+            {
+                return false;
+            }
+
+            OnFrame(frame);
+        }
+
+        m_fcPending = false;
+
+        switch (m_fcFlag)
+        {
+        case ISOTP_FC_CONTINUE:
+            return true;
+        case ISOTP_FC_WAIT:
+            if (++waits > ISOTP_MAX_WAIT_FRAMES)
+            {
+                return false;
+            }
+            break;
+        default:
+            // Overflow, the peer can't take this message
+            return false;
+        }
+    }
+}
+
+bool IsoTp::Send(const uint8_t* buffer, size_t size, int timeout)
+{
+    IsoTpFrame frame = {};
+    frame.Length = 8;
+
+    if (size <= 7)
+    {
+        frame.Data[0] = ISOTP_PCI_SINGLE | size;
+        memcpy(frame.Data + 1, buffer, size);
+
+        return m_link.Transmit(frame);
+    }
+
+    if (size > ISOTP_MAX_MESSAGE)
+    {
+        return false;
+    }
+
+    frame.Data[0] = ISOTP_PCI_FIRST | (size >> 8);
+    frame.Data[1] = size & 0xFF;
+    memcpy(frame.Data + 2, buffer, 6);
+
+    m_fcPending = false;
+    if (!m_link.Transmit(frame))
+    {
+        return false;
+    }
+
+    size_t sent = 6;
+    uint8_t sequence = 1;
+
+    while (sent < size)
+    {
+        if (!WaitFlowControl(timeout))
+        {
+            return false;
+        }
+
+        uint8_t blockSize = m_fcBlockSize;
+        uint32_t separation = SeparationUs(m_fcSeparationTime);
+
+        for (int n = 0; sent < size && (blockSize == 0 || n < blockSize); n++)
+        {
+            if (n && separation)
+            {
+                m_link.DelayUs(separation);
+            }
+
+            size_t chunk = size - sent < 7 ? size - sent : 7;
+
+            frame = {};
+            frame.Length = 8;
+            frame.Data[0] = ISOTP_PCI_CONSECUTIVE | (sequence & 0x0F);
+            memcpy(frame.Data + 1, buffer + sent, chunk);
+
+            if (!m_link.Transmit(frame))
+            {
+                return false;
+            }
+
+            sent += chunk;
+            sequence++;
+        }
+    }
+
+    return true;
+}
+
+size_t IsoTp::Receive(uint8_t* buffer, size_t size, int timeout)
+{
+    size_t done = 0;
+
+    while (true)
+    {
+        while (done < size && m_count)
+        {
+            // Up to the end of the ring or what's there, whichever comes first
+            size_t chunk = sizeof(m_stream) - m_head;
+            if (chunk > m_count)
+                chunk = m_count;
+            if (chunk > size - done)
+                chunk = size - done;
+
+            memcpy(buffer + done, m_stream + m_head, chunk);
+            m_head = (m_head + chunk) % sizeof(m_stream);
+            m_count -= chunk;
+            done += chunk;
+        }
+
+        if (done == size)
+        {
+            return done;
+        }
+
+        IsoTpFrame frame;
+        if (!m_link.Receive(frame, timeout))
+        {
+            return done;
+        }
+
+        OnFrame(frame);
+    }
+}
+
+void IsoTp::Poll()
+{
+    IsoTpFrame frame;
+    while (m_link.Receive(frame, 0))
+    {
+        OnFrame(frame);
+    }
+}
@@ -0,0 +1,102 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+
+#include "wideband_config.h"
+
+// One classic CAN frame worth of ISO-TP (ISO 15765-2) data
+struct IsoTpFrame
+{
+    uint8_t Length;
+    uint8_t Data[8];
+};
+
+// Frame transport under IsoTp, CAN on target and a loopback in the tests
+class IIsoTpLink
+{
+public:
+    virtual bool Transmit(const IsoTpFrame& frame) = 0;
+    // Next frame addressed to us, false if none came within timeout
+    virtual bool Receive(IsoTpFrame& frame, int timeout) = 0;
+    // Consecutive frame separation requested by the peer
+    virtual void DelayUs(uint32_t us) = 0;
+};
+
+#define ISOTP_PCI_SINGLE        0x00
+#define ISOTP_PCI_FIRST         0x10
+#define ISOTP_PCI_CONSECUTIVE   0x20
+#define ISOTP_PCI_FLOW_CONTROL  0x30
+
+#define ISOTP_FC_CONTINUE       0
+#define ISOTP_FC_WAIT           1
+#define ISOTP_FC_OVERFLOW       2
+
+// 12 bit first frame length
+#define ISOTP_MAX_MESSAGE       4095
+
+/**
+ * ISO-TP over classic CAN, normal addressing.
+ *
+ * Received messages are appended to a byte stream, so the user reads it
+ * in whatever pieces it likes, the way it would a serial port. Each Send()
+ * is one message. Only one side of a transfer runs at a time per
+ * direction, which is all a request/response protocol needs.
+ */
+class IsoTp
+{
+public:
+    explicit IsoTp(IIsoTpLink& link);
+
+    // Flow control we grant the peer: frames per block (0 = all) and STmin
+    void SetFlowControl(uint8_t blockSize, uint8_t separationTime);
+
+    // Send one message, false if the peer refused it or stopped granting flow control
+    bool Send(const uint8_t* buffer, size_t size, int timeout);
+
+    // Read up to size bytes of the received stream, waiting up to timeout per frame
+    size_t Receive(uint8_t* buffer, size_t size, int timeout);
+
+    // Process whatever frames are already waiting
+    void Poll();
+
+    // Frames that didn't fit the protocol state, messages were dropped
+    uint32_t GetErrorCount() const;
+
+private:
+    void OnFrame(const IsoTpFrame& frame);
+    void OnFirstFrame(const IsoTpFrame& frame);
+    void OnConsecutiveFrame(const IsoTpFrame& frame);
+    void SendFlowControl(uint8_t flag);
+    bool WaitFlowControl(int timeout);
+    void Stage(const uint8_t* data, size_t size);
+    void Commit();
+    void Abort();
+    size_t Free() const;
+
+    static uint32_t SeparationUs(uint8_t stmin);
+
+    IIsoTpLink& m_link;
+
+    uint8_t m_blockSize = ISOTP_BLOCK_SIZE;
+    uint8_t m_separationTime = 0;
+
+    // Message being reassembled, its m_rxPending bytes so far follow the readable ones
+    size_t m_rxRemaining = 0;
+    size_t m_rxPending = 0;
+    uint8_t m_rxSequence = 0;
+    uint8_t m_rxBlockCount = 0;
+
+    // Received, not yet read
+    uint8_t m_stream[ISOTP_RX_BUFFER_SIZE];
+    size_t m_head = 0;
+    size_t m_count = 0;
+
+    // Last flow control from the peer
+    bool m_fcPending = false;
+    uint8_t m_fcFlag = 0;
+    uint8_t m_fcBlockSize = 0;
+    uint8_t m_fcSeparationTime = 0;
+
+    uint32_t m_errors = 0;
+};
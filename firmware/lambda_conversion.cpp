@@ -86,7 +86,12 @@ static float GetPhi(float pumpCurrent) {
 
 float GetLambda(int ch)
 {
-    float pumpCurrent = GetSampler(ch).GetPumpNominalCurrent();
+    return GetLambda(GetSampler(ch));
+}
+
+float GetLambda(const ISampler& sampler)
+{
+    float pumpCurrent = sampler.GetPumpNominalCurrent();
 
     // Lambda is reciprocal of phi
     return 1 / GetPhi(pumpCurrent);
@@ -1,3 +1,6 @@
 #pragma once
 
+struct ISampler;
+
 float GetLambda(int ch);
+float GetLambda(const ISampler& sampler);
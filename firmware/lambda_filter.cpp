@@ -0,0 +1,206 @@
+#include "lambda_filter.h"
+
+#include <cmath>
+
+void LambdaFilter::Configure(const LambdaFilterConfig& config, float sampleRateHz)
+{
+    if (config.Type == m_config.Type &&
+        config.MedianLength == m_config.MedianLength &&
+        config.CutoffHz.getRaw() == m_config.CutoffHz.getRaw() &&
+        sampleRateHz == m_sampleRateHz)
+    {
+        return;
+    }
+
+    m_config = config;
+    m_sampleRateHz = sampleRateHz;
+    m_type = config.Type;
+    m_delaySamples = 0;
+
+    // Normalized to the sample rate, past about Nyquist there is nothing left to filter
+    float w = 2 * 3.14159265f * config.CutoffHz / sampleRateHz;
+    bool cutoffValid = w > 0 && w < 0.9f * 3.14159265f;
+
+    switch (m_type)
+    {
+        case LambdaFilterType::Ema:
+            if (!cutoffValid)
+            {
+                m_type = LambdaFilterType::Bypass;
+                break;
+            }
+
+            // Matched to an RC low pass
+            m_alpha = 1 - expf(-w);
+            m_delaySamples = (1 - m_alpha) / m_alpha;
+            break;
+        case LambdaFilterType::Median:
+            m_medianLength = config.MedianLength;
+            if (m_medianLength > LAMBDA_FILTER_MAX_MEDIAN)
+            {
+                m_medianLength = LAMBDA_FILTER_MAX_MEDIAN;
+            }
+
+            if (m_medianLength < 2)
+            {
+                m_type = LambdaFilterType::Bypass;
+                break;
+            }
+
+            m_delaySamples = (m_medianLength - 1) / 2.0f;
+            break;
+        case LambdaFilterType::Butterworth:
+        {
+            if (!cutoffValid)
+            {
+                m_type = LambdaFilterType::Bypass;
+                break;
+            }
+
+            // Bilinear transform, cutoff prewarped
+            float k = tanf(w / 2);
+            float norm = 1 / (1 + 1.41421356f * k + k * k);
+            m_b0 = k * k * norm;
+            m_a1 = 2 * (k * k - 1) * norm;
+            m_a2 = (1 - 1.41421356f * k + k * k) * norm;
+
+            // Symmetric numerator is one sample, minus the denominator's share
+            m_delaySamples = 1 - (m_a1 + 2 * m_a2) / (1 + m_a1 + m_a2);
+            break;
+        }
+        case LambdaFilterType::Kalman:
+            if (!cutoffValid)
+            {
+                m_type = LambdaFilterType::Bypass;
+                break;
+            }
+
+            // Process noise relative to unit measurement noise that puts
+            // the poles at w, the steady state filter then has no delay at DC
+            m_q = w * w * w * w;
+            break;
+        case LambdaFilterType::Bypass:
+            break;
+        default:
+            m_type = LambdaFilterType::Bypass;
+            break;
+    }
+
+    Reset();
+}
+
+void LambdaFilter::Reset()
+{
+    m_primed = false;
+    m_medianCount = 0;
+    m_medianNext = 0;
+}
+
+float LambdaFilter::Median() const
+{
+    float sorted[LAMBDA_FILTER_MAX_MEDIAN];
+
+    // Insertion sort, there are only a handful
+    for (uint8_t i = 0; i < m_medianCount; i++)
+    {
+        float v = m_medianHistory[i];
+        uint8_t j = i;
+
+        while (j > 0 && sorted[j - 1] > v)
+        {
+            sorted[j] = sorted[j - 1];
+            j--;
+        }
+
+        sorted[j] = v;
+    }
+
+    uint8_t mid = m_medianCount / 2;
+
+    return (m_medianCount % 2) ? sorted[mid] : (sorted[mid - 1] + sorted[mid]) / 2;
+}
+
+float LambdaFilter::Update(float lambda)
+{
+    // Start out settled on the first sample instead of ramping up from 0
+    bool first = !m_primed;
+    m_primed = true;
+
+    switch (m_type)
+    {
+        case LambdaFilterType::Ema:
+            m_output = first ? lambda : m_output + m_alpha * (lambda - m_output);
+            break;
+        case LambdaFilterType::Median:
+            m_medianHistory[m_medianNext] = lambda;
+            m_medianNext = (m_medianNext + 1) % m_medianLength;
+            if (m_medianCount < m_medianLength)
+            {
+                m_medianCount++;
+            }
+
+            m_output = Median();
+            break;
+        case LambdaFilterType::Butterworth:
+        {
+            if (first)
+            {
+                m_z1 = lambda * (1 - m_b0);
+                m_z2 = lambda * (m_b0 - m_a2);
+            }
+
+            float y = m_b0 * lambda + m_z1;
+            m_z1 = 2 * m_b0 * lambda - m_a1 * y + m_z2;
+            m_z2 = m_b0 * lambda - m_a2 * y;
+
+            m_output = y;
+            break;
+        }
+        case LambdaFilterType::Kalman:
+        {
+            if (first)
+            {
+                // As unsure of the rate as of one measurement
+                m_output = lambda;
+                m_rate = 0;
+                m_p00 = 1;
+                m_p01 = 0;
+                m_p11 = 1;
+                break;
+            }
+
+            // Predict, white noise acceleration over one sample
+            m_output += m_rate;
+            m_p00 += 2 * m_p01 + m_p11 + m_q / 3;
+            m_p01 += m_p11 + m_q / 2;
+            m_p11 += m_q;
+
+            // Correct
+            float s = m_p00 + 1;
+            float k0 = m_p00 / s;
+            float k1 = m_p01 / s;
+            float residual = lambda - m_output;
+
+            m_output += k0 * residual;
+            m_rate += k1 * residual;
+
+            m_p11 -= k1 * m_p01;
+            m_p00 -= k0 * m_p00;
+            m_p01 -= k0 * m_p01;
+            break;
+        }
+        default:
+            m_output = lambda;
+            break;
+    }
+
+    return m_output;
+}
+
+float LambdaFilterGroupDelayMs(const LambdaFilterConfig& config, float sampleRateHz)
+{
+    LambdaFilter filter;
+    filter.Configure(config, sampleRateHz);
+
+    return filter.GetGroupDelayMs();
+}
@@ -0,0 +1,113 @@
+#pragma once
+
+#include <cstdint>
+
+#include "fixed_point.h"
+#include "wideband_config.h"
+
+enum class LambdaFilterType : uint8_t {
+    Bypass = 0,
+    Ema = 1,
+    Median = 2,
+    Butterworth = 3,
+    Kalman = 4,
+};
+
+// Outputs with their own filter settings, index in to Configuration::lambdaFilter
+enum class LambdaOutput : uint8_t {
+    RusEfi = 0,
+    AemNet = 1,
+    AuxOut = 2,
+};
+
+#define LAMBDA_OUTPUT_COUNT 3
+
+struct LambdaFilterConfig {
+    LambdaFilterType Type;
+    // Median window, samples
+    uint8_t MedianLength;
+    // EMA, Butterworth and Kalman, in 0.1Hz steps, 25.5Hz max
+    FixedPoint<uint8_t, 10> CutoffHz;
+    uint8_t pad;
+} __attribute__((packed));
+static_assert(sizeof(LambdaFilterConfig) == 4, "LambdaFilterConfig size incorrect");
+
+/**
+ * Smoothing stage between GetLambda() and one output, run at the output's
+ * update rate. Each type trades noise for latency differently:
+ *
+ *   Ema           first order low pass at CutoffHz
+ *   Median        of the last MedianLength samples, removes spikes but
+ *                 passes steps unchanged in shape
+ *   Butterworth   second order low pass at CutoffHz, steeper roll off
+ *                 than the EMA for the same delay
+ *   Kalman        constant rate model, follows ramps without lag at the
+ *                 cost of some overshoot on steps. Its poles are those of
+ *                 a Butterworth at CutoffHz.
+ *
+ * The reported group delay is the one at low frequency, which is what a
+ * consumer compensating for transport delay wants.
+ */
+class LambdaFilter
+{
+public:
+    // Cheap if nothing changed, state is kept unless it did
+    void Configure(const LambdaFilterConfig& config, float sampleRateHz = LAMBDA_FILTER_RATE_HZ);
+
+    float Update(float lambda);
+
+    float Get() const
+    {
+        return m_output;
+    }
+
+    float GetGroupDelayMs() const
+    {
+        return m_delaySamples * 1000 / m_sampleRateHz;
+    }
+
+    LambdaFilterType GetType() const
+    {
+        return m_type;
+    }
+
+private:
+    void Reset();
+    float Median() const;
+
+    LambdaFilterConfig m_config = {};
+    float m_sampleRateHz = LAMBDA_FILTER_RATE_HZ;
+
+    // Type actually in use, an out of range setting falls back to bypass
+    LambdaFilterType m_type = LambdaFilterType::Bypass;
+    float m_delaySamples = 0;
+
+    bool m_primed = false;
+    float m_output = 0;
+
+    // EMA
+    float m_alpha = 1;
+
+    // Median, ring buffer
+    uint8_t m_medianLength = 1;
+    uint8_t m_medianCount = 0;
+    uint8_t m_medianNext = 0;
+    float m_medianHistory[LAMBDA_FILTER_MAX_MEDIAN] = {};
+
+    // Butterworth, transposed direct form II, b1 = 2 * b0 and b2 = b0
+    float m_b0 = 1;
+    float m_a1 = 0;
+    float m_a2 = 0;
+    float m_z1 = 0;
+    float m_z2 = 0;
+
+    // Kalman, lambda and its rate per sample, symmetric covariance
+    float m_q = 0;
+    float m_rate = 0;
+    float m_p00 = 0;
+    float m_p01 = 0;
+    float m_p11 = 0;
+};
+
+// What a filter with these settings reports, without running one
+float LambdaFilterGroupDelayMs(const LambdaFilterConfig& config, float sampleRateHz = LAMBDA_FILTER_RATE_HZ);
@@ -4,29 +4,77 @@
 #include "lambda_conversion.h"
 #include "sampling.h"
 #include "pump_dac.h"
+#include "pump_control.h"
 #include "heater_control.h"
 #include "max3185x.h"
 #include "fault.h"
+#include "boot_timeline.h"
+#include "timer.h"
+#include "tunerstudio_io.h"
+#include "thread_monitor.h"
+#include "lambda_filter.h"
+#include "port.h"
+
+#include "ch.h"
 
 #include <rusefi/arrays.h>
 #include <rusefi/fragments.h>
 
 static livedata_common_s livedata_common;
 static livedata_afr_s livedata_afr[AFR_CHANNELS];
+static livedata_sensor_s livedata_sensor[AFR_CHANNELS];
+
+static uint8_t images[2][LIVEDATA_SIZE] __attribute__((aligned(4)));
+// Image readers get, the other one is written next
+static uint8_t front = 0;
+// Readers currently sending each image
+static uint8_t pinCount[2];
+// A reader is building the back image
+static bool updating = false;
+static Timer updateTimer;
+
+static uint16_t clampU16(uint32_t value)
+{
+    return value > UINT16_MAX ? UINT16_MAX : value;
+}
+
+static void UpdateTsRates()
+{
+    static Timer rateTimer;
+    static ts_io_counters_s last;
+
+    // Updates come at the host's poll rate, average over at least a second
+    if (!rateTimer.hasElapsedSec(1))
+    {
+        return;
+    }
+
+    chSysLock();
+    ts_io_counters_s now = tsIoCounters;
+    chSysUnlock();
+
+    float seconds = rateTimer.getElapsedSecondsAndReset();
 
-void SamplingUpdateLiveData()
+    livedata_common.tsInterruptRate = clampU16((now.interrupts - last.interrupts) / seconds);
+    livedata_common.tsByteRate = clampU16((now.rxBytes - last.rxBytes + now.txBytes - last.txBytes) / seconds);
+
+    last = now;
+}
+
+static void LiveDataUpdate()
 {
     float vbat = 0;
     for (int ch = 0; ch < AFR_CHANNELS; ch++)
     {
-        volatile struct livedata_afr_s *data = &livedata_afr[ch];
+        struct livedata_afr_s *data = &livedata_afr[ch];
 
-        const auto& sampler = GetSampler(ch);
+        // Runs in the TS thread, work on a consistent copy instead of the live sampler
+        const auto sampler = GetSamplerSnapshot(ch);
         const auto& heater = GetHeaterController(ch);
 
         float voltage = sampler.GetInternalHeaterVoltage();
 
-        data->lambda = GetLambda(ch);
+        data->lambda = GetLambda(sampler);
         data->temperature = sampler.GetSensorTemperature() * 10;
         data->heaterSupplyVoltage = voltage * 100;
         data->nernstDc = sampler.GetNernstDc() * 1000;
@@ -42,9 +90,34 @@ void SamplingUpdateLiveData()
         /* TODO: add GetPumpOutputDuty() */
         if (voltage > vbat)
             vbat = voltage;
+
+        const auto& estimator = GetSensorEstimator(ch);
+        livedata_sensor_s *est = &livedata_sensor[ch];
+        est->lambda = estimator.GetLambda();
+        est->lambdaSigma = clampU16(estimator.GetLambdaSigma() * 10000);
+        est->temperature = estimator.GetTemperature() * 10;
+        est->confidence = estimator.GetConfidence() * 100;
+        est->valid = estimator.IsValid();
+
+        const auto& response = GetSensorResponse(ch);
+        est->responseTimeConstant = clampU16(response.GetTimeConstantMs() * 10);
+        est->responseDelay = clampU16(response.GetDelayMs() * 10);
+        est->responseCount = response.GetResultCount() < 255 ? response.GetResultCount() : 255;
     }
 
     livedata_common.vbatt = vbat;
+    livedata_common.samplingCycles = clampU16(GetSamplingCycles());
+    livedata_common.samplingCyclesMax = clampU16(GetSamplingCyclesMax());
+
+    livedata_common.systemFaults = ThreadDeadlineMissed() ? LIVEDATA_FAULT_DEADLINE_MISS : 0;
+
+    const auto cfg = GetConfiguration();
+    for (int i = 0; i < LAMBDA_OUTPUT_COUNT; i++)
+    {
+        livedata_common.lambdaFilterDelay[i] = clampU16(LambdaFilterGroupDelayMs(cfg->lambdaFilter[i]) * 10);
+    }
+
+    UpdateTsRates();
 }
 
 template<>
@@ -64,14 +137,95 @@ const struct livedata_afr_s * getLiveData(size_t ch)
     return nullptr;
 }
 
+template<>
+const livedata_sensor_s* getLiveData(size_t ch)
+{
+    if (ch < AFR_CHANNELS)
+    {
+        return &livedata_sensor[ch];
+    }
+
+    return nullptr;
+}
+
+template<>
+const livedata_boot_s* getLiveData(size_t)
+{
+    return GetBootTimeline();
+}
+
+template<>
+const livedata_threads_s* getLiveData(size_t)
+{
+    return GetThreadStats();
+}
+
+template<>
+const livedata_deadline_s* getLiveData(size_t)
+{
+    return GetDeadlineStats();
+}
+
 static const FragmentEntry fragments[] = {
     decl_frag<livedata_common_s>{},
     decl_frag<livedata_afr_s, 0>{},
     decl_frag<livedata_afr_s, 1>{},
     decl_frag<livedata_egt_s, 0>{},
     decl_frag<livedata_egt_s, 1>{},
+    decl_frag<livedata_boot_s>{},
+    decl_frag<livedata_threads_s>{},
+    decl_frag<livedata_deadline_s>{},
+    decl_frag<livedata_sensor_s, 0>{},
+    decl_frag<livedata_sensor_s, 1>{},
 };
 
-FragmentList getFragments() {
+static FragmentList getFragments() {
 	return { fragments, efi::size(fragments) };
 }
+
+const uint8_t* LiveDataAcquire()
+{
+    bool stale = updateTimer.hasElapsedMs(LIVEDATA_MAX_AGE_MS);
+    bool update = false;
+
+    chSysLock();
+    // Readers only ever pin the front image, the back one is free unless
+    // it is still being sent from before the last swap
+    if (stale && !updating && !pinCount[front ^ 1])
+    {
+        updating = true;
+        update = true;
+    }
+    chSysUnlock();
+
+    if (update)
+    {
+        LiveDataUpdate();
+
+        // Lay out all fragments at their ini offsets, anything not provided reads as zero
+        copyRange(images[front ^ 1], getFragments(), 0, LIVEDATA_SIZE);
+
+        updateTimer.reset();
+
+        chSysLock();
+        front ^= 1;
+        updating = false;
+        chSysUnlock();
+    }
+
+    chSysLock();
+    uint8_t idx = front;
+    pinCount[idx]++;
+    chSysUnlock();
+
+    return images[idx];
+}
+
+void LiveDataRelease(const uint8_t* image)
+{
+    uint8_t idx = (image == images[1]) ? 1 : 0;
+
+    chSysLock();
+    pinCount[idx]--;
+    chSysUnlock();
+}
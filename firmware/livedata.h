@@ -5,13 +5,24 @@
 #include <rusefi/fragments.h>
 
 #include "wideband_config.h"
+#include "lambda_filter.h"
 
 /* +0 offset */
 struct livedata_common_s {
 	union {
 		struct {
 			float vbatt;
-		};
+			// sampling thread CPU cycles per ADC cycle
+			uint16_t samplingCycles;
+			uint16_t samplingCyclesMax;
+			// TS port interrupts and bytes moved per second
+			uint16_t tsInterruptRate;
+			uint16_t tsByteRate;
+			// LIVEDATA_FAULT_* bits
+			uint8_t systemFaults;
+			// added by each output's lambda filter, 0.1 ms, indexed by LambdaOutput
+			uint16_t lambdaFilterDelay[LAMBDA_OUTPUT_COUNT];
+		} __attribute__((packed));
 		uint8_t pad0[32];
 	};
 };
@@ -39,5 +50,37 @@ struct livedata_afr_s {
 	};
 };
 
-/* update functions */
-void SamplingUpdateLiveData();
+/* +384 offset, SensorEstimator and SensorResponseEstimator output */
+struct livedata_sensor_s {
+	union {
+		struct {
+			float lambda;
+			// 0.0001, 1 sigma
+			uint16_t lambdaSigma;
+			// 0.1 C
+			uint16_t temperature;
+			// %
+			uint8_t confidence;
+			uint8_t valid;
+			// SensorResponseEstimator, 0.1 ms, 0 until measured
+			uint16_t responseTimeConstant;
+			uint16_t responseDelay;
+			// bursts measured, saturating
+			uint8_t responseCount;
+		} __attribute__((packed));
+		uint8_t pad[32];
+	};
+};
+
+// A periodic loop missed its deadline in the last second
+#define LIVEDATA_FAULT_DEADLINE_MISS 0x01
+
+/* whole output channel block, ochBlockSize in the ini */
+#define LIVEDATA_SIZE 448
+
+/* Output channels are assembled into one of two images, readers get the
+ * last complete one. It isn't touched until released, so it can be sent
+ * without copying it first. A reader finding the image older than
+ * LIVEDATA_MAX_AGE_MS rebuilds it first, in its own thread. */
+const uint8_t* LiveDataAcquire();
+void LiveDataRelease(const uint8_t* image);
@@ -14,6 +14,8 @@
 #include "port.h"
 #include "tunerstudio.h"
 #include "indication.h"
+#include "boot_timeline.h"
+#include "config_persistence.h"
 
 #include "wideband_config.h"
 
@@ -28,26 +30,44 @@ int main() {
     halInit();
     chSysInit();
 
+    BootTimelineStart();
+
     // Load configuration
     InitConfiguration();
+    StartConfigPersistence();
+    BootTimelineMark(BootStage::Config);
 
     // Fire up all of our threads
     StartSampling();
+    BootTimelineMark(BootStage::Sampling);
+
+    // CAN goes right after sampling so the first frame (and the ECU's
+    // heater enable) doesn't wait for the rest of init
+    InitCan();
+    BootTimelineMark(BootStage::Can);
+
     InitPumpDac();
+    BootTimelineMark(BootStage::PumpDac);
     StartHeaterControl();
+    BootTimelineMark(BootStage::HeaterControl);
     StartPumpControl();
+    BootTimelineMark(BootStage::PumpControl);
     InitAuxDac();
+    BootTimelineMark(BootStage::AuxDac);
 
 #if TS_ENABLED
     startTunerStudioConnectivity();
+    BootTimelineMark(BootStage::TunerStudio);
 #endif
 
-    InitCan();
     InitUart();
+    BootTimelineMark(BootStage::Uart);
     InitIndication();
+    BootTimelineMark(BootStage::Indication);
 
 #if (EGT_CHANNELS > 0)
     StartEgt();
+    BootTimelineMark(BootStage::Egt);
 #endif
 
     while(true)
@@ -6,6 +6,7 @@
 #include "livedata.h"
 
 #include "max3185x.h"
+#include "thread_monitor.h"
 
 #if (EGT_CHANNELS > 0)
 
@@ -283,13 +284,19 @@ Max3185xState Max3185x::readPacket()
 
 void Max3185xThread::ThreadTask() {
 
+	ThreadDeadlineInit(ThreadId::Egt, MAX3185X_PERIOD_MS);
+
 	while (true) {
+		ThreadLoopBegin(ThreadId::Egt);
+
 		for (int ch = 0; ch < EGT_CHANNELS; ch++) {
 		    Max3185x &current = max3185x[ch];
 			current.readPacket();
 		}
 
-        chThdSleepMilliseconds(500);
+		ThreadLoopEnd(ThreadId::Egt);
+
+        chThdSleepMilliseconds(MAX3185X_PERIOD_MS);
 	}
 }
 
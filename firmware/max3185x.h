@@ -40,6 +40,7 @@ const struct livedata_egt_s * getEgtLiveDataStructAddr(const int ch);
 
 #define MAX3185X_THREAD_STACK 	(512)
 #define MAX3185X_THREAD_PRIO	(NORMALPRIO + 1)
+#define MAX3185X_PERIOD_MS		(500)
 
 class Max3185x {
 public:
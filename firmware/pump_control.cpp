@@ -3,12 +3,16 @@
 #include "heater_control.h"
 #include "sampling.h"
 #include "pump_dac.h"
+#include "lambda_conversion.h"
 #include "pid.h"
+#include "thread_monitor.h"
 
 #include "ch.h"
 
 struct pump_control_state {
     Pid pumpPid;
+    SensorEstimator estimator;
+    SensorResponseEstimator response;
 };
 
 PidConfig pumpPidConfig = {
@@ -87,13 +91,52 @@ private:
 
 SensorDetector sensorDetector[AFR_CHANNELS];
 
-static THD_WORKING_AREA(waPumpThread, 256);
+const SensorEstimator& GetSensorEstimator(int ch)
+{
+    return state[ch].estimator;
+}
+
+const SensorResponseEstimator& GetSensorResponse(int ch)
+{
+    return state[ch].response;
+}
+
+void ProcessSensorResponse()
+{
+    for (int ch = 0; ch < AFR_CHANNELS; ch++)
+    {
+        state[ch].response.Process();
+    }
+}
+
+static void UpdateEstimator(int ch, pump_control_state& s, const ISampler& sampler, const IHeaterController& heater, bool pumpActive)
+{
+    SensorEstimatorInputs in;
+
+    in.Lambda = GetLambda(sampler);
+    in.NernstDc = sampler.GetNernstDc();
+    in.PumpDuty = GetPumpOutputDuty(ch);
+    in.PumpActive = pumpActive;
+    in.EsrTemperature = sampler.IsStable() ? sampler.GetSensorTemperature() : 0;
+    in.TargetTemperature = heater.GetTargetTemp();
+    in.HeaterEffectiveVoltage = heater.GetHeaterEffectiveVoltage();
+
+    s.estimator.Update(in);
+}
+
+// Room for the estimators' soft float libm calls on top of the PID, check
+// the Pump stack watermark in the thread stats when adding to this loop
+static THD_WORKING_AREA(waPumpThread, 512);
 static void PumpThread(void*)
 {
     chRegSetThreadName("Pump");
 
+    ThreadDeadlineInit(ThreadId::Pump, PUMP_CONTROL_PERIOD);
+
     while(true)
     {
+        ThreadLoopBegin(ThreadId::Pump);
+
         for (int ch = 0; ch < AFR_CHANNELS; ch++)
         {
             pump_control_state &s = state[ch];
@@ -102,13 +145,25 @@ static void PumpThread(void*)
             const auto& heater = GetHeaterController(ch);
 
             // Only actuate pump when hot enough to not hurt the sensor
-            if (heater.IsRunningClosedLoop() ||
-                (sampler.GetSensorTemperature() >= heater.GetTargetTemp() - START_PUMP_TEMP_OFFSET))
+            bool pumpActive = heater.IsRunningClosedLoop() ||
+                (sampler.GetSensorTemperature() >= heater.GetTargetTemp() - START_PUMP_TEMP_OFFSET);
+
+            if (!pumpActive)
+            {
+                // Drops any response measurement burst under way
+                s.response.Update(0, 0, false);
+            }
+
+            if (pumpActive)
             {
                 float nernstVoltage = sampler.GetNernstDc();
 
                 float result = s.pumpPid.GetOutput(NERNST_TARGET, nernstVoltage);
 
+                // Response measurement bursts, only on a sensor that's otherwise fine
+                result += s.response.GetDither();
+                s.response.Update(result, nernstVoltage, s.estimator.IsValid());
+
                 // result is in mA
                 SetPumpCurrentTarget(ch, result * 1000);
             }
@@ -123,8 +178,12 @@ static void PumpThread(void*)
                 // Otherwise set zero pump current to avoid damaging the sensor
                 SetPumpCurrentTarget(ch, 0);
             }
+
+            UpdateEstimator(ch, s, sampler, heater, pumpActive);
         }
 
+        ThreadLoopEnd(ThreadId::Pump);
+
         // Run at 500hz
         chThdSleepMilliseconds(PUMP_CONTROL_PERIOD);
     }
@@ -1,3 +1,14 @@
 #pragma once
 
+#include "sensor_estimator.h"
+#include "sensor_response.h"
+
 void StartPumpControl();
+
+// Lambda, temperature and confidence fused in the pump loop
+const SensorEstimator& GetSensorEstimator(int ch);
+
+// Sensor time constant and dead time, measured in the pump loop
+const SensorResponseEstimator& GetSensorResponse(int ch);
+// Turns finished measurements in to results, away from the pump loop
+void ProcessSensorResponse();
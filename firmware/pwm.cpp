@@ -29,3 +29,29 @@ float Pwm::GetLastDuty(int channel)
 {
     return m_dutyFloat[channel];
 }
+
+uint8_t Pwm::GetPhase() const
+{
+    if (!m_counterPeriod)
+    {
+        return 0;
+    }
+
+    return (m_driver->tim->CNT * 256) / m_counterPeriod;
+}
+
+uint16_t Pwm::GetCounter() const
+{
+    return m_driver->tim->CNT;
+}
+
+uint16_t Pwm::GetPeriod() const
+{
+    return m_counterPeriod;
+}
+
+uint16_t Pwm::GetCompare(int channel) const
+{
+    // Same rounding as SetDuty()
+    return (pwmcnt_t)(m_counterPeriod * m_dutyFloat[channel]);
+}
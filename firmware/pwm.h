@@ -15,6 +15,13 @@ public:
     void Start(const PWMConfig& config);
     void SetDuty(int channel, float duty);
     float GetLastDuty(int channel);
+    // Position within the current period, 0..255
+    uint8_t GetPhase() const;
+    // Same in counter ticks, 0..GetPeriod() - 1
+    uint16_t GetCounter() const;
+    uint16_t GetPeriod() const;
+    // Counter value where the channel switches off
+    uint16_t GetCompare(int channel) const;
 
 private:
     PWMDriver* const m_driver;
@@ -0,0 +1,117 @@
+#include "sample_blanking.h"
+
+void PwmEdges::AddChannel(uint16_t compare)
+{
+    if (compare == 0 || compare >= Period)
+    {
+        return;
+    }
+
+    // The counter wrapping switches every channel on, once is enough
+    bool haveWrap = false;
+    for (size_t i = 0; i < Count; i++)
+    {
+        haveWrap |= Position[i] == 0;
+    }
+
+    if (!haveWrap && Count < PWM_MAX_EDGES)
+    {
+        Position[Count++] = 0;
+    }
+
+    if (Count < PWM_MAX_EDGES)
+    {
+        Position[Count++] = compare;
+    }
+}
+
+uint32_t CleanSampleMask(const PwmEdges& edges, uint16_t start, uint16_t end, size_t count, uint16_t guard)
+{
+    if (count > 32)
+    {
+        count = 32;
+    }
+
+    uint32_t all = count == 32 ? 0xFFFFFFFF : (1u << count) - 1;
+
+    if (edges.Period == 0 || edges.Count == 0 || guard == 0)
+    {
+        return all;
+    }
+
+    // Runs every ADC cycle, the M0 has no divider: a single division for
+    // the step and every wrap round the period a conditional subtract
+    uint32_t period = edges.Period;
+    uint32_t elapsed = end >= start ? end - start : end + period - start;
+    if (elapsed >= period)
+    {
+        elapsed -= period;
+    }
+
+    // Ticks per oversample, 16.16 rounded up so whole ticks land exactly
+    uint32_t step = 0;
+    if (count > 1)
+    {
+        step = ((elapsed << 16) + count - 2) / (count - 1);
+    }
+
+    uint32_t mask = 0;
+    uint32_t offset = 0;
+
+    for (size_t i = 0; i < count; i++, offset += step)
+    {
+        uint32_t t = start + (offset >> 16);
+        while (t >= period)
+        {
+            t -= period;
+        }
+
+        bool clean = true;
+
+        for (size_t e = 0; e < edges.Count; e++)
+        {
+            // Distance either way round the period
+            uint32_t p = edges.Position[e];
+            uint32_t d = t >= p ? t - p : t + period - p;
+            if (period - d < d)
+            {
+                d = period - d;
+            }
+
+            clean &= d > guard;
+        }
+
+        if (clean)
+        {
+            mask |= 1u << i;
+        }
+    }
+
+    return mask;
+}
+
+float AverageClean(const uint16_t* buffer, size_t first, size_t stride, size_t count, uint32_t mask, size_t minClean)
+{
+    uint32_t sum = 0;
+    uint32_t cleanSum = 0;
+    size_t clean = 0;
+
+    for (size_t i = 0; i < count; i++)
+    {
+        uint16_t v = buffer[first + i * stride];
+        sum += v;
+
+        if (i < 32 && (mask & (1u << i)))
+        {
+            cleanSum += v;
+            clean++;
+        }
+    }
+
+    if (clean < minClean || clean == 0)
+    {
+        return count ? (float)sum / count : 0;
+    }
+
+    return (float)cleanSum / clean;
+}
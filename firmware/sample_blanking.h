@@ -0,0 +1,36 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+
+#include "wideband_config.h"
+
+#define PWM_MAX_EDGES 4
+
+static_assert(ADC_OVERSAMPLE <= 32, "One mask bit per oversample");
+
+// Where a PWM timer's outputs switch, in counter ticks
+struct PwmEdges
+{
+    uint16_t Period;
+    uint8_t Count;
+    uint16_t Position[PWM_MAX_EDGES];
+
+    // Adds the edges of a channel with this compare value, none if it's
+    // always on or always off
+    void AddChannel(uint16_t compare);
+};
+
+/**
+ * Which of count oversamples were taken further than guard ticks from every
+ * edge, bit i for oversample i. The oversamples are assumed evenly spread
+ * from counter value start to end, a run shorter than one PWM period.
+ */
+uint32_t CleanSampleMask(const PwmEdges& edges, uint16_t start, uint16_t end, size_t count, uint16_t guard);
+
+/**
+ * Average of buffer[first], buffer[first + stride] ... count values, leaving
+ * out those not in mask. Falls back to all of them when fewer than
+ * minClean are left, a short average beats none.
+ */
+float AverageClean(const uint16_t* buffer, size_t first, size_t stride, size_t count, uint32_t mask, size_t minClean);
@@ -0,0 +1,160 @@
+#include "sample_stream.h"
+
+#include "port.h"
+
+static int16_t toTenthMv(float volts)
+{
+    float v = volts * 10000;
+
+    if (v > INT16_MAX)
+    {
+        return INT16_MAX;
+    }
+    else if (v < INT16_MIN)
+    {
+        return INT16_MIN;
+    }
+
+    return v;
+}
+
+void FillSampleRecord(SampleStreamRecord& r, uint16_t sequence, int ch, const AnalogChannelResult& result,
+                      float virtualGroundVoltageInt, bool esrPhase, uint8_t heaterPhase)
+{
+    r.Sequence = sequence;
+    r.Flags = (ch << SAMPLE_STREAM_CHANNEL_SHIFT)
+        | (esrPhase ? SAMPLE_STREAM_FLAG_ESR_PHASE : 0)
+        | (result.NernstClamped ? SAMPLE_STREAM_FLAG_CLAMPED : 0);
+    r.HeaterPhase = heaterPhase;
+    r.NernstRaw = toTenthMv(result.NernstVoltage);
+    r.PumpCurrent = toTenthMv(result.PumpCurrentVoltage - virtualGroundVoltageInt);
+}
+
+bool SampleStream::Configure(uint8_t channelMask, uint8_t decimation, const void* owner)
+{
+    if (m_busy.exchange(true, std::memory_order_acquire))
+    {
+        return false;
+    }
+
+    m_owner = owner;
+
+    // Stop recording first so the producer doesn't race the reset
+    m_channelMask.store(0);
+
+    m_decimation = decimation ? decimation : 1;
+    m_decimationCounter = 0;
+    m_dropped.store(0);
+    m_tail.store(m_head.load());
+
+    m_channelMask.store(channelMask);
+
+    m_busy.store(false, std::memory_order_release);
+    return true;
+}
+
+bool SampleStream::IsEnabled() const
+{
+    return m_channelMask.load(std::memory_order_relaxed) != 0;
+}
+
+void SampleStream::Add(const AnalogChannelResult* channels, int channelCount, float virtualGroundVoltageInt,
+                       bool esrPhase, uint8_t heaterPhase)
+{
+    uint16_t sequence = m_sequence++;
+
+    uint8_t mask = m_channelMask.load(std::memory_order_relaxed);
+    if (!mask)
+    {
+        return;
+    }
+
+    if (++m_decimationCounter < m_decimation)
+    {
+        return;
+    }
+    m_decimationCounter = 0;
+
+    uint32_t head = m_head.load(std::memory_order_relaxed);
+    uint32_t tail = m_tail.load(std::memory_order_acquire);
+
+    for (int ch = 0; ch < channelCount; ch++)
+    {
+        if (!(mask & (1 << ch)))
+        {
+            continue;
+        }
+
+        if (head - tail >= Depth)
+        {
+            // Reader fell behind, drop the newest
+            m_dropped.fetch_add(1, std::memory_order_relaxed);
+            continue;
+        }
+
+        FillSampleRecord(m_records[head % Depth], sequence, ch, channels[ch], virtualGroundVoltageInt, esrPhase, heaterPhase);
+
+        head++;
+    }
+
+    m_head.store(head, std::memory_order_release);
+}
+
+size_t SampleStream::Read(uint8_t* buffer, size_t size, const void* owner)
+{
+    if (size < sizeof(SampleStreamHeader))
+    {
+        return 0;
+    }
+
+    if (m_busy.exchange(true, std::memory_order_acquire))
+    {
+        return 0;
+    }
+
+    // Nobody has configured it yet, anyone may see that it's empty
+    if (m_owner && m_owner != owner)
+    {
+        m_busy.store(false, std::memory_order_release);
+        return 0;
+    }
+
+    uint32_t tail = m_tail.load(std::memory_order_relaxed);
+    uint32_t head = m_head.load(std::memory_order_acquire);
+
+    size_t count = (size - sizeof(SampleStreamHeader)) / sizeof(SampleStreamRecord);
+    if (count > UINT8_MAX)
+    {
+        count = UINT8_MAX;
+    }
+    if (count > head - tail)
+    {
+        count = head - tail;
+    }
+
+    auto records = reinterpret_cast<SampleStreamRecord*>(buffer + sizeof(SampleStreamHeader));
+    for (size_t i = 0; i < count; i++)
+    {
+        records[i] = m_records[(tail + i) % Depth];
+    }
+
+    m_tail.store(tail + count, std::memory_order_release);
+
+    uint32_t dropped = m_dropped.exchange(0, std::memory_order_relaxed);
+
+    auto header = reinterpret_cast<SampleStreamHeader*>(buffer);
+    header->Dropped = dropped > UINT16_MAX ? UINT16_MAX : dropped;
+    header->Count = count;
+    header->Reserved = 0;
+
+    m_busy.store(false, std::memory_order_release);
+
+    return sizeof(SampleStreamHeader) + count * sizeof(SampleStreamRecord);
+}
+
+static SampleStream sampleStream;
+
+SampleStream& GetSampleStream()
+{
+    return sampleStream;
+}
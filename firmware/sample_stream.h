@@ -0,0 +1,95 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <atomic>
+
+#include "wideband_config.h"
+
+struct AnalogChannelResult;
+
+// One ADC cycle of one channel, before any filtering
+struct SampleStreamRecord
+{
+    // ADC cycle counter, gaps are decimation or dropped records
+    uint16_t Sequence;
+    // See SAMPLE_STREAM_FLAG_*, channel in the top nibble
+    uint8_t Flags;
+    // Heater PWM counter scaled to 0..255 over one period
+    uint8_t HeaterPhase;
+    // 0.1mV
+    int16_t NernstRaw;
+    // Pump current sense relative to virtual ground, 0.1mV
+    int16_t PumpCurrent;
+} __attribute__((packed));
+
+static_assert(sizeof(SampleStreamRecord) == 8, "SampleStreamRecord size incorrect");
+
+// Set on every other ADC cycle, following the ESR driver square wave
+#define SAMPLE_STREAM_FLAG_ESR_PHASE    0x01
+#define SAMPLE_STREAM_FLAG_CLAMPED      0x02
+#define SAMPLE_STREAM_CHANNEL_SHIFT     4
+
+// Start of each TS_SAMPLE_STREAM_COMMAND reply, followed by Count records
+struct SampleStreamHeader
+{
+    // Records lost to overflow since the previous read, saturating
+    uint16_t Dropped;
+    uint8_t Count;
+    uint8_t Reserved;
+} __attribute__((packed));
+
+static_assert(sizeof(SampleStreamHeader) == 4, "SampleStreamHeader size incorrect");
+
+// Pack one channel of an ADC cycle into a record
+void FillSampleRecord(SampleStreamRecord& r, uint16_t sequence, int ch, const AnalogChannelResult& result,
+                      float virtualGroundVoltageInt, bool esrPhase, uint8_t heaterPhase);
+
+/**
+ * Lock-free ring of sample records: the sampling thread pushes, the
+ * TS thread drains. Nothing is recorded until a channel is enabled, so
+ * the sampling thread only pays for it while somebody is streaming.
+ *
+ * There is only one consumer. More than one TS channel can ask for the
+ * stream, so it belongs to whichever configured it last and the others
+ * are turned away, as is anybody calling in while a Configure or Read
+ * is still running.
+ */
+class SampleStream
+{
+public:
+    // channelMask == 0 stops the stream. Every decimation-th ADC cycle is kept.
+    // Returns false if the stream is busy, owner is who may read it from now on.
+    bool Configure(uint8_t channelMask, uint8_t decimation, const void* owner = nullptr);
+    bool IsEnabled() const;
+
+    // Sampling thread, once per ADC cycle
+    void Add(const AnalogChannelResult* channels, int channelCount, float virtualGroundVoltageInt,
+             bool esrPhase, uint8_t heaterPhase);
+
+    // Fill buffer with a header and as many whole records as fit, returns bytes used.
+    // 0 if the buffer is too small, the stream is busy or it belongs to somebody else.
+    size_t Read(uint8_t* buffer, size_t size, const void* owner = nullptr);
+
+private:
+    static constexpr uint32_t Depth = SAMPLE_STREAM_DEPTH;
+    static_assert((Depth & (Depth - 1)) == 0, "SAMPLE_STREAM_DEPTH must be a power of 2");
+
+    SampleStreamRecord m_records[Depth];
+
+    // Free running, only the producer writes m_head and only the consumer m_tail
+    std::atomic<uint32_t> m_head{0};
+    std::atomic<uint32_t> m_tail{0};
+    std::atomic<uint32_t> m_dropped{0};
+
+    std::atomic<uint8_t> m_channelMask{0};
+
+    // Consumer side, only touched with m_busy claimed
+    std::atomic<bool> m_busy{false};
+    const void* m_owner = nullptr;
+    uint8_t m_decimation = 1;
+    uint8_t m_decimationCounter = 0;
+    uint16_t m_sequence = 0;
+};
+
+SampleStream& GetSampleStream();
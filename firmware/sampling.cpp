@@ -21,12 +21,12 @@ void Sampler::Init()
 
 float Sampler::GetNernstDc() const
 {
-    return nernstDc;
+    return esr.GetDc();
 }
 
 float Sampler::GetNernstAc() const
 {
-    return nernstAc;
+    return esr.GetAc();
 }
 
 float Sampler::GetNernstV() const
@@ -34,6 +34,12 @@ float Sampler::GetNernstV() const
     return nernstV;
 }
 
+bool Sampler::IsStable() const
+{
+    // Pump current filter warmed up, and at least one complete ESR demodulator window
+    return sampleCount >= 2 + ESR_SENSE_STABLE_SAMPLES && esr.GetOutputCount() > 0;
+}
+
 float Sampler::GetPumpNominalCurrent() const
 {
     // Gain is 10x, then a 61.9 ohm resistor
@@ -97,15 +103,13 @@ float Sampler::GetSensorInternalResistance() const
     return totalEsr - VM_RESISTOR_VALUE;
 }
 
-constexpr float f_abs(float x)
+constexpr float f_max(float a, float b)
 {
-    return x > 0 ? x : -x;
+    return a > b ? a : b;
 }
 
 void Sampler::ApplySample(AnalogChannelResult& result, float virtualGroundVoltageInt)
 {
-    float r_1 = result.NernstVoltage;
-
     // If value is close to ADC limit...
     if (result.NernstClamped) {
         nernstClamped = 100;
@@ -113,32 +117,30 @@ void Sampler::ApplySample(AnalogChannelResult& result, float virtualGroundVoltag
         nernstClamped--;
     }
 
-    // r2_opposite_phase estimates where the previous sample would be had we not been toggling
-    // AKA the absolute value of the difference between r2_opposite_phase and r2 is the amplitude
-    // of the AC component on the nernst voltage.  We have to pull this trick so as to use the past 3
-    // samples to cancel out any slope in the DC (aka actual nernst cell output) from the AC measurement
+    // AC (amplitude of the ESR square wave) and DC (actual nernst cell output) components,
+    // the DC estimate cancels out any slope the same way as the AC one
     // See firmware/sampling.png for a drawing of what's going on here
-    float r2_opposite_phase = (r_1 + r_3) / 2;
-
-    // Compute AC (difference) and DC (average) components
-    float nernstAcLocal = f_abs(r2_opposite_phase - r_2);
-    nernstDc = (r2_opposite_phase + r_2) / 2;
+    esr.Add(result.NernstVoltage);
     nernstV = result.NernstVoltage;
 
-    nernstAc =
-        (1 - ESR_SENSE_ALPHA) * nernstAc +
-        ESR_SENSE_ALPHA * nernstAcLocal;
+    float pumpAlpha = PUMP_FILTER_ALPHA;
+
+    // Warm up: until 1/n drops below alpha, the filter is a plain average
+    // of the samples so far, so it settles in a few ms instead of decaying from zero
+    constexpr uint32_t warmupSamples = f_max(2 + ESR_SENSE_STABLE_SAMPLES, 1 / PUMP_FILTER_ALPHA);
+    if (sampleCount < warmupSamples)
+    {
+        sampleCount++;
+
+        pumpAlpha = f_max(1.0f / sampleCount, PUMP_FILTER_ALPHA);
+    }
 
     // Exponential moving average (aka first order lpf)
     pumpCurrentSenseVoltage =
-        (1 - PUMP_FILTER_ALPHA) * pumpCurrentSenseVoltage +
-        PUMP_FILTER_ALPHA * (result.PumpCurrentVoltage - virtualGroundVoltageInt);
+        (1 - pumpAlpha) * pumpCurrentSenseVoltage +
+        pumpAlpha * (result.PumpCurrentVoltage - virtualGroundVoltageInt);
 
 #ifdef BATTERY_INPUT_DIVIDER
     internalHeaterVoltage = result.HeaterSupplyVoltage;
 #endif
-
-    // Shift history over by one
-    r_3 = r_2;
-    r_2 = r_1;
 }
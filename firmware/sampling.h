@@ -1,8 +1,12 @@
 #pragma once
 
+#include <cstdint>
+#include <cstddef>
+
 #include "wideband_config.h"
 
 #include "timer.h"
+#include "esr_demodulator.h"
 
 struct ISampler
 {
@@ -13,6 +17,8 @@ struct ISampler
     virtual float GetInternalHeaterVoltage() const = 0;
     virtual float GetSensorTemperature() const = 0;
     virtual float GetSensorInternalResistance() const = 0;
+    // True once the filters have seen enough samples to be trusted
+    virtual bool IsStable() const = 0;
 };
 
 struct AnalogChannelResult;
@@ -30,17 +36,18 @@ public:
     float GetInternalHeaterVoltage() const override;
     float GetSensorTemperature() const override;
     float GetSensorInternalResistance() const override;
+    bool IsStable() const override;
 
 private:
-    float r_2 = 0;
-    float r_3 = 0;
+    EsrDemodulator esr;
 
-    float nernstAc = 0;
-    float nernstDc = 0;
     float nernstV = 0;
     float pumpCurrentSenseVoltage = 0;
     int nernstClamped = 0;
 
+    // Samples applied so far, stops counting once the filters are warmed up
+    uint32_t sampleCount = 0;
+
 #ifdef BATTERY_INPUT_DIVIDER
     float internalHeaterVoltage = 0;
 #endif
@@ -50,6 +57,32 @@ private:
 
 // Get the sampler for a particular channel
 const ISampler& GetSampler(int ch);
+// Copy of the sampler state taken between two samples, for readers outside the sampling thread
+Sampler GetSamplerSnapshot(int ch);
+
+// CPU cycles spent per ADC cycle by the sampling thread, averaged and worst case.
+// Zero on cores without a cycle counter.
+uint32_t GetSamplingCycles();
+uint32_t GetSamplingCyclesMax();
+
+// Parts of a sampling thread pass timed by its cycle profiler, in report order
+enum class SamplingStage : uint8_t
+{
+    // Restart the ADC, toggle the ESR driver
+    Start,
+    // Raw sample stream and sensor scope
+    Stream,
+    // ApplySample() on every channel
+    Apply,
+    // Sensor scope trigger checks
+    Triggers,
+
+    Count
+};
+
+// CycleProfiler::Report() of the sampling thread, only on cores with a cycle
+// counter (PORT_SUPPORTS_RT). reset starts the statistics over after this report.
+size_t GetSamplingProfile(uint8_t* buffer, size_t size, bool reset);
 
 #ifdef BOARD_HAS_VOLTAGE_SENSE
 float GetSupplyVoltage();
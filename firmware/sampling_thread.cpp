@@ -2,10 +2,19 @@
 #include "hal.h"
 
 #include "io_pins.h"
-#include "livedata.h"
 
 #include "sampling.h"
 #include "port.h"
+#include "thread_monitor.h"
+#include "cycle_profiler.h"
+
+#if defined(TS_ENABLED)
+#include "heater_control.h"
+#include "lambda_conversion.h"
+#include "fault.h"
+#include "sample_stream.h"
+#include "sensor_scope.h"
+#endif
 
 static Sampler samplers[AFR_CHANNELS];
 
@@ -14,6 +23,58 @@ const ISampler& GetSampler(int ch)
     return samplers[ch];
 }
 
+Sampler GetSamplerSnapshot(int ch)
+{
+    // The sampling thread can't run while we copy, so all fields come from the same sample
+    chSysLock();
+    Sampler copy = samplers[ch];
+    chSysUnlock();
+
+    return copy;
+}
+
+static uint32_t samplingCycles = 0;
+static uint32_t samplingCyclesMax = 0;
+
+uint32_t GetSamplingCycles()
+{
+    return samplingCycles;
+}
+
+uint32_t GetSamplingCyclesMax()
+{
+    return samplingCyclesMax;
+}
+
+#if PORT_SUPPORTS_RT
+static CycleProfiler profiler(static_cast<size_t>(SamplingStage::Count));
+
+size_t GetSamplingProfile(uint8_t* buffer, size_t size, bool reset)
+{
+    // All stages from the same pass. Reported straight from the profiler,
+    // a copy would be most of the TS thread's stack.
+    chSysLock();
+    size_t length = profiler.Report(buffer, size);
+    chSysUnlock();
+
+    if (reset)
+    {
+        profiler.RequestReset();
+    }
+
+    return length;
+}
+#endif
+
+static void ProfileMark(SamplingStage stage)
+{
+#if PORT_SUPPORTS_RT
+    profiler.Mark(static_cast<size_t>(stage), chSysGetRealtimeCounterX());
+#else
+    (void)stage;
+#endif
+}
+
 static THD_WORKING_AREA(waSamplingThread, 256);
 
 #ifdef BOARD_HAS_VOLTAGE_SENSE
@@ -31,6 +92,21 @@ float GetMcuTemperature()
     return mcuTemp;
 }
 
+#if defined(TS_ENABLED)
+static void ScopeCheckTriggers()
+{
+    auto& scope = GetSensorScope();
+    int ch = scope.GetChannel();
+
+    if (scope.GetState() != ScopeState::Armed || ch >= AFR_CHANNELS)
+    {
+        return;
+    }
+
+    scope.CheckTriggers((uint8_t)GetCurrentFault(ch), (uint8_t)GetHeaterState(ch), GetLambda(ch));
+}
+#endif
+
 static void SamplingThread(void*)
 {
     chRegSetThreadName("Sampling");
@@ -42,13 +118,45 @@ static void SamplingThread(void*)
 
     AnalogSampleStart();
 
+    // ESR driver half-cycle of the next conversion, and cycles into it
+    bool esrPhase = false;
+    int esrCycle = 0;
+
+#if defined(TS_ENABLED)
+    int scopeCheckCounter = 0;
+#endif
+
     while(true)
     {
         auto result = AnalogSampleFinish();
+#if PORT_SUPPORTS_RT
+        rtcnt_t start = chSysGetRealtimeCounterX();
+        profiler.Begin(start);
+#endif
+        ThreadLoopBegin(ThreadId::Sampling);
         AnalogSampleStart();
 
+        // Half-cycle of the conversion that just finished
+        bool samplePhase = esrPhase;
+
         // Toggle the pin after sampling so that any switching noise occurs while we're doing our math instead of when sampling
-        ToggleESRDriver(GetSensorType());
+        // The samplers count ESR_SAMPLES_PER_HALF_PERIOD conversions per half-cycle the same way
+        if (++esrCycle >= ESR_SAMPLES_PER_HALF_PERIOD)
+        {
+            esrCycle = 0;
+            esrPhase = !esrPhase;
+            ToggleESRDriver(GetSensorType());
+        }
+        ProfileMark(SamplingStage::Start);
+
+#if defined(TS_ENABLED)
+        uint8_t heaterPhase = GetHeaterPwmPhase();
+        GetSampleStream().Add(result.ch, AFR_CHANNELS, result.VirtualGroundVoltageInt, samplePhase, heaterPhase);
+        GetSensorScope().Add(result.ch, AFR_CHANNELS, result.VirtualGroundVoltageInt, samplePhase, heaterPhase);
+#else
+        (void)samplePhase;
+#endif
+        ProfileMark(SamplingStage::Stream);
 
         #ifdef BOARD_HAS_VOLTAGE_SENSE
         supplyVoltage = result.SupplyVoltage;
@@ -59,10 +167,30 @@ static void SamplingThread(void*)
         {
             samplers[ch].ApplySample(result.ch[ch], result.VirtualGroundVoltageInt);
         }
+        ProfileMark(SamplingStage::Apply);
 
 #if defined(TS_ENABLED)
-        /* tunerstudio */
-        SamplingUpdateLiveData();
+        if (++scopeCheckCounter >= SCOPE_TRIGGER_CHECK_CYCLES)
+        {
+            scopeCheckCounter = 0;
+            ScopeCheckTriggers();
+        }
+#endif
+        ProfileMark(SamplingStage::Triggers);
+
+        ThreadLoopEnd(ThreadId::Sampling);
+
+#if PORT_SUPPORTS_RT
+        profiler.End();
+
+        uint32_t cycles = chSysGetRealtimeCounterX() - start;
+
+        // Average over ~16 cycles
+        samplingCycles += ((int32_t)cycles - (int32_t)samplingCycles) / 16;
+        if (cycles > samplingCyclesMax)
+        {
+            samplingCyclesMax = cycles;
+        }
 #endif
     }
 }
@@ -0,0 +1,115 @@
+#include "sensor_estimator.h"
+
+#include <cmath>
+
+SensorEstimator::SensorEstimator(float periodSec)
+    : m_period(periodSec)
+{
+}
+
+// How far value is outside lo..hi, in units of scale
+static float Excess(float value, float lo, float hi, float scale)
+{
+    if (value < lo)
+    {
+        return (lo - value) / scale;
+    }
+
+    if (value > hi)
+    {
+        return (value - hi) / scale;
+    }
+
+    return 0;
+}
+
+void SensorEstimator::UpdateTemperature(const SensorEstimatorInputs& in)
+{
+    // Heater power in V^2, what changes it changes the temperature
+    float heaterPower = in.HeaterEffectiveVoltage * in.HeaterEffectiveVoltage;
+    float heaterStep = SENSOR_EST_HEATER_GAIN * (heaterPower - m_lastHeaterPower);
+    m_lastHeaterPower = heaterPower;
+
+    m_temperatureVariance +=
+        SENSOR_EST_TEMP_DRIFT * SENSOR_EST_TEMP_DRIFT * m_period +
+        heaterStep * heaterStep;
+
+    if (in.EsrTemperature <= 0)
+    {
+        return;
+    }
+
+    constexpr float r = SENSOR_EST_ESR_TEMP_SIGMA * SENSOR_EST_ESR_TEMP_SIGMA;
+
+    if (!m_temperatureInit)
+    {
+        m_temperature = in.EsrTemperature;
+        m_temperatureVariance = r;
+        m_temperatureInit = true;
+        return;
+    }
+
+    float k = m_temperatureVariance / (m_temperatureVariance + r);
+    m_temperature += k * (in.EsrTemperature - m_temperature);
+    m_temperatureVariance *= 1 - k;
+}
+
+void SensorEstimator::UpdateLambda(const SensorEstimatorInputs& in)
+{
+    m_lambdaVariance += SENSOR_EST_LAMBDA_DRIFT * SENSOR_EST_LAMBDA_DRIFT * m_period;
+
+    // Don't let it run away while there is nothing to measure
+    if (m_lambdaVariance > 1)
+    {
+        m_lambdaVariance = 1;
+    }
+
+    if (!in.PumpActive)
+    {
+        return;
+    }
+
+    float nernst = (in.NernstDc - NERNST_TARGET) / SENSOR_EST_NERNST_DEV;
+    float pump = Excess(in.PumpDuty, SENSOR_EST_PUMP_DUTY_MIN, SENSOR_EST_PUMP_DUTY_MAX, SENSOR_EST_PUMP_DUTY_DEV);
+    float temperature = m_temperatureInit
+        ? (m_temperature - in.TargetTemperature) / SENSOR_EST_TEMP_DEV
+        : 1000;
+    float range = in.Lambda < SENSOR_EST_LAMBDA_MIN
+        ? (SENSOR_EST_LAMBDA_MIN - in.Lambda) / SENSOR_EST_LAMBDA_RANGE_DEV
+        : 0;
+
+    // Nothing off is the sensor's own noise, each deviation adds to it
+    float r = SENSOR_EST_LAMBDA_SIGMA * SENSOR_EST_LAMBDA_SIGMA *
+        (1 + nernst * nernst + pump * pump + temperature * temperature + range * range);
+
+    if (!m_lambdaInit)
+    {
+        m_lambda = in.Lambda;
+        m_lambdaVariance = r < 1 ? r : 1;
+        m_lambdaInit = true;
+        return;
+    }
+
+    float k = m_lambdaVariance / (m_lambdaVariance + r);
+    m_lambda += k * (in.Lambda - m_lambda);
+    m_lambdaVariance *= 1 - k;
+}
+
+void SensorEstimator::Update(const SensorEstimatorInputs& in)
+{
+    // Temperature first, the lambda measurement noise depends on it
+    UpdateTemperature(in);
+    UpdateLambda(in);
+}
+
+float SensorEstimator::GetConfidence() const
+{
+    constexpr float ok = SENSOR_EST_LAMBDA_SIGMA_OK * SENSOR_EST_LAMBDA_SIGMA_OK;
+
+    return ok / (ok + m_lambdaVariance);
+}
+
+float SensorEstimator::GetLambdaSigma() const
+{
+    return sqrtf(m_lambdaVariance);
+}
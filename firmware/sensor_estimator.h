@@ -0,0 +1,80 @@
+#pragma once
+
+#include "wideband_config.h"
+
+struct SensorEstimatorInputs
+{
+    // From the pump current, see GetLambda()
+    float Lambda;
+    float NernstDc;
+    // 0..1
+    float PumpDuty;
+    // Pump loop is closed, otherwise the pump current says nothing about lambda
+    bool PumpActive;
+
+    // From the ESR, 0 if it couldn't be measured
+    float EsrTemperature;
+    float TargetTemperature;
+    float HeaterEffectiveVoltage;
+};
+
+/**
+ * Tracks lambda and sensor temperature with a Kalman filter each, and how
+ * much the lambda estimate can be trusted.
+ *
+ * Temperature is a random walk measured through the ESR. Heater power steps
+ * add uncertainty, so a heater change is followed faster.
+ *
+ * Lambda is a random walk measured through the pump current. How far that
+ * measurement can be trusted depends on the rest of the sensor: its noise
+ * grows with the nernst error, the pump driver nearing its stops, the
+ * temperature estimate away from target and lambda below what the sensor
+ * is specified for. While the pump isn't running there's no measurement
+ * at all and the uncertainty keeps growing.
+ *
+ * Confidence is SENSOR_EST_LAMBDA_SIGMA_OK^2 / (that + lambda variance), so
+ * 0.5 is a standard deviation of SENSOR_EST_LAMBDA_SIGMA_OK.
+ */
+class SensorEstimator
+{
+public:
+    SensorEstimator(float periodSec = PUMP_CONTROL_PERIOD / 1000.0f);
+
+    void Update(const SensorEstimatorInputs& in);
+
+    float GetLambda() const
+    {
+        return m_lambda;
+    }
+
+    float GetTemperature() const
+    {
+        return m_temperature;
+    }
+
+    // 0..1
+    float GetConfidence() const;
+
+    bool IsValid() const
+    {
+        return GetConfidence() >= SENSOR_EST_VALID_CONFIDENCE;
+    }
+
+    // Standard deviation of the lambda estimate
+    float GetLambdaSigma() const;
+
+private:
+    void UpdateTemperature(const SensorEstimatorInputs& in);
+    void UpdateLambda(const SensorEstimatorInputs& in);
+
+    float m_period;
+
+    float m_lambda = 0;
+    float m_lambdaVariance = 1;
+    bool m_lambdaInit = false;
+
+    float m_temperature = 0;
+    float m_temperatureVariance = 0;
+    bool m_temperatureInit = false;
+    float m_lastHeaterPower = 0;
+};
@@ -0,0 +1,273 @@
+#include "sensor_response.h"
+
+#include <cmath>
+
+static constexpr float pi = 3.14159265f;
+
+static const uint8_t harmonics[2] = { 1, 3 };
+
+SensorResponseEstimator::SensorResponseEstimator(uint32_t periodSamples, uint32_t burstPeriods, uint32_t intervalMs, float loopPeriodMs, float ditherMa)
+    // Square wave needs at least the third harmonic below Nyquist
+    : m_periodSamples(periodSamples < 8 ? 8 : periodSamples)
+    , m_burstPeriods(burstPeriods ? burstPeriods : 1)
+    , m_intervalSamples(intervalMs / loopPeriodMs)
+    , m_holdoffSamples(SENSOR_RESPONSE_HOLDOFF_MS / loopPeriodMs)
+    , m_loopPeriodMs(loopPeriodMs)
+    , m_ditherMa(ditherMa)
+{
+    if (m_holdoffSamples > m_intervalSamples)
+    {
+        m_holdoffSamples = m_intervalSamples;
+    }
+
+    // First burst once the sensor has been usable for the holdoff
+    m_idle = m_intervalSamples - m_holdoffSamples;
+
+    for (int h = 0; h < 2; h++)
+    {
+        float w = 2 * pi * harmonics[h] / m_periodSamples;
+        m_stepRe[h] = cosf(w);
+        m_stepIm[h] = -sinf(w);
+    }
+
+    float w = 2 * pi / (m_periodSamples * m_burstPeriods);
+    m_windowStepRe = cosf(w);
+    m_windowStepIm = sinf(w);
+}
+
+float SensorResponseEstimator::GetDither() const
+{
+    if (!m_running)
+    {
+        return 0;
+    }
+
+    return m_sample < m_periodSamples / 2 ? m_ditherMa : -m_ditherMa;
+}
+
+void SensorResponseEstimator::Start()
+{
+    m_running = true;
+    m_sample = 0;
+    m_period = 0;
+
+    m_windowRe = 1;
+    m_windowIm = 0;
+
+    for (int h = 0; h < 2; h++)
+    {
+        m_refRe[h] = 1;
+        m_refIm[h] = 0;
+        m_uRe[h] = m_uIm[h] = 0;
+        m_yRe[h] = m_yIm[h] = 0;
+    }
+}
+
+void SensorResponseEstimator::Update(float pumpCurrent, float nernstDc, bool canRun)
+{
+    // Without a dither there's nothing to measure, the sums would only hold
+    // noise and the phases of noise make no sense
+    if (!IsEnabled())
+    {
+        return;
+    }
+
+    if (!canRun)
+    {
+        if (m_running)
+        {
+            // Try again once things have settled
+            m_running = false;
+            m_idle = m_intervalSamples - m_holdoffSamples;
+        }
+
+        return;
+    }
+
+    if (!m_running)
+    {
+        // Not before the last burst's sums are used up
+        if (m_pending.load(std::memory_order_acquire))
+        {
+            return;
+        }
+
+        if (++m_idle >= m_intervalSamples)
+        {
+            m_idle = 0;
+            Start();
+        }
+
+        return;
+    }
+
+    if (m_period >= SENSOR_RESPONSE_SETTLE_PERIODS)
+    {
+        // Hann window over the burst, whatever lambda does meanwhile hardly
+        // leaks in to the dither frequencies
+        float window = 0.5f - 0.5f * m_windowRe;
+        float u = window * pumpCurrent;
+        float y = window * nernstDc;
+
+        float re = m_windowRe * m_windowStepRe - m_windowIm * m_windowStepIm;
+        m_windowIm = m_windowRe * m_windowStepIm + m_windowIm * m_windowStepRe;
+        m_windowRe = re;
+
+        for (int h = 0; h < 2; h++)
+        {
+            m_uRe[h] += u * m_refRe[h];
+            m_uIm[h] += u * m_refIm[h];
+            m_yRe[h] += y * m_refRe[h];
+            m_yIm[h] += y * m_refIm[h];
+
+            float re = m_refRe[h] * m_stepRe[h] - m_refIm[h] * m_stepIm[h];
+            m_refIm[h] = m_refRe[h] * m_stepIm[h] + m_refIm[h] * m_stepRe[h];
+            m_refRe[h] = re;
+        }
+    }
+
+    if (++m_sample < m_periodSamples)
+    {
+        return;
+    }
+
+    m_sample = 0;
+    m_period++;
+
+    for (int h = 0; h < 2; h++)
+    {
+        m_refRe[h] = 1;
+        m_refIm[h] = 0;
+    }
+
+    if (m_period >= SENSOR_RESPONSE_SETTLE_PERIODS + m_burstPeriods)
+    {
+        m_running = false;
+        m_pending.store(true, std::memory_order_release);
+    }
+}
+
+void SensorResponseEstimator::Process()
+{
+    if (!m_pending.load(std::memory_order_acquire))
+    {
+        return;
+    }
+
+    Finish();
+
+    m_pending.store(false, std::memory_order_release);
+}
+
+// Phase lag of the nernst voltage behind the pump current, radians
+static float Lag(float uRe, float uIm, float yRe, float yIm)
+{
+    // y * conj(u) has the phase of y / u
+    float re = yRe * uRe + yIm * uIm;
+    float im = yIm * uRe - yRe * uIm;
+
+    return -atan2f(im, re);
+}
+
+// Sine and cosine of theta radians per pass, the fundamental, and of 3 theta
+struct DitherAngles
+{
+    float Sin1, Cos1;
+    float Sin3, Cos3;
+};
+
+// Lag of a first order lag a held command goes through, at an angle per
+// pass of the given sine and cosine, past the one pass any held command is late by
+static float LagPhase(float a, float sinTheta, float cosTheta)
+{
+    return atan2f(a * sinTheta, 1 - a * cosTheta);
+}
+
+// How much less than a dead time the lag delays the third harmonic, rising
+// from 0 to pi as the pole a goes from 0 to 1
+static float LagShortfall(float a, const DitherAngles& angles)
+{
+    return 3 * LagPhase(a, angles.Sin1, angles.Cos1) - LagPhase(a, angles.Sin3, angles.Cos3);
+}
+
+void SensorResponseEstimator::Finish()
+{
+    // Nothing measured, the dither never made it to the pump
+    if (m_uRe[0] == 0 && m_uIm[0] == 0)
+    {
+        return;
+    }
+
+    float lag1 = Lag(m_uRe[0], m_uIm[0], m_yRe[0], m_yIm[0]);
+    float lag3 = Lag(m_uRe[1], m_uIm[1], m_yRe[1], m_yIm[1]);
+
+    // The lag at the fundamental is never negative, allow a little noise
+    if (lag1 < -pi / 2)
+    {
+        lag1 += 2 * pi;
+    }
+
+    // The third harmonic lags within half a turn of the first, it's
+    // between one and three times as much
+    while (lag3 < lag1 - pi)
+    {
+        lag3 += 2 * pi;
+    }
+    while (lag3 >= lag1 + pi)
+    {
+        lag3 -= 2 * pi;
+    }
+
+    // Sampled exactly, the sensor is the pole a = exp(-T / tau) with the
+    // command held for a pass T, then the dead time
+    float theta = 2 * pi / m_periodSamples;
+    const DitherAngles angles = { sinf(theta), cosf(theta), sinf(3 * theta), cosf(3 * theta) };
+
+    float aMax = expf(-m_loopPeriodMs / SENSOR_RESPONSE_MAX_TAU_MS);
+    float shortfall = 3 * lag1 - lag3;
+
+    if (shortfall >= LagShortfall(aMax, angles))
+    {
+        return;
+    }
+
+    // Bisect for the pole, the shortfall only grows with it
+    float lo = 0;
+    float hi = shortfall > 0 ? aMax : 0;
+    for (int i = 0; i < 24 && hi > 0; i++)
+    {
+        float mid = (lo + hi) / 2;
+
+        if (LagShortfall(mid, angles) < shortfall)
+        {
+            lo = mid;
+        }
+        else
+        {
+            hi = mid;
+        }
+    }
+
+    float a = (lo + hi) / 2;
+    float tau = a > 0 ? -m_loopPeriodMs / logf(a) : 0;
+
+    // What's left of the lag at the fundamental is dead time
+    float delay = (lag1 - theta - LagPhase(a, angles.Sin1, angles.Cos1)) * m_loopPeriodMs / theta;
+    if (delay < 0)
+    {
+        delay = 0;
+    }
+
+    if (m_results == 0)
+    {
+        m_tauMs = tau;
+        m_delayMs = delay;
+    }
+    else
+    {
+        m_tauMs += SENSOR_RESPONSE_AVERAGE * (tau - m_tauMs);
+        m_delayMs += SENSOR_RESPONSE_AVERAGE * (delay - m_delayMs);
+    }
+
+    m_results++;
+}
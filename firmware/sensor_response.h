@@ -0,0 +1,118 @@
+#pragma once
+
+#include <cstdint>
+#include <atomic>
+
+#include "wideband_config.h"
+
+/**
+ * Measures how fast the sensor responds, as a first order lag plus a dead
+ * time from the pump current to the nernst voltage.
+ *
+ * Every so often a burst of a small square wave is added to the pump
+ * current in closed loop. Its first and third harmonic are demodulated
+ * from the pump current actually commanded, dither plus the loop's own
+ * reaction, and from the nernst voltage. The ratio of the two at each
+ * frequency is the sensor alone, closed loop or not. A lag tau delays the
+ * third harmonic less than three times the first, a dead time exactly
+ * three times, so the two phases give both:
+ *
+ *   phase(w) = atan(w * tau) + w * delay
+ *
+ * The dither shows in the pump current and so in lambda, but averages out
+ * over each dither period. Results are averaged over bursts, what's being
+ * followed is the sensor ageing.
+ *
+ * Turning a burst into a result takes a few dozen atan2f(), too much for
+ * one pump loop pass on a soft float core. Update() only collects, Process()
+ * does the rest from a thread with time to spare.
+ */
+class SensorResponseEstimator
+{
+public:
+    SensorResponseEstimator(
+        uint32_t periodSamples = SENSOR_RESPONSE_PERIOD_SAMPLES,
+        uint32_t burstPeriods = SENSOR_RESPONSE_BURST_PERIODS,
+        uint32_t intervalMs = SENSOR_RESPONSE_INTERVAL_MS,
+        float loopPeriodMs = PUMP_CONTROL_PERIOD,
+        float ditherMa = SENSOR_RESPONSE_DITHER_MA);
+
+    // No interval or no dither, bursts never run
+    bool IsEnabled() const
+    {
+        return m_intervalSamples > 0 && m_ditherMa > 0;
+    }
+
+    // mA to add to the pump current this pass, 0 between bursts
+    float GetDither() const;
+
+    // Once per pump loop pass with the pump current commanded, dither included,
+    // and the nernst voltage the command was based on. A burst only runs while
+    // canRun, dropping it aborts the burst.
+    void Update(float pumpCurrent, float nernstDc, bool canRun);
+
+    // Works out the last burst's result if there is one waiting, from any one
+    // thread other than Update()'s. No new burst starts until it has run.
+    void Process();
+
+    bool HasResult() const
+    {
+        return m_results > 0;
+    }
+
+    float GetTimeConstantMs() const
+    {
+        return m_tauMs;
+    }
+
+    float GetDelayMs() const
+    {
+        return m_delayMs;
+    }
+
+    // Bursts that gave a result
+    uint32_t GetResultCount() const
+    {
+        return m_results;
+    }
+
+private:
+    void Start();
+    void Finish();
+
+    uint32_t m_periodSamples;
+    uint32_t m_burstPeriods;
+    uint32_t m_intervalSamples;
+    uint32_t m_holdoffSamples;
+    float m_loopPeriodMs;
+    float m_ditherMa;
+
+    bool m_running = false;
+    // Burst finished, its sums wait for Process()
+    std::atomic<bool> m_pending{false};
+    uint32_t m_idle = 0;
+    uint32_t m_sample = 0;
+    uint32_t m_period = 0;
+
+    // First and third harmonic, one step of the reference per sample and
+    // the reference itself, restarted every period so it can't drift
+    float m_stepRe[2];
+    float m_stepIm[2];
+    float m_refRe[2];
+    float m_refIm[2];
+
+    // Window, same again once per burst
+    float m_windowStepRe;
+    float m_windowStepIm;
+    float m_windowRe;
+    float m_windowIm;
+
+    float m_uRe[2];
+    float m_uIm[2];
+    float m_yRe[2];
+    float m_yIm[2];
+
+    uint32_t m_results = 0;
+    float m_tauMs = 0;
+    float m_delayMs = 0;
+};
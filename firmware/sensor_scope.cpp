@@ -0,0 +1,230 @@
+#include "sensor_scope.h"
+
+#include "port.h"
+
+#include <cstring>
+
+SensorScope::SensorScope()
+{
+    memset(&m_control, 0, sizeof(m_control));
+    m_control.TriggerMask = SCOPE_DEFAULT_TRIGGERS;
+    m_control.PostTriggerPercent = SCOPE_POST_TRIGGER_PERCENT;
+    m_control.LambdaStep = SCOPE_LAMBDA_STEP;
+
+    // Armed from power on, faults right after boot are the interesting ones
+    Arm();
+}
+
+void SensorScope::Arm()
+{
+    // Stop the producer while the capture is reset
+    m_state.store(static_cast<uint8_t>(ScopeState::Idle));
+
+    m_count = 0;
+    m_pendingTrigger = 0;
+    m_havePrevious = false;
+    m_control.TriggeredBy = 0;
+    m_manualTrigger.store(0);
+
+    m_state.store(static_cast<uint8_t>(ScopeState::Armed));
+}
+
+void SensorScope::Trigger(uint8_t source)
+{
+    m_pendingTrigger |= source & (m_control.TriggerMask | SCOPE_TRIGGER_MANUAL);
+}
+
+void SensorScope::Add(const AnalogChannelResult* channels, int channelCount, float virtualGroundVoltageInt,
+                      bool esrPhase, uint8_t heaterPhase)
+{
+    uint16_t sequence = m_sequence++;
+
+    auto state = static_cast<ScopeState>(m_state.load(std::memory_order_relaxed));
+    if (state != ScopeState::Armed && state != ScopeState::Triggered)
+    {
+        return;
+    }
+
+    int ch = m_control.Channel;
+    if (ch >= channelCount)
+    {
+        return;
+    }
+
+    FillSampleRecord(m_records[m_head % Depth], sequence, ch, channels[ch], virtualGroundVoltageInt, esrPhase, heaterPhase);
+    m_head++;
+
+    if (m_count < Depth)
+    {
+        m_count++;
+    }
+
+    if (state == ScopeState::Armed)
+    {
+        if (channels[ch].NernstClamped)
+        {
+            Trigger(SCOPE_TRIGGER_NERNST_CLAMP);
+        }
+
+        if (m_manualTrigger.exchange(0))
+        {
+            Trigger(SCOPE_TRIGGER_MANUAL);
+        }
+
+        if (!m_pendingTrigger)
+        {
+            return;
+        }
+
+        m_control.TriggeredBy = m_pendingTrigger;
+        m_triggerPos = m_head - 1;
+
+        // Keep at least the trigger record itself
+        uint32_t post = Depth * m_control.PostTriggerPercent / 100;
+        m_postRemaining = post < Depth ? post : Depth - 1;
+
+        m_state.store(static_cast<uint8_t>(ScopeState::Triggered));
+    }
+    else
+    {
+        m_postRemaining--;
+    }
+
+    if (m_postRemaining == 0)
+    {
+        m_state.store(static_cast<uint8_t>(ScopeState::Frozen));
+    }
+}
+
+void SensorScope::CheckTriggers(uint8_t fault, uint8_t heaterState, float lambda)
+{
+    if (GetState() != ScopeState::Armed)
+    {
+        return;
+    }
+
+    if (m_havePrevious)
+    {
+        if (fault != m_lastFault && fault != 0)
+        {
+            Trigger(SCOPE_TRIGGER_FAULT);
+        }
+
+        if (heaterState != m_lastHeaterState)
+        {
+            Trigger(SCOPE_TRIGGER_HEATER_STATE);
+        }
+
+        float step = lambda - m_lastLambda;
+        if (step < 0)
+        {
+            step = -step;
+        }
+
+        if (m_control.LambdaStep && step >= m_control.LambdaStep * 0.01f)
+        {
+            Trigger(SCOPE_TRIGGER_LAMBDA_STEP);
+        }
+    }
+
+    m_lastFault = fault;
+    m_lastHeaterState = heaterState;
+    m_lastLambda = lambda;
+    m_havePrevious = true;
+}
+
+ScopeState SensorScope::GetState() const
+{
+    return static_cast<ScopeState>(m_state.load());
+}
+
+uint8_t SensorScope::GetChannel() const
+{
+    return m_control.Channel;
+}
+
+size_t SensorScope::GetPageSize() const
+{
+    return sizeof(ScopeControl) + sizeof(m_records);
+}
+
+void SensorScope::ReadPage(size_t offset, uint8_t* buffer, size_t count) const
+{
+    auto state = GetState();
+    uint32_t oldest = m_head - m_count;
+
+    ScopeControl c = m_control;
+    c.State = static_cast<uint8_t>(state);
+    c.Count = m_count;
+    c.TriggerIndex = (state == ScopeState::Triggered || state == ScopeState::Frozen) ? m_triggerPos - oldest : 0xFFFF;
+    c.Depth = Depth;
+
+    for (size_t i = 0; i < count; i++)
+    {
+        size_t o = offset + i;
+
+        if (o < sizeof(c))
+        {
+            buffer[i] = reinterpret_cast<const uint8_t*>(&c)[o];
+            continue;
+        }
+
+        o -= sizeof(c);
+        size_t index = o / sizeof(SampleStreamRecord);
+
+        if (index < m_count)
+        {
+            auto& r = m_records[(oldest + index) % Depth];
+            buffer[i] = reinterpret_cast<const uint8_t*>(&r)[o % sizeof(SampleStreamRecord)];
+        }
+        else
+        {
+            buffer[i] = 0;
+        }
+    }
+}
+
+bool SensorScope::WritePage(size_t offset, const uint8_t* data, size_t count)
+{
+    // Only the host settings are writable
+    if (offset + count > offsetof(ScopeControl, TriggeredBy))
+    {
+        return false;
+    }
+
+    ScopeControl c = m_control;
+    c.State = static_cast<uint8_t>(GetState());
+    memcpy(reinterpret_cast<uint8_t*>(&c) + offset, data, count);
+
+    m_control.TriggerMask = c.TriggerMask;
+    m_control.Channel = c.Channel;
+    m_control.PostTriggerPercent = c.PostTriggerPercent > 100 ? 100 : c.PostTriggerPercent;
+    m_control.LambdaStep = c.LambdaStep;
+
+    if (offset + count > offsetof(ScopeControl, State))
+    {
+        switch (static_cast<ScopeState>(c.State))
+        {
+        case ScopeState::Idle:
+            m_state.store(static_cast<uint8_t>(ScopeState::Idle));
+            break;
+        case ScopeState::Armed:
+            Arm();
+            break;
+        case ScopeState::Triggered:
+            m_manualTrigger.store(1);
+            break;
+        default:
+            break;
+        }
+    }
+
+    return true;
+}
+
+static SensorScope sensorScope;
+
+SensorScope& GetSensorScope()
+{
+    return sensorScope;
+}
@@ -0,0 +1,106 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <atomic>
+
+#include "sample_stream.h"
+
+#define SCOPE_TRIGGER_FAULT         0x01
+#define SCOPE_TRIGGER_LAMBDA_STEP   0x02
+#define SCOPE_TRIGGER_NERNST_CLAMP  0x04
+#define SCOPE_TRIGGER_HEATER_STATE  0x08
+#define SCOPE_TRIGGER_MANUAL        0x80
+
+enum class ScopeState : uint8_t
+{
+    Idle,
+    // Recording, waiting for a trigger
+    Armed,
+    // Recording the post-trigger part
+    Triggered,
+    // Capture complete, ready to download
+    Frozen,
+};
+
+// Start of the scope TS page, followed by Count records oldest first
+struct ScopeControl
+{
+    // Written by the host
+    uint8_t TriggerMask;
+    uint8_t Channel;
+    uint8_t PostTriggerPercent;
+    // 0.01 lambda, 0 disables the lambda step trigger
+    uint8_t LambdaStep;
+    // Write Armed to re-arm, Triggered to trigger now, Idle to stop
+    uint8_t State;
+
+    // Read only
+    uint8_t TriggeredBy;
+    uint16_t Count;
+    // Record index of the trigger
+    uint16_t TriggerIndex;
+    uint16_t Depth;
+    uint8_t pad[4];
+} __attribute__((packed));
+
+static_assert(sizeof(ScopeControl) == 16, "ScopeControl size incorrect");
+
+/**
+ * Pre-trigger capture of the raw samples of one channel.
+ *
+ * While armed every ADC cycle is recorded into a ring. Once a trigger
+ * fires the remaining PostTriggerPercent of the ring is filled and the
+ * capture freezes until the host re-arms it, so intermittent faults are
+ * caught with the lead-up to them even when nobody was logging.
+ */
+class SensorScope
+{
+public:
+    SensorScope();
+
+    void Arm();
+
+    // Sampling thread, once per ADC cycle
+    void Add(const AnalogChannelResult* channels, int channelCount, float virtualGroundVoltageInt,
+             bool esrPhase, uint8_t heaterPhase);
+
+    // Sampling thread, every SCOPE_TRIGGER_CHECK_CYCLES: fires on a new fault,
+    // heater state change or lambda step of the recorded channel
+    void CheckTriggers(uint8_t fault, uint8_t heaterState, float lambda);
+
+    ScopeState GetState() const;
+    uint8_t GetChannel() const;
+
+    // Page access for the host
+    size_t GetPageSize() const;
+    void ReadPage(size_t offset, uint8_t* buffer, size_t count) const;
+    bool WritePage(size_t offset, const uint8_t* data, size_t count);
+
+private:
+    void Trigger(uint8_t source);
+
+    static constexpr uint32_t Depth = SCOPE_DEPTH;
+
+    SampleStreamRecord m_records[Depth];
+
+    ScopeControl m_control;
+    std::atomic<uint8_t> m_state;
+    std::atomic<uint8_t> m_manualTrigger{0};
+
+    // Free running write position and number of valid records
+    uint32_t m_head = 0;
+    uint32_t m_count = 0;
+    uint32_t m_triggerPos = 0;
+    uint32_t m_postRemaining = 0;
+    uint8_t m_pendingTrigger = 0;
+    uint16_t m_sequence = 0;
+
+    // Previous values for edge triggers
+    bool m_havePrevious = false;
+    uint8_t m_lastFault = 0;
+    uint8_t m_lastHeaterState = 0;
+    float m_lastLambda = 0;
+};
+
+SensorScope& GetSensorScope();
@@ -0,0 +1,46 @@
+#include "app_image.h"
+
+#include <rusefi/crc.h>
+
+// "VALI" - marks the cache as written by us rather than power-up garbage
+#define APP_IMAGE_CACHE_MAGIC 0x56414C49
+
+uint32_t AppImageCrcSoftware(const uint8_t* data, size_t size)
+{
+    return crc32(data, size);
+}
+
+uint32_t AppImageStoredCrc(const uint8_t* image, size_t imageSize)
+{
+    const uint8_t* tail = image + imageSize - AppImageCrcSize;
+
+    // Stored big endian, independent of host byte order
+    return (tail[0] << 24) | (tail[1] << 16) | (tail[2] << 8) | tail[3];
+}
+
+bool AppImageIsValid(const uint8_t* image, size_t imageSize, AppImageCrcFunc crc)
+{
+    if (imageSize <= AppImageCrcSize)
+    {
+        return false;
+    }
+
+    return crc(image, imageSize - AppImageCrcSize) == AppImageStoredCrc(image, imageSize);
+}
+
+void AppImageCacheSet(volatile AppImageValidCache& cache, uint32_t storedCrc)
+{
+    cache.Crc = storedCrc;
+    cache.Magic = APP_IMAGE_CACHE_MAGIC ^ storedCrc;
+}
+
+void AppImageCacheClear(volatile AppImageValidCache& cache)
+{
+    cache.Magic = 0;
+    cache.Crc = 0;
+}
+
+bool AppImageCacheHit(const volatile AppImageValidCache& cache, uint32_t storedCrc)
+{
+    return cache.Crc == storedCrc && cache.Magic == (APP_IMAGE_CACHE_MAGIC ^ storedCrc);
+}
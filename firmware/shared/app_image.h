@@ -0,0 +1,41 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+
+/**
+ * Application image layout, as produced by boards/f0_module/build_wideband.sh:
+ *
+ *   [ app code/data, padded with 0xFF ][ CRC32, big endian ]
+ *
+ * The image always fills the whole app flash region, so the CRC lives in the
+ * last word of the region and covers everything before it.
+ */
+constexpr size_t AppImageCrcSize = sizeof(uint32_t);
+
+// CRC function used to check the image, returns standard (zlib) CRC32
+using AppImageCrcFunc = uint32_t (*)(const uint8_t* data, size_t size);
+
+// Portable software implementation, used on host and if no CRC unit is available
+uint32_t AppImageCrcSoftware(const uint8_t* data, size_t size);
+
+// Read the CRC stored at the end of the image
+uint32_t AppImageStoredCrc(const uint8_t* image, size_t imageSize);
+
+// Returns true if the image CRC matches the one stored in its last word
+bool AppImageIsValid(const uint8_t* image, size_t imageSize, AppImageCrcFunc crc = AppImageCrcSoftware);
+
+/**
+ * Result of a previous successful check, kept in RAM that survives a warm reset.
+ * It is tied to the stored CRC, so a different image (or random RAM contents
+ * after power up) never looks validated.
+ */
+struct AppImageValidCache
+{
+    uint32_t Magic;
+    uint32_t Crc;
+};
+
+void AppImageCacheSet(volatile AppImageValidCache& cache, uint32_t storedCrc);
+void AppImageCacheClear(volatile AppImageValidCache& cache);
+bool AppImageCacheHit(const volatile AppImageValidCache& cache, uint32_t storedCrc);
@@ -0,0 +1,456 @@
+#include "config_journal.h"
+
+#include <rusefi/crc.h>
+
+#include <cstring>
+
+// "WBCJ"
+#define JOURNAL_MAGIC 0x4A434257
+
+namespace
+{
+
+struct BankHeader
+{
+    uint32_t Magic;
+    uint32_t Sequence;
+    uint32_t ImageSize;
+    // CRC of the fields above
+    uint32_t Crc;
+};
+static_assert(sizeof(BankHeader) == 16, "BankHeader size incorrect");
+
+struct RecordHeader
+{
+    uint16_t PayloadSize;
+    // Inverted copy, catches a header that was only partially programmed
+    uint16_t PayloadSizeInv;
+};
+
+struct RunHeader
+{
+    uint16_t Offset;
+    uint16_t Length;
+};
+
+// More changed runs than this in one save and the whole image is written instead
+constexpr int MaxRuns = 16;
+
+// Replay granularity when diffing against the stored image
+constexpr size_t WindowSize = 64;
+
+constexpr size_t align4(size_t x)
+{
+    return (x + 3) & ~static_cast<size_t>(3);
+}
+
+constexpr size_t RecordSize(size_t payloadSize)
+{
+    return align4(sizeof(RecordHeader) + payloadSize) + sizeof(uint32_t);
+}
+
+// Buffers a record so that flash is written in word multiples, CRCing it on the way
+class RecordWriter
+{
+public:
+    RecordWriter(IJournalFlash& flash, int bank, size_t offset)
+        : m_flash(flash)
+        , m_bank(bank)
+        , m_offset(offset)
+    {
+    }
+
+    void Append(const void* data, size_t size)
+    {
+        m_crc = crc32inc(data, m_crc, size);
+
+        auto p = reinterpret_cast<const uint8_t*>(data);
+
+        while (size)
+        {
+            size_t n = sizeof(m_buffer) - m_fill;
+            if (n > size)
+            {
+                n = size;
+            }
+
+            memcpy(m_buffer + m_fill, p, n);
+            m_fill += n;
+            p += n;
+            size -= n;
+
+            if (m_fill == sizeof(m_buffer))
+            {
+                Flush();
+            }
+        }
+    }
+
+    // Pad to a word boundary, then append the CRC of everything so far
+    bool Finish()
+    {
+        const uint8_t erased = 0xFF;
+        while (m_fill % sizeof(uint32_t))
+        {
+            Append(&erased, 1);
+        }
+
+        uint32_t crc = m_crc;
+        Append(&crc, sizeof(crc));
+        Flush();
+
+        return m_ok;
+    }
+
+private:
+    void Flush()
+    {
+        if (m_fill)
+        {
+            m_ok &= m_flash.Write(m_bank, m_offset, m_buffer, m_fill);
+            m_offset += m_fill;
+            m_fill = 0;
+        }
+    }
+
+    IJournalFlash& m_flash;
+    const int m_bank;
+    size_t m_offset;
+
+    uint8_t m_buffer[32];
+    size_t m_fill = 0;
+    uint32_t m_crc = 0;
+    bool m_ok = true;
+};
+
+}
+
+ConfigJournal::ConfigJournal(IJournalFlash& flash, size_t imageSize)
+    : m_flash(flash)
+    , m_imageSize(imageSize)
+{
+}
+
+bool ConfigJournal::Mount()
+{
+    m_bank = -1;
+    m_sequence = 0;
+
+    // Newest bank with a valid header wins
+    for (int b = 0; b < m_flash.BankCount(); b++)
+    {
+        BankHeader h;
+        m_flash.Read(b, 0, reinterpret_cast<uint8_t*>(&h), sizeof(h));
+
+        if (h.Magic != JOURNAL_MAGIC || h.ImageSize != m_imageSize)
+        {
+            continue;
+        }
+
+        if (h.Crc != crc32(&h, offsetof(BankHeader, Crc)))
+        {
+            continue;
+        }
+
+        if (m_bank < 0 || h.Sequence > m_sequence)
+        {
+            m_bank = b;
+            m_sequence = h.Sequence;
+        }
+    }
+
+    if (m_bank < 0)
+    {
+        return false;
+    }
+
+    // Walk the records to find where the next one goes
+    size_t bankSize = m_flash.BankSize();
+    size_t pos = sizeof(BankHeader);
+
+    while (pos + sizeof(RecordHeader) <= bankSize)
+    {
+        RecordHeader r;
+        m_flash.Read(m_bank, pos, reinterpret_cast<uint8_t*>(&r), sizeof(r));
+
+        if (r.PayloadSize == 0xFFFF && r.PayloadSizeInv == 0xFFFF)
+        {
+            // Erased, end of the journal
+            break;
+        }
+
+        if ((r.PayloadSize ^ r.PayloadSizeInv) != 0xFFFF || pos + RecordSize(r.PayloadSize) > bankSize)
+        {
+            // Torn header, we can't tell where the next record starts.
+            // Treat the bank as full so the next save compacts.
+            pos = bankSize;
+            break;
+        }
+
+        pos += RecordSize(r.PayloadSize);
+    }
+
+    m_writePos = pos;
+
+    return true;
+}
+
+bool ConfigJournal::IsRecordValid(size_t offset, size_t payloadSize) const
+{
+    size_t size = align4(sizeof(RecordHeader) + payloadSize);
+
+    uint32_t crc = 0;
+    uint8_t buffer[32];
+
+    for (size_t done = 0; done < size; )
+    {
+        size_t n = size - done;
+        if (n > sizeof(buffer))
+        {
+            n = sizeof(buffer);
+        }
+
+        m_flash.Read(m_bank, offset + done, buffer, n);
+        crc = crc32inc(buffer, crc, n);
+        done += n;
+    }
+
+    uint32_t stored;
+    m_flash.Read(m_bank, offset + size, reinterpret_cast<uint8_t*>(&stored), sizeof(stored));
+
+    return crc == stored;
+}
+
+bool ConfigJournal::ReplayWindow(uint8_t* window, size_t start, size_t length) const
+{
+    bool any = false;
+    size_t pos = sizeof(BankHeader);
+
+    while (pos < m_writePos)
+    {
+        RecordHeader r;
+        m_flash.Read(m_bank, pos, reinterpret_cast<uint8_t*>(&r), sizeof(r));
+
+        if ((r.PayloadSize ^ r.PayloadSizeInv) != 0xFFFF)
+        {
+            break;
+        }
+
+        // Skip records that didn't make it to flash completely
+        if (IsRecordValid(pos, r.PayloadSize))
+        {
+            any = true;
+
+            size_t p = pos + sizeof(RecordHeader);
+            size_t end = p + r.PayloadSize;
+
+            while (p + sizeof(RunHeader) <= end)
+            {
+                RunHeader run;
+                m_flash.Read(m_bank, p, reinterpret_cast<uint8_t*>(&run), sizeof(run));
+                p += sizeof(RunHeader);
+
+                if (p + run.Length > end || run.Offset + run.Length > m_imageSize)
+                {
+                    break;
+                }
+
+                // Copy the part of the run that overlaps the window
+                size_t lo = run.Offset > start ? run.Offset : start;
+                size_t hi = run.Offset + run.Length;
+                if (hi > start + length)
+                {
+                    hi = start + length;
+                }
+
+                if (lo < hi)
+                {
+                    m_flash.Read(m_bank, p + (lo - run.Offset), window + (lo - start), hi - lo);
+                }
+
+                p += run.Length;
+            }
+        }
+
+        pos += RecordSize(r.PayloadSize);
+    }
+
+    return any;
+}
+
+bool ConfigJournal::Load(uint8_t* image) const
+{
+    if (m_bank < 0)
+    {
+        return false;
+    }
+
+    return ReplayWindow(image, 0, m_imageSize);
+}
+
+bool ConfigJournal::Save(const uint8_t* image)
+{
+    if (m_bank < 0)
+    {
+        return Compact(image);
+    }
+
+    RunHeader runs[MaxRuns];
+    int runCount = 0;
+    bool tooManyRuns = false;
+
+    // Compare against the stored image one window at a time, so no RAM copy of it is needed
+    for (size_t start = 0; start < m_imageSize && !tooManyRuns; start += WindowSize)
+    {
+        uint8_t window[WindowSize];
+        size_t length = m_imageSize - start;
+        if (length > WindowSize)
+        {
+            length = WindowSize;
+        }
+
+        if (!ReplayWindow(window, start, length))
+        {
+            // Nothing readable left in this bank
+            return Compact(image);
+        }
+
+        for (size_t i = 0; i < length; i++)
+        {
+            uint16_t offset = start + i;
+
+            if (window[i] == image[offset])
+            {
+                continue;
+            }
+
+            RunHeader* last = runCount > 0 ? &runs[runCount - 1] : nullptr;
+
+            // Offsets only grow, a run never ends past the next changed byte
+            size_t gap = last ? offset - (last->Offset + last->Length) : 0;
+
+            if (last && gap <= sizeof(RunHeader))
+            {
+                // Closer to the previous run than a run header costs, extend it over the gap
+                last->Length = offset + 1 - last->Offset;
+            }
+            else if (runCount < MaxRuns)
+            {
+                runs[runCount++] = { offset, 1 };
+            }
+            else
+            {
+                tooManyRuns = true;
+                break;
+            }
+        }
+    }
+
+    if (runCount == 0)
+    {
+        // Nothing changed, nothing to write
+        return true;
+    }
+
+    size_t payloadSize = 0;
+    for (int i = 0; i < runCount; i++)
+    {
+        payloadSize += sizeof(RunHeader) + runs[i].Length;
+    }
+
+    if (tooManyRuns || payloadSize > sizeof(RunHeader) + m_imageSize)
+    {
+        runs[0] = { 0, static_cast<uint16_t>(m_imageSize) };
+        runCount = 1;
+        payloadSize = sizeof(RunHeader) + m_imageSize;
+    }
+
+    if (m_writePos + RecordSize(payloadSize) > m_flash.BankSize())
+    {
+        return Compact(image);
+    }
+
+    RecordWriter writer(m_flash, m_bank, m_writePos);
+
+    RecordHeader r = { static_cast<uint16_t>(payloadSize), static_cast<uint16_t>(~payloadSize) };
+    writer.Append(&r, sizeof(r));
+
+    for (int i = 0; i < runCount; i++)
+    {
+        writer.Append(&runs[i], sizeof(RunHeader));
+        writer.Append(image + runs[i].Offset, runs[i].Length);
+    }
+
+    // Even if the write failed, that space may be partially programmed
+    m_writePos += RecordSize(payloadSize);
+
+    return writer.Finish();
+}
+
+bool ConfigJournal::Compact(const uint8_t* image)
+{
+    size_t payloadSize = sizeof(RunHeader) + m_imageSize;
+
+    if (sizeof(BankHeader) + RecordSize(payloadSize) > m_flash.BankSize())
+    {
+        return false;
+    }
+
+    // Use the next bank, the active one stays valid until the new header is written
+    int bank = (m_bank + 1) % m_flash.BankCount();
+
+    if (!m_flash.Erase(bank))
+    {
+        return false;
+    }
+
+    RecordWriter writer(m_flash, bank, sizeof(BankHeader));
+
+    RecordHeader r = { static_cast<uint16_t>(payloadSize), static_cast<uint16_t>(~payloadSize) };
+    RunHeader run = { 0, static_cast<uint16_t>(m_imageSize) };
+    writer.Append(&r, sizeof(r));
+    writer.Append(&run, sizeof(run));
+    writer.Append(image, m_imageSize);
+
+    if (!writer.Finish())
+    {
+        return false;
+    }
+
+    BankHeader h;
+    h.Magic = JOURNAL_MAGIC;
+    h.Sequence = m_sequence + 1;
+    h.ImageSize = m_imageSize;
+    h.Crc = crc32(&h, offsetof(BankHeader, Crc));
+
+    if (!m_flash.Write(bank, 0, reinterpret_cast<const uint8_t*>(&h), sizeof(h)))
+    {
+        return false;
+    }
+
+    m_bank = bank;
+    m_sequence = h.Sequence;
+    m_writePos = sizeof(BankHeader) + RecordSize(payloadSize);
+
+    return true;
+}
+
+bool ConfigJournal::IsMounted() const
+{
+    return m_bank >= 0;
+}
+
+uint32_t ConfigJournal::GetSequence() const
+{
+    return m_sequence;
+}
+
+size_t ConfigJournal::GetFreeSpace() const
+{
+    if (m_bank < 0)
+    {
+        return 0;
+    }
+
+    return m_flash.BankSize() - m_writePos;
+}
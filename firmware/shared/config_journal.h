@@ -0,0 +1,68 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+
+/**
+ * Flash area used by the journal, split in equally sized erase units ("banks").
+ * Implemented by each port on top of its flash driver, and by an emulator in the tests.
+ */
+struct IJournalFlash
+{
+    virtual int BankCount() const = 0;
+    virtual size_t BankSize() const = 0;
+
+    virtual void Read(int bank, size_t offset, uint8_t* buffer, size_t size) const = 0;
+    virtual bool Erase(int bank) = 0;
+    // offset and size are multiples of 4, the area has been erased before
+    virtual bool Write(int bank, size_t offset, const uint8_t* buffer, size_t size) = 0;
+};
+
+/**
+ * Append-only configuration journal
+ *
+ * Each bank starts with a header, followed by records. A record holds one
+ * save: a list of (offset, length, data) runs with the bytes that changed,
+ * protected by a CRC. The first record after a compaction is a full copy.
+ *
+ *   bank:   [ header ][ record ][ record ] ... [ erased ]
+ *   record: [ size ][ ~size ][ runs ... ][ pad ][ crc32 ]
+ *
+ * When the active bank is full, the current image is written to the next
+ * bank and only then is that bank's header written, so a power loss at any
+ * point leaves either the old or the new state readable. A record with a
+ * bad CRC (torn write) is skipped. With a single bank the journal still
+ * works, but compaction has to erase the only copy first.
+ */
+class ConfigJournal
+{
+public:
+    ConfigJournal(IJournalFlash& flash, size_t imageSize);
+
+    // Find the newest valid bank. Returns false if no journal is stored.
+    bool Mount();
+
+    // Replay the journal into image (imageSize bytes). Returns false if nothing is stored.
+    bool Load(uint8_t* image) const;
+
+    // Append the bytes that differ from the stored image, compacting if the bank is full
+    bool Save(const uint8_t* image);
+
+    bool IsMounted() const;
+    // Number of compactions so far, each one erased one bank
+    uint32_t GetSequence() const;
+    size_t GetFreeSpace() const;
+
+private:
+    bool Compact(const uint8_t* image);
+    bool ReplayWindow(uint8_t* window, size_t start, size_t length) const;
+    bool IsRecordValid(size_t offset, size_t payloadSize) const;
+
+    IJournalFlash& m_flash;
+    const size_t m_imageSize;
+
+    int m_bank = -1;
+    uint32_t m_sequence = 0;
+    // Where the next record goes in the active bank
+    size_t m_writePos = 0;
+};
@@ -0,0 +1,42 @@
+#include "telemetry.h"
+
+#include <cstring>
+
+#include <rusefi/crc.h>
+
+static void PutU16(uint8_t* p, uint16_t value)
+{
+    p[0] = value & 0xFF;
+    p[1] = value >> 8;
+}
+
+static void PutU32(uint8_t* p, uint32_t value)
+{
+    PutU16(p, value & 0xFFFF);
+    PutU16(p + 2, value >> 16);
+}
+
+size_t TelemetryPack(uint8_t* buffer, size_t size, TelemetryFrameType type, uint16_t sequence,
+                     uint32_t timeMs, const void* payload, size_t payloadSize)
+{
+    size_t length = payloadSize + TELEMETRY_OVERHEAD;
+
+    if (length > size || payloadSize > UINT16_MAX)
+    {
+        return 0;
+    }
+
+    buffer[0] = 'W';
+    buffer[1] = 'T';
+    buffer[2] = TELEMETRY_VERSION;
+    buffer[3] = static_cast<uint8_t>(type);
+    PutU16(buffer + 4, payloadSize);
+    PutU16(buffer + 6, sequence);
+    PutU32(buffer + 8, timeMs);
+
+    memcpy(buffer + 12, payload, payloadSize);
+
+    PutU32(buffer + 12 + payloadSize, crc32(buffer, 12 + payloadSize));
+
+    return length;
+}
@@ -0,0 +1,71 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+
+/**
+ * Binary telemetry on the debug serial port, decoded by tools/telemetry_decode.py
+ *
+ *   u8   'W' 'T'
+ *   u8   TELEMETRY_VERSION
+ *   u8   TelemetryFrameType
+ *   u16  payload length
+ *   u16  sequence, one per frame, gaps are lost frames
+ *   u32  ms since boot
+ *        payload
+ *   u32  CRC32 of everything above
+ *
+ * Multi-byte fields are little endian.
+ */
+
+#define TELEMETRY_VERSION 1
+// Header and CRC around the payload
+#define TELEMETRY_OVERHEAD 16
+// Largest payload we send: two AFR and two EGT channels
+#define TELEMETRY_MAX_PAYLOAD 64
+
+enum class TelemetryFrameType : uint8_t
+{
+    // u8 AFR channel count, u8 EGT channel count, then a TelemetryAfrRecord
+    // per AFR channel and a TelemetryEgtRecord per EGT channel
+    Status = 1,
+    // u16 ms per BootStage, 0xFFFF if not reached (yet)
+    BootTimeline = 2,
+};
+
+struct TelemetryAfrRecord
+{
+    // 0.001
+    uint16_t Lambda;
+    // mV
+    int16_t NernstDc;
+    int16_t NernstAc;
+    // ohm
+    uint16_t Esr;
+    // deg C
+    int16_t Temperature;
+    // uA
+    int32_t PumpCurrent;
+    // mV
+    uint16_t HeaterVoltage;
+    // %
+    uint8_t PumpDuty;
+    uint8_t HeaterDuty;
+    uint8_t HeaterState;
+    uint8_t Fault;
+} __attribute__((packed));
+
+static_assert(sizeof(TelemetryAfrRecord) == 20, "TelemetryAfrRecord size incorrect");
+
+struct TelemetryEgtRecord
+{
+    // deg C
+    int16_t Temperature;
+    int16_t ColdJunction;
+} __attribute__((packed));
+
+static_assert(sizeof(TelemetryEgtRecord) == 4, "TelemetryEgtRecord size incorrect");
+
+// Frame payload into buffer, returns the frame length or 0 if it doesn't fit
+size_t TelemetryPack(uint8_t* buffer, size_t size, TelemetryFrameType type, uint16_t sequence,
+                     uint32_t timeMs, const void* payload, size_t payloadSize);
@@ -0,0 +1,279 @@
+#include "thread_monitor.h"
+
+#include "ch.h"
+#include "hal.h"
+
+#include <cstring>
+
+#include <rusefi/arrays.h>
+
+// Registry names, in ThreadId order
+static const char* const threadNames[] = {
+    "Sampling",
+    "Heater",
+    "Pump",
+    "CAN Tx",
+    "CAN Rx",
+    "Aux out",
+    "UART debug",
+    "Primary TS Channel",
+    "Secondary TS Channel",
+    "CAN TS Channel",
+    "egt",
+    // Both indication threads share this, the first one found is reported
+    "Indication",
+    "Config save",
+    "main",
+    "idle",
+};
+
+static_assert(efi::size(threadNames) == THREAD_STATS_COUNT, "threadNames doesn't match ThreadId");
+
+// Without the registry or the realtime counter (F0) there is nothing to
+// fill these with, don't spend the RAM on them
+#define THREAD_MONITOR_STATS (CH_CFG_USE_REGISTRY || PORT_SUPPORTS_RT)
+
+#if THREAD_MONITOR_STATS
+static livedata_threads_s stats;
+#endif
+
+#if PORT_SUPPORTS_RT
+static LoopStats loops[THREAD_STATS_COUNT];
+
+static DeadlineMonitor deadlines[DEADLINE_LOOPS];
+static livedata_deadline_s deadlineStats;
+#endif
+
+// Set from the loops, collected by the update
+static volatile bool deadlineMissed = false;
+static bool deadlineMissedLast = false;
+
+#if CH_DBG_STATISTICS
+// Run time of each slot and of all threads together at the last update
+static rttime_t lastBusy[THREAD_STATS_COUNT];
+static rttime_t lastTotal;
+static bool lastSeen[THREAD_STATS_COUNT];
+#endif
+
+#if CH_DBG_FILL_THREADS && CH_DBG_ENABLE_STACK_CHECK
+extern stkalign_t __main_thread_stack_end__;
+#endif
+
+#if THREAD_MONITOR_STATS
+static uint16_t clampU16(uint32_t value)
+{
+    return value > UINT16_MAX ? UINT16_MAX : value;
+}
+#endif
+
+#if PORT_SUPPORTS_RT
+static int DeadlineIndex(ThreadId id)
+{
+    for (int i = 0; i < DEADLINE_LOOPS; i++)
+    {
+        if (deadlineLoops[i] == id)
+        {
+            return i;
+        }
+    }
+
+    return -1;
+}
+#endif
+
+void ThreadLoopBegin(ThreadId id)
+{
+#if PORT_SUPPORTS_RT
+    rtcnt_t now = chSysGetRealtimeCounterX();
+
+    loops[static_cast<int>(id)].Begin(now);
+
+    int d = DeadlineIndex(id);
+    if (d >= 0 && deadlines[d].Tick(now))
+    {
+        deadlineMissed = true;
+    }
+#else
+    (void)id;
+#endif
+}
+
+void ThreadLoopEnd(ThreadId id)
+{
+#if PORT_SUPPORTS_RT
+    loops[static_cast<int>(id)].End(chSysGetRealtimeCounterX());
+#else
+    (void)id;
+#endif
+}
+
+void ThreadDeadlineInit(ThreadId id, uint32_t periodMs)
+{
+#if PORT_SUPPORTS_RT
+    int d = DeadlineIndex(id);
+
+    if (d >= 0)
+    {
+        // Counter ticks, fits 32 bits up to ~59s at 72MHz
+        deadlines[d].SetPeriod(periodMs * (STM32_HCLK / 1000));
+    }
+#else
+    (void)id;
+    (void)periodMs;
+#endif
+}
+
+#if CH_CFG_USE_REGISTRY
+static int FindSlot(const char* name)
+{
+    if (!name)
+    {
+        return -1;
+    }
+
+    for (int i = 0; i < THREAD_STATS_COUNT; i++)
+    {
+        if (strcmp(name, threadNames[i]) == 0)
+        {
+            return i;
+        }
+    }
+
+    return -1;
+}
+
+static uint16_t StackFree(const thread_t* tp)
+{
+#if CH_DBG_FILL_THREADS && CH_DBG_ENABLE_STACK_CHECK
+    auto base = reinterpret_cast<const uint8_t*>(tp->wabase);
+    // Static threads keep their thread_t at the top of the working area,
+    // the main thread's lives in the kernel and it runs on the linker's stack
+    auto top = reinterpret_cast<const uint8_t*>(tp);
+
+    if (!base)
+    {
+        return THREAD_STACK_UNKNOWN;
+    }
+
+    if (top < base)
+    {
+        top = reinterpret_cast<const uint8_t*>(&__main_thread_stack_end__);
+    }
+
+    return clampU16(StackUnusedBytes(base, top - base, CH_DBG_STACK_FILL_VALUE));
+#else
+    (void)tp;
+    return THREAD_STACK_UNKNOWN;
+#endif
+}
+#endif // CH_CFG_USE_REGISTRY
+
+void ThreadStatsUpdate()
+{
+#if THREAD_MONITOR_STATS
+    bool seen[THREAD_STATS_COUNT] = {};
+
+#if CH_DBG_STATISTICS
+    rttime_t busy[THREAD_STATS_COUNT] = {};
+    rttime_t total = 0;
+#endif
+
+#if CH_CFG_USE_REGISTRY
+    for (thread_t* tp = chRegFirstThread(); tp; tp = chRegNextThread(tp))
+    {
+#if CH_DBG_STATISTICS
+        // Updated on context switches, don't read it half way through one
+        chSysLock();
+        rttime_t cumulative = tp->stats.cumulative;
+        chSysUnlock();
+
+        total += cumulative;
+#endif
+
+        int slot = FindSlot(chRegGetThreadNameX(tp));
+
+        if (slot < 0 || seen[slot])
+        {
+            continue;
+        }
+
+        seen[slot] = true;
+        stats.stackFree[slot] = StackFree(tp);
+
+#if CH_DBG_STATISTICS
+        busy[slot] = cumulative;
+#endif
+    }
+#endif // CH_CFG_USE_REGISTRY
+
+    for (int i = 0; i < THREAD_STATS_COUNT; i++)
+    {
+        if (!seen[i])
+        {
+            stats.stackFree[i] = THREAD_STACK_UNKNOWN;
+        }
+
+#if CH_DBG_STATISTICS
+        // Needs two sightings of the thread to have an interval
+        stats.cpuLoad[i] = (seen[i] && lastSeen[i]) ? LoadHalfPercent(busy[i] - lastBusy[i], total - lastTotal) : THREAD_LOAD_UNKNOWN;
+
+        lastBusy[i] = busy[i];
+        lastSeen[i] = seen[i];
+#else
+        stats.cpuLoad[i] = THREAD_LOAD_UNKNOWN;
+#endif
+
+#if PORT_SUPPORTS_RT
+        stats.loopMaxUs[i] = clampU16(loops[i].GetMax() / (STM32_HCLK / 1000000));
+#endif
+    }
+
+#if CH_DBG_STATISTICS
+    lastTotal = total;
+#endif
+
+#if PORT_SUPPORTS_RT
+    for (int i = 0; i < DEADLINE_LOOPS; i++)
+    {
+        const auto& d = deadlines[i];
+        auto& out = deadlineStats.loop[i];
+
+        out.misses = d.GetMisses();
+        out.worstLateUs = clampU16(d.GetWorstLate() / (STM32_HCLK / 1000000));
+
+        for (int b = 0; b < DEADLINE_HISTOGRAM_BUCKETS; b++)
+        {
+            out.histogram[b] = d.GetHistogram()[b];
+        }
+    }
+#endif
+#endif // THREAD_MONITOR_STATS
+
+    chSysLock();
+    deadlineMissedLast = deadlineMissed;
+    deadlineMissed = false;
+    chSysUnlock();
+}
+
+const livedata_threads_s* GetThreadStats()
+{
+#if THREAD_MONITOR_STATS
+    return &stats;
+#else
+    return nullptr;
+#endif
+}
+
+const livedata_deadline_s* GetDeadlineStats()
+{
+#if PORT_SUPPORTS_RT
+    return &deadlineStats;
+#else
+    return nullptr;
+#endif
+}
+
+bool ThreadDeadlineMissed()
+{
+    return deadlineMissedLast;
+}
@@ -0,0 +1,23 @@
+#pragma once
+
+#include "thread_stats.h"
+
+// Time one pass through the calling thread's loop. Needs the realtime
+// counter, does nothing on ports without one.
+void ThreadLoopBegin(ThreadId id);
+void ThreadLoopEnd(ThreadId id);
+
+// Watch the loop of one of deadlineLoops, checked on each ThreadLoopBegin()
+void ThreadDeadlineInit(ThreadId id, uint32_t periodMs);
+
+// Walk the registry and refresh stack, CPU load and deadline figures.
+// Loads are over the time since the previous call, so call it from one
+// place at a steady rate.
+void ThreadStatsUpdate();
+
+// nullptr where the kernel keeps nothing to fill them with
+const livedata_threads_s* GetThreadStats();
+const livedata_deadline_s* GetDeadlineStats();
+
+// A monitored loop missed its deadline between the last two updates
+bool ThreadDeadlineMissed();
@@ -0,0 +1,111 @@
+#include "thread_stats.h"
+
+static_assert(sizeof(livedata_threads_s) == 96, "livedata_threads_s size incorrect");
+static_assert(sizeof(livedata_deadline_s) == 128, "livedata_deadline_s size incorrect");
+
+const ThreadId deadlineLoops[DEADLINE_LOOPS] = {
+    ThreadId::Heater,
+    ThreadId::Pump,
+    ThreadId::CanTx,
+    ThreadId::AuxOut,
+    ThreadId::Egt,
+};
+
+void LoopStats::End(uint32_t now)
+{
+    // End without a Begin, nothing to measure
+    if (!m_running)
+    {
+        return;
+    }
+
+    m_running = false;
+    m_last = now - m_start;
+
+    if (m_last > m_max)
+    {
+        m_max = m_last;
+    }
+}
+
+bool DeadlineMonitor::Tick(uint32_t now)
+{
+    if (!m_period)
+    {
+        return false;
+    }
+
+    // First pass, nothing to compare to
+    if (!m_started)
+    {
+        m_started = true;
+        m_last = now;
+        return false;
+    }
+
+    uint32_t actual = now - m_last;
+    m_last = now;
+
+    // Early passes (a windowed sleep catching up) count as on time
+    uint32_t late = actual > m_period ? actual - m_period : 0;
+
+    if (late > m_worstLate)
+    {
+        m_worstLate = late;
+    }
+
+    uint64_t bucket = (uint64_t)late * DEADLINE_HISTOGRAM_BUCKETS / m_period;
+
+    if (bucket >= DEADLINE_HISTOGRAM_BUCKETS)
+    {
+        bucket = DEADLINE_HISTOGRAM_BUCKETS - 1;
+    }
+
+    // Keep the shape rather than saturate
+    if (m_histogram[bucket] == UINT16_MAX)
+    {
+        for (auto& b : m_histogram)
+        {
+            b /= 2;
+        }
+    }
+
+    m_histogram[bucket]++;
+
+    bool miss = (uint64_t)late * 100 >= (uint64_t)m_period * DEADLINE_MISS_PERCENT;
+
+    if (miss && m_misses < UINT16_MAX)
+    {
+        m_misses++;
+    }
+
+    return miss;
+}
+
+size_t StackUnusedBytes(const uint8_t* base, size_t size, uint8_t fill)
+{
+    // Stacks grow down, the fill survives at the bottom
+    size_t unused = 0;
+
+    while (unused < size && base[unused] == fill)
+    {
+        unused++;
+    }
+
+    return unused;
+}
+
+uint8_t LoadHalfPercent(uint64_t busy, uint64_t total)
+{
+    if (total == 0)
+    {
+        return 0;
+    }
+
+    if (busy >= total)
+    {
+        return 200;
+    }
+
+    return (busy * 200 + total / 2) / total;
+}
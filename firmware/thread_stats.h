@@ -0,0 +1,152 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+
+#include "wideband_config.h"
+
+// Threads reported in the thread stats, found in the registry by name
+enum class ThreadId : uint8_t
+{
+    Sampling,
+    Heater,
+    Pump,
+    CanTx,
+    CanRx,
+    AuxOut,
+    UartDebug,
+    TsPrimary,
+    TsSecondary,
+    TsCan,
+    Egt,
+    Indication,
+    ConfigSave,
+    Main,
+    Idle,
+
+    Count
+};
+
+#define THREAD_STATS_COUNT (static_cast<int>(ThreadId::Count))
+
+// Slot has no thread (not in this build, not started yet) or the kernel
+// doesn't keep what we need for it
+#define THREAD_STACK_UNKNOWN 0xFFFF
+#define THREAD_LOAD_UNKNOWN 0xFF
+
+/* +160 offset */
+struct livedata_threads_s {
+    union {
+        struct {
+            // Stack bytes never touched since the thread started
+            uint16_t stackFree[THREAD_STATS_COUNT];
+            // Longest pass through the thread's loop, us, 0 if not timed
+            uint16_t loopMaxUs[THREAD_STATS_COUNT];
+            // Share of CPU time since the last update, 0.5 %
+            uint8_t cpuLoad[THREAD_STATS_COUNT];
+        } __attribute__((packed));
+        uint8_t pad[96];
+    };
+};
+
+// Periodic loops with a deadline monitor, in livedata_deadline_s order
+#define DEADLINE_LOOPS 5
+extern const ThreadId deadlineLoops[DEADLINE_LOOPS];
+
+/* +256 offset */
+struct livedata_deadline_s {
+    union {
+        struct {
+            struct {
+                // Passes started DEADLINE_MISS_PERCENT or more late, saturating
+                uint16_t misses;
+                // Latest start seen, us after the period
+                uint16_t worstLateUs;
+                // Passes by lateness, bucket i is i/DEADLINE_HISTOGRAM_BUCKETS
+                // of the period late, the last one open ended. Relative, all
+                // buckets are halved when one fills up.
+                uint16_t histogram[DEADLINE_HISTOGRAM_BUCKETS];
+            } __attribute__((packed)) loop[DEADLINE_LOOPS];
+        } __attribute__((packed));
+        uint8_t pad[128];
+    };
+};
+
+/**
+ * Execution time of one pass through a loop, in whatever units
+ * the timestamps come in. Wraps like the counter it is fed from.
+ */
+class LoopStats
+{
+public:
+    void Begin(uint32_t now)
+    {
+        m_start = now;
+        m_running = true;
+    }
+
+    void End(uint32_t now);
+
+    uint32_t GetLast() const
+    {
+        return m_last;
+    }
+
+    uint32_t GetMax() const
+    {
+        return m_max;
+    }
+
+private:
+    uint32_t m_start = 0;
+    uint32_t m_last = 0;
+    uint32_t m_max = 0;
+    bool m_running = false;
+};
+
+/**
+ * Watches the time between passes of a periodic loop against its period,
+ * in whatever units the timestamps come in.
+ */
+class DeadlineMonitor
+{
+public:
+    // 0 turns the monitor off
+    void SetPeriod(uint32_t period)
+    {
+        m_period = period;
+        m_started = false;
+    }
+
+    // Call at the start of each pass, true if it started late enough to be a miss
+    bool Tick(uint32_t now);
+
+    uint16_t GetMisses() const
+    {
+        return m_misses;
+    }
+
+    uint32_t GetWorstLate() const
+    {
+        return m_worstLate;
+    }
+
+    const uint16_t* GetHistogram() const
+    {
+        return m_histogram;
+    }
+
+private:
+    uint32_t m_period = 0;
+    uint32_t m_last = 0;
+    uint32_t m_worstLate = 0;
+    uint16_t m_misses = 0;
+    uint16_t m_histogram[DEADLINE_HISTOGRAM_BUCKETS] = {};
+    bool m_started = false;
+};
+
+// Bytes from the bottom of a stack still holding the fill pattern
+size_t StackUnusedBytes(const uint8_t* base, size_t size, uint8_t fill);
+
+// busy out of total, in 0.5 %, saturating at 100 %
+uint8_t LoadHalfPercent(uint64_t busy, uint64_t total);
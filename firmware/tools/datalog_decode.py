@@ -0,0 +1,134 @@
+#!/usr/bin/env python3
+"""
+Decode the binary data log (see firmware/data_log.h) to CSV.
+
+    datalog_decode.py capture.bin > log.csv
+    datalog_decode.py /dev/ttyUSB0 > log.csv    (reads until interrupted)
+
+Blocks with a bad CRC are skipped, the decoder resyncs on the next 'WL'.
+"""
+
+import struct
+import sys
+import zlib
+
+VERSION = 1
+HEADER = struct.Struct("<2sBBBBHI")
+
+# type: (name, scale)
+COLUMNS = {
+    1: ("lambda", 0.001),
+    2: ("temp", 1),
+    3: ("fault", 1),
+    4: ("heater", 1),
+    5: ("egt", 1),
+}
+
+
+def varint(data, pos):
+    value = 0
+    shift = 0
+    while True:
+        b = data[pos]
+        pos += 1
+        value |= (b & 0x7F) << shift
+        shift += 7
+        if not b & 0x80:
+            return value, pos
+
+
+def signed(data, pos):
+    v, pos = varint(data, pos)
+    return (v >> 1) ^ -(v & 1), pos
+
+
+def decode_block(data, pos):
+    """Returns (header, types, records, next pos), raises IndexError/ValueError on bad data"""
+    magic, version, ncols, nrecs, _, interval, first = HEADER.unpack_from(data, pos)
+    if magic != b"WL" or version != VERSION:
+        raise ValueError("not a block")
+
+    p = pos + HEADER.size
+    types = list(data[p:p + ncols])
+    p += ncols
+
+    records = [[0] * ncols for _ in range(nrecs)]
+    for c in range(ncols):
+        records[0][c], p = signed(data, p)
+        r = 1
+        while r < nrecs:
+            delta, p = signed(data, p)
+            records[r][c] = records[r - 1][c] + delta
+            r += 1
+            if delta == 0:
+                run, p = varint(data, p)
+                for _ in range(run):
+                    records[r][c] = records[r - 1][c]
+                    r += 1
+
+    (crc,) = struct.unpack_from("<I", data, p)
+    if zlib.crc32(data[pos:p]) != crc:
+        raise ValueError("bad crc")
+
+    return (interval, first), types, records, p + 4
+
+
+def column_name(t):
+    name, _ = COLUMNS.get(t & 0x0F, ("col%d" % (t & 0x0F), 1))
+    return "%s%d" % (name, t >> 4)
+
+
+def column_value(t, v):
+    _, scale = COLUMNS.get(t & 0x0F, (None, 1))
+    return "%g" % (v * scale) if scale != 1 else str(v)
+
+
+def main():
+    if len(sys.argv) != 2:
+        print(__doc__, file=sys.stderr)
+        sys.exit(1)
+
+    out = sys.stdout
+    last_types = None
+    buf = bytearray()
+
+    with open(sys.argv[1], "rb", buffering=0) as f:
+        while True:
+            chunk = f.read(4096)
+            if chunk:
+                buf += chunk
+
+            pos = 0
+            while True:
+                pos = buf.find(b"WL", pos)
+                if pos < 0:
+                    # keep a trailing 'W' for the next read
+                    pos = max(len(buf) - 1, 0)
+                    break
+                try:
+                    (interval, first), types, records, end = decode_block(buf, pos)
+                except (IndexError, struct.error):
+                    # incomplete, wait for more data
+                    break
+                except ValueError:
+                    pos += 1
+                    continue
+
+                if types != last_types:
+                    out.write(",".join(["time"] + [column_name(t) for t in types]) + "\n")
+                    last_types = types
+
+                for i, rec in enumerate(records):
+                    t = (first + i) * interval / 1000.0
+                    out.write(",".join(["%.3f" % t] + [column_value(ty, v) for ty, v in zip(types, rec)]) + "\n")
+
+                pos = end
+
+            del buf[:pos]
+
+            if not chunk:
+                break
+
+
+if __name__ == "__main__":
+    main()
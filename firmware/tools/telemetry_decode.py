@@ -0,0 +1,121 @@
+#!/usr/bin/env python3
+"""
+Decode binary telemetry from the debug serial port (see firmware/telemetry.h).
+
+    telemetry_decode.py capture.bin > status.csv
+    telemetry_decode.py /dev/ttyUSB0 > status.csv    (reads until interrupted)
+
+Status frames become CSV rows on stdout, boot timelines and lost frames are
+reported on stderr. Frames with a bad CRC are skipped.
+"""
+
+import struct
+import sys
+import zlib
+
+VERSION = 1
+HEADER = struct.Struct("<2sBBHHI")
+AFR = struct.Struct("<HhhHhiHBBBB")
+EGT = struct.Struct("<hh")
+
+FRAME_STATUS = 1
+FRAME_BOOT_TIMELINE = 2
+
+# BootStage order
+BOOT_STAGES = [
+    "Config", "Sampling", "CAN", "PumpDac", "HeaterCtrl", "PumpCtrl", "AuxDac", "TS",
+    "UART", "Indication", "EGT", "SamplingStable", "HeaterStart", "FirstCanTx", "ClosedLoop",
+]
+
+AFR_FIELDS = ["lambda", "nernst_dc_mv", "nernst_ac_mv", "esr", "temp", "ipump_ua",
+              "heater_mv", "pump_duty", "heater_duty", "heater_state", "fault"]
+EGT_FIELDS = ["egt", "egt_cj"]
+
+
+def frames(f):
+    """Yields (type, sequence, ms, payload) for each good frame"""
+    buf = bytearray()
+    while True:
+        chunk = f.read(4096)
+        if chunk:
+            buf += chunk
+
+        pos = 0
+        while True:
+            pos = buf.find(b"WT", pos)
+            if pos < 0:
+                pos = max(len(buf) - 1, 0)
+                break
+            if len(buf) < pos + HEADER.size:
+                break
+
+            _, version, ftype, length, seq, ms = HEADER.unpack_from(buf, pos)
+            end = pos + HEADER.size + length
+            if version != VERSION:
+                pos += 1
+                continue
+            if len(buf) < end + 4:
+                break
+
+            (crc,) = struct.unpack_from("<I", buf, end)
+            if zlib.crc32(buf[pos:end]) != crc:
+                pos += 1
+                continue
+
+            yield ftype, seq, ms, bytes(buf[pos + HEADER.size:end])
+            pos = end + 4
+
+        del buf[:pos]
+
+        if not chunk:
+            return
+
+
+def status_row(payload):
+    afr_count, egt_count = payload[0], payload[1]
+    values = []
+    p = 2
+    for _ in range(afr_count):
+        rec = list(AFR.unpack_from(payload, p))
+        rec[0] = "%.3f" % (rec[0] / 1000.0)
+        values += rec
+        p += AFR.size
+    for _ in range(egt_count):
+        values += EGT.unpack_from(payload, p)
+        p += EGT.size
+    return afr_count, egt_count, values
+
+
+def main():
+    if len(sys.argv) != 2:
+        print(__doc__, file=sys.stderr)
+        sys.exit(1)
+
+    layout = None
+    last_seq = None
+
+    with open(sys.argv[1], "rb", buffering=0) as f:
+        for ftype, seq, ms, payload in frames(f):
+            if last_seq is not None and seq != (last_seq + 1) & 0xFFFF:
+                print("lost %d frame(s)" % ((seq - last_seq - 1) & 0xFFFF), file=sys.stderr)
+            last_seq = seq
+
+            if ftype == FRAME_BOOT_TIMELINE:
+                stages = struct.unpack("<%dH" % (len(payload) // 2), payload)
+                reached = ["%s %d" % (BOOT_STAGES[i] if i < len(BOOT_STAGES) else i, v)
+                           for i, v in enumerate(stages) if v != 0xFFFF]
+                print("Boot: %s ms" % " ".join(reached), file=sys.stderr)
+            elif ftype == FRAME_STATUS:
+                afr_count, egt_count, values = status_row(payload)
+                if layout != (afr_count, egt_count):
+                    layout = (afr_count, egt_count)
+                    names = ["time"]
+                    names += ["%s%d" % (n, ch) for ch in range(afr_count) for n in AFR_FIELDS]
+                    names += ["%s%d" % (n, ch) for ch in range(egt_count) for n in EGT_FIELDS]
+                    print(",".join(names))
+                print(",".join(["%.3f" % (ms / 1000.0)] + [str(v) for v in values]))
+                sys.stdout.flush()
+
+
+if __name__ == "__main__":
+    main()
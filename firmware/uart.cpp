@@ -9,6 +9,9 @@
 #include "fault.h"
 #include "uart.h"
 #include "pump_dac.h"
+#include "boot_timeline.h"
+#include "data_log.h"
+#include "telemetry.h"
 
 #include "tunerstudio.h"
 #include "tunerstudio_io.h"
@@ -29,17 +32,174 @@ SerialConfig cfg = {
 
 BaseSequentialStream *chp = (BaseSequentialStream *) &SD1;
 
-static THD_WORKING_AREA(waUartThread, 512);
-static void UartThread(void*)
+#if DEBUG_SERIAL_MODE == DEBUG_SERIAL_DATALOG
+struct SerialDataLogSink : public IDataLogSink
 {
-    chRegSetThreadName("UART debug");
+    void Write(const uint8_t* buffer, size_t size) override
+    {
+        chnWrite(&SD1, buffer, size);
+    }
+};
 
-    sdStart(&SD1, &cfg);
+static int16_t clampS16(float value)
+{
+    return value > INT16_MAX ? INT16_MAX : (value < INT16_MIN ? INT16_MIN : (int16_t)value);
+}
+
+static uint8_t column(DataLogColumn type, int ch)
+{
+    return static_cast<uint8_t>(type) | (ch << DATALOG_COLUMN_CHANNEL_SHIFT);
+}
+
+// Never returns
+static void UartDataLog()
+{
+    uint8_t types[DATALOG_MAX_COLUMNS];
+    size_t count = 0;
+
+    for (int ch = 0; ch < AFR_CHANNELS; ch++) {
+        types[count++] = column(DataLogColumn::Lambda, ch);
+        types[count++] = column(DataLogColumn::SensorTemp, ch);
+        types[count++] = column(DataLogColumn::Fault, ch);
+        types[count++] = column(DataLogColumn::HeaterState, ch);
+    }
+    for (int ch = 0; ch < EGT_CHANNELS; ch++) {
+        types[count++] = column(DataLogColumn::EgtTemp, ch);
+    }
+
+    // Too big for this thread's stack
+    static DataLogEncoder encoder(types, count, DATALOG_INTERVAL_MS);
+    SerialDataLogSink sink;
+
+    systime_t prev = chVTGetSystemTime();
+
+    while (true)
+    {
+        int16_t values[DATALOG_MAX_COLUMNS];
+        size_t i = 0;
+
+        for (int ch = 0; ch < AFR_CHANNELS; ch++) {
+            values[i++] = clampS16(GetLambda(ch) * 1000);
+            values[i++] = clampS16(GetSampler(ch).GetSensorTemperature());
+            values[i++] = static_cast<int16_t>(GetCurrentFault(ch));
+            values[i++] = static_cast<int16_t>(GetHeaterState(ch));
+        }
+        for (int ch = 0; ch < EGT_CHANNELS; ch++) {
+            values[i++] = clampS16(getEgtDrivers()[ch].temperature);
+        }
+
+        if (encoder.Add(values))
+        {
+            encoder.Flush(sink);
+        }
+
+        prev = chThdSleepUntilWindowed(prev, chTimeAddX(prev, TIME_MS2I(DATALOG_INTERVAL_MS)));
+    }
+}
+#endif /* DEBUG_SERIAL_MODE == DEBUG_SERIAL_DATALOG */
+
+#if DEBUG_SERIAL_MODE == DEBUG_SERIAL_TELEMETRY
+static void SendTelemetry(TelemetryFrameType type, const void* payload, size_t size)
+{
+    static uint16_t sequence = 0;
+    uint8_t frame[TELEMETRY_MAX_PAYLOAD + TELEMETRY_OVERHEAD];
+
+    size_t length = TelemetryPack(frame, sizeof(frame), type, sequence++,
+                                  TIME_I2MS(chVTGetSystemTime()), payload, size);
+    chnWrite(&SD1, frame, length);
+}
+
+static uint8_t percent(float duty)
+{
+    return duty < 0 ? 0 : (duty > 1 ? 100 : (uint8_t)(duty * 100));
+}
+
+// Never returns
+static void UartTelemetry()
+{
+    int bootStagesReported = 0;
+    systime_t prev = chVTGetSystemTime();
+
+    while (true)
+    {
+        if (BootTimelineCount() != bootStagesReported)
+        {
+            bootStagesReported = BootTimelineCount();
+
+            uint16_t stages[static_cast<int>(BootStage::Count)];
+            for (int i = 0; i < static_cast<int>(BootStage::Count); i++)
+            {
+                stages[i] = BootTimelineGetMs(static_cast<BootStage>(i));
+            }
+
+            SendTelemetry(TelemetryFrameType::BootTimeline, stages, sizeof(stages));
+        }
+
+        uint8_t payload[2 + AFR_CHANNELS * sizeof(TelemetryAfrRecord) + EGT_CHANNELS * sizeof(TelemetryEgtRecord)];
+        static_assert(sizeof(payload) <= TELEMETRY_MAX_PAYLOAD, "TELEMETRY_MAX_PAYLOAD too small");
+        payload[0] = AFR_CHANNELS;
+        payload[1] = EGT_CHANNELS;
+
+        // Packed records, any alignment will do
+        auto afr = reinterpret_cast<TelemetryAfrRecord*>(payload + 2);
+        for (int ch = 0; ch < AFR_CHANNELS; ch++) {
+            const auto& sampler = GetSampler(ch);
+
+            afr[ch].Lambda = GetLambda(ch) * 1000;
+            afr[ch].NernstDc = sampler.GetNernstDc() * 1000;
+            afr[ch].NernstAc = sampler.GetNernstAc() * 1000;
+            afr[ch].Esr = sampler.GetSensorInternalResistance();
+            afr[ch].Temperature = sampler.GetSensorTemperature();
+            afr[ch].PumpCurrent = sampler.GetPumpNominalCurrent() * 1000;
+            afr[ch].HeaterVoltage = sampler.GetInternalHeaterVoltage() * 1000;
+            afr[ch].PumpDuty = percent(GetPumpOutputDuty(ch));
+            afr[ch].HeaterDuty = percent(GetHeaterDuty(ch));
+            afr[ch].HeaterState = static_cast<uint8_t>(GetHeaterState(ch));
+            afr[ch].Fault = static_cast<uint8_t>(GetCurrentFault(ch));
+        }
+
+        auto egt = reinterpret_cast<TelemetryEgtRecord*>(afr + AFR_CHANNELS);
+        for (int ch = 0; ch < EGT_CHANNELS; ch++) {
+            egt[ch].Temperature = getEgtDrivers()[ch].temperature;
+            egt[ch].ColdJunction = getEgtDrivers()[ch].coldJunctionTemperature;
+        }
+
+        SendTelemetry(TelemetryFrameType::Status, payload, sizeof(payload));
+
+        prev = chThdSleepUntilWindowed(prev, chTimeAddX(prev, TIME_MS2I(1000 / DEBUG_SERIAL_TELEMETRY_HZ)));
+    }
+}
+#endif /* DEBUG_SERIAL_MODE == DEBUG_SERIAL_TELEMETRY */
+
+#if DEBUG_SERIAL_MODE == DEBUG_SERIAL_TEXT
+// Human readable, never returns
+static void UartText()
+{
+    int bootStagesReported = 0;
 
     while(true)
     {
         int ch;
 
+        // Dump the boot timeline whenever a new stage has been reached
+        if (BootTimelineCount() != bootStagesReported)
+        {
+            bootStagesReported = BootTimelineCount();
+
+            chprintf(chp, "Boot:");
+            for (int i = 0; i < static_cast<int>(BootStage::Count); i++)
+            {
+                auto stage = static_cast<BootStage>(i);
+                uint16_t ms = BootTimelineGetMs(stage);
+
+                if (ms != BOOT_STAGE_PENDING)
+                {
+                    chprintf(chp, " %s %d", describeBootStage(stage), ms);
+                }
+            }
+            chprintf(chp, " ms\r\n");
+        }
+
         #ifdef BOARD_HAS_VOLTAGE_SENSE
         {
             float vbatt = GetSupplyVoltage();
@@ -89,6 +249,25 @@ static void UartThread(void*)
         chThdSleepMilliseconds(100);
     }
 }
+#endif /* DEBUG_SERIAL_MODE == DEBUG_SERIAL_TEXT */
+
+static THD_WORKING_AREA(waUartThread, 512);
+static void UartThread(void*)
+{
+    chRegSetThreadName("UART debug");
+
+    sdStart(&SD1, &cfg);
+
+#if DEBUG_SERIAL_MODE == DEBUG_SERIAL_TELEMETRY
+    UartTelemetry();
+#elif DEBUG_SERIAL_MODE == DEBUG_SERIAL_DATALOG
+    UartDataLog();
+#elif DEBUG_SERIAL_MODE == DEBUG_SERIAL_TEXT
+    UartText();
+#else
+    #error "Unknown DEBUG_SERIAL_MODE"
+#endif
+}
 
 #endif /* DEBUG_SERIAL_PORT */
 
@@ -142,5 +321,8 @@ void InitUart()
 #ifdef TS_SECONDARY_SERIAL_PORT
     secondaryChannelThread.Start();
 #endif
+#ifdef EFI_CAN_SERIAL
+    startCanTsChannel();
+#endif
 #endif
 }
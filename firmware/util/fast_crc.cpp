@@ -0,0 +1,93 @@
+#include "fast_crc.h"
+
+#include <cstring>
+
+// Words are loaded in native order, the table layout assumes little endian
+static_assert(__BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__, "FastCrc32 needs a little endian target");
+
+namespace
+{
+
+// Reflected IEEE polynomial
+constexpr uint32_t Polynomial = 0xEDB88320;
+
+struct CrcTables
+{
+    // t[n][b] is the CRC of byte b followed by n zero bytes
+    uint32_t t[8][256];
+};
+
+constexpr CrcTables MakeTables()
+{
+    CrcTables tables = {};
+
+    for (uint32_t i = 0; i < 256; i++)
+    {
+        uint32_t c = i;
+        for (int k = 0; k < 8; k++)
+        {
+            c = (c & 1) ? (c >> 1) ^ Polynomial : c >> 1;
+        }
+
+        tables.t[0][i] = c;
+    }
+
+    for (uint32_t i = 0; i < 256; i++)
+    {
+        for (int n = 1; n < 8; n++)
+        {
+            uint32_t prev = tables.t[n - 1][i];
+            tables.t[n][i] = (prev >> 8) ^ tables.t[0][prev & 0xFF];
+        }
+    }
+
+    return tables;
+}
+
+// Computed at compile time, lives in flash
+constexpr CrcTables crcTables = MakeTables();
+
+}
+
+uint32_t FastCrc32Inc(const void* buf, uint32_t crc, size_t size)
+{
+    const auto& t = crcTables.t;
+    auto p = reinterpret_cast<const uint8_t*>(buf);
+
+    crc = ~crc;
+
+    // Single bytes until the pointer is word aligned
+    while (size && (reinterpret_cast<uintptr_t>(p) & 3))
+    {
+        crc = t[0][(crc ^ *p++) & 0xFF] ^ (crc >> 8);
+        size--;
+    }
+
+    while (size >= 8)
+    {
+        uint32_t lo;
+        uint32_t hi;
+        memcpy(&lo, p, sizeof(lo));
+        memcpy(&hi, p + 4, sizeof(hi));
+
+        lo ^= crc;
+
+        crc = t[7][lo & 0xFF] ^ t[6][(lo >> 8) & 0xFF] ^ t[5][(lo >> 16) & 0xFF] ^ t[4][lo >> 24]
+            ^ t[3][hi & 0xFF] ^ t[2][(hi >> 8) & 0xFF] ^ t[1][(hi >> 16) & 0xFF] ^ t[0][hi >> 24];
+
+        p += 8;
+        size -= 8;
+    }
+
+    while (size--)
+    {
+        crc = t[0][(crc ^ *p++) & 0xFF] ^ (crc >> 8);
+    }
+
+    return ~crc;
+}
+
+uint32_t FastCrc32(const void* buf, size_t size)
+{
+    return FastCrc32Inc(buf, 0, size);
+}
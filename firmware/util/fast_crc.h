@@ -0,0 +1,16 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+
+/**
+ * CRC-32 (IEEE 802.3), same results and calling convention as crc32()/crc32inc()
+ * from libfirmware, using slicing-by-8 tables: eight bytes per step instead of one.
+ *
+ * Costs 8kB of flash for the tables, so it is only used where throughput
+ * matters (TunerStudio framing).
+ */
+uint32_t FastCrc32(const void* buf, size_t size);
+
+// Continue a CRC, crc is the result of a previous call (0 to start)
+uint32_t FastCrc32Inc(const void* buf, uint32_t crc, size_t size);
@@ -1,5 +1,10 @@
 WIDEBANDSRC = \
 	$(FIRMWARE_DIR)/pid.cpp \
 	$(FIRMWARE_DIR)/sampling.cpp \
+	$(FIRMWARE_DIR)/esr_demodulator.cpp \
+	$(FIRMWARE_DIR)/lambda_filter.cpp \
+	$(FIRMWARE_DIR)/sensor_estimator.cpp \
+	$(FIRMWARE_DIR)/sensor_response.cpp \
 	$(FIRMWARE_DIR)/heater_control.cpp \
+	$(FIRMWARE_DIR)/config_migration.cpp \
 	$(FIRMWARE_DIR)/util/timer.cpp \
@@ -14,8 +14,30 @@
 //    Nernst voltage & ESR sense
 // *******************************
 
-// Heater low pass filter
-#define ESR_SENSE_ALPHA (0.002f)
+// ADC cycles per second
+#ifndef SAMPLING_RATE_HZ
+#define SAMPLING_RATE_HZ 2500
+#endif
+
+// ADC cycles per ESR driver half-period, the injection frequency is
+// SAMPLING_RATE_HZ / (2 * ESR_SAMPLES_PER_HALF_PERIOD). 1 toggles every cycle.
+#define ESR_SAMPLES_PER_HALF_PERIOD 1
+// ESR periods integrated by the lock-in demodulator per output
+#define ESR_DEMOD_DECIMATION 4
+// Bandwidth of the low pass on the demodulator output, the ESR and
+// therefore the heater loop can't follow the sensor faster than this
+#define ESR_DEMOD_BANDWIDTH_HZ (5.0f)
+
+// Nernst and pump current oversamples taken this close to a heater PWM edge are
+// left out of the average, in heater PWM counter ticks (2.5us). 0 keeps them all.
+#define HEATER_EDGE_BLANKING_TICKS 4
+// If fewer oversamples than this are left, all of them are averaged anyway
+#define HEATER_EDGE_MIN_CLEAN_SAMPLES (ADC_OVERSAMPLE / 2)
+
+// Sampler is considered stable once this many samples (~25ms) have gone through the
+// pump current filter's warm up and the ESR demodulator has produced an output.
+// While filters warm up they average all samples so far instead of decaying from zero
+#define ESR_SENSE_STABLE_SAMPLES 64
 
 // *******************************
 //       Pump current sense
@@ -30,6 +52,86 @@
 // sampling at 2.5khz, alpha of 0.01 gives about 50hz bandwidth
 #define PUMP_FILTER_ALPHA (0.02f)
 
+// *******************************
+//       TunerStudio livedata
+// *******************************
+
+// Output channels are rebuilt on request by the TS thread when older than this,
+// the sampling thread never spends time on them
+#define LIVEDATA_MAX_AGE_MS 10
+
+// *******************************
+//       Thread monitoring
+// *******************************
+
+// Lateness histogram of each periodic loop, buckets are this fraction of the period
+#define DEADLINE_HISTOGRAM_BUCKETS 8
+// A loop starting this late (% of its period) has missed its deadline
+#define DEADLINE_MISS_PERCENT 50
+
+// Cycle profiler histograms: bucket 0 is below 2^PROFILER_HISTOGRAM_SHIFT
+// cycles, each next one twice as wide, the last one open ended
+#define PROFILER_HISTOGRAM_BUCKETS 16
+#define PROFILER_HISTOGRAM_SHIFT 6
+// Stages a profiler can time, plus the total
+#define PROFILER_MAX_STAGES 6
+
+// *******************************
+//       Raw sample stream
+// *******************************
+
+// Records buffered for TS_SAMPLE_STREAM_COMMAND, 8 bytes each, power of 2
+// 256 records is ~100ms of one channel at full rate
+#define SAMPLE_STREAM_DEPTH 256
+
+// Sensor scope: records of the selected channel kept for a triggered capture
+// 256 records is ~100ms at full rate
+#define SCOPE_DEPTH 256
+// Part of the capture recorded after the trigger
+#define SCOPE_POST_TRIGGER_PERCENT 25
+// Armed at boot with these triggers, see SCOPE_TRIGGER_*
+#define SCOPE_DEFAULT_TRIGGERS SCOPE_TRIGGER_FAULT
+// Lambda change between two trigger checks, in 0.01 lambda
+#define SCOPE_LAMBDA_STEP 10
+// Fault, heater state and lambda are checked every this many ADC cycles (10ms)
+#define SCOPE_TRIGGER_CHECK_CYCLES 25
+
+// *******************************
+//       Debug serial port
+// *******************************
+
+// Human readable lines, 10 per second
+#define DEBUG_SERIAL_TEXT 0
+// Binary frames, see telemetry.h
+#define DEBUG_SERIAL_TELEMETRY 1
+// Compressed history, see data_log.h
+#define DEBUG_SERIAL_DATALOG 2
+
+#ifndef DEBUG_SERIAL_MODE
+    #define DEBUG_SERIAL_MODE DEBUG_SERIAL_TELEMETRY
+#endif
+
+// Status frames per second in DEBUG_SERIAL_TELEMETRY mode
+#ifndef DEBUG_SERIAL_TELEMETRY_HZ
+    #define DEBUG_SERIAL_TELEMETRY_HZ 10
+#endif
+
+// Binary data log
+#define DATALOG_INTERVAL_MS 100
+// Records per block, 32 at 100ms is a block every 3.2s
+#define DATALOG_BLOCK_RECORDS 32
+
+// *******************************
+//      TunerStudio over CAN
+// *******************************
+
+// Received ISO-TP bytes not yet read, holds one full incoming TS packet
+#define ISOTP_RX_BUFFER_SIZE 320
+// Consecutive frames we take before granting the next block
+#define ISOTP_BLOCK_SIZE 8
+// Flow control WAIT frames tolerated before a send is given up
+#define ISOTP_MAX_WAIT_FRAMES 10
+
 // *******************************
 //        Pump controller
 // *******************************
@@ -37,11 +139,88 @@
 
 #define PUMP_CONTROL_PERIOD 2
 
+// *******************************
+//     Sensor state estimator
+// *******************************
+
+// Lambda from the pump current with everything in order, 1 sigma
+#define SENSOR_EST_LAMBDA_SIGMA (0.005f)
+// How fast lambda may wander, per square root second
+#define SENSOR_EST_LAMBDA_DRIFT (0.045f)
+
+// Deviations are counted in these units, each adds its square times the
+// ideal variance to the lambda measurement's, about 10 make it invalid
+#define SENSOR_EST_NERNST_DEV (0.01f)
+#define SENSOR_EST_TEMP_DEV (10.0f)
+// Pump driver duty outside this range
+#define SENSOR_EST_PUMP_DUTY_MIN (0.1f)
+#define SENSOR_EST_PUMP_DUTY_MAX (0.9f)
+#define SENSOR_EST_PUMP_DUTY_DEV (0.005f)
+// Below what the sensor is specified for
+#define SENSOR_EST_LAMBDA_MIN (0.6f)
+#define SENSOR_EST_LAMBDA_RANGE_DEV (0.002f)
+
+// Sensor temperature random walk, C per square root second
+#define SENSOR_EST_TEMP_DRIFT (20.0f)
+// Extra temperature uncertainty per V^2 change in heater power
+#define SENSOR_EST_HEATER_GAIN (1.0f)
+// Temperature from the ESR, 1 sigma
+#define SENSOR_EST_ESR_TEMP_SIGMA (5.0f)
+
+// Lambda standard deviation at which confidence is 0.5, which is
+// where lambda stops being reported valid
+#define SENSOR_EST_LAMBDA_SIGMA_OK (0.01f)
+#define SENSOR_EST_VALID_CONFIDENCE (0.5f)
+
+// *******************************
+//   Sensor response estimator
+// *******************************
+
+// Square wave added to the pump current during a burst, mA, 0 turns the measurement off
+#define SENSOR_RESPONSE_DITHER_MA (0.05f)
+// Pump loop passes per dither period, 50 is 10 Hz with its third harmonic at 30 Hz
+#define SENSOR_RESPONSE_PERIOD_SAMPLES 50
+// Periods measured per burst
+#define SENSOR_RESPONSE_BURST_PERIODS 20
+// Periods run first to let the sensor and loop settle on the dither, a few
+// time constants of the slowest sensor
+#define SENSOR_RESPONSE_SETTLE_PERIODS 4
+// Burst to burst, the response only changes as the sensor ages. 0 never runs
+// a burst, the pump current stays free of dither.
+#define SENSOR_RESPONSE_INTERVAL_MS 60000
+// Sensor valid for this long before the first burst, or after an aborted one
+#define SENSOR_RESPONSE_HOLDOFF_MS 5000
+// Weight of each burst in the reported values
+#define SENSOR_RESPONSE_AVERAGE (0.25f)
+// Slower than this can't be told apart at the dither frequency
+#define SENSOR_RESPONSE_MAX_TAU_MS 300
+
+// *******************************
+//     Lambda output filters
+// *******************************
+
+// CAN and aux outputs both update every 10 ms, filters run at that rate
+#define LAMBDA_FILTER_RATE_HZ 100
+
+// Longest median window, samples
+#define LAMBDA_FILTER_MAX_MEDIAN 9
+
+// Used once a filter type is picked, all outputs default to bypass
+#define LAMBDA_FILTER_DEFAULT_MEDIAN 5
+#define LAMBDA_FILTER_DEFAULT_CUTOFF_HZ 10
+
 // *******************************
 //    Heater controller config
 // *******************************
 #define HEATER_CONTROL_PERIOD 50
 
+// Start heater control as soon as ESR sensing is stable instead of
+// always waiting HEATER_STARTUP_DELAY ms
+#ifndef HEATER_FAST_BOOT
+    #define HEATER_FAST_BOOT 1
+#endif
+#define HEATER_STARTUP_DELAY 1000
+
 #define HEATER_PREHEAT_TIME 5
 #define HEATER_WARMUP_TIMEOUT 60
 #define HEATER_CLOSED_LOOP_STAB_TIME 5
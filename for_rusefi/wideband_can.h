@@ -24,6 +24,15 @@
 #define WB_BL_REBOOT ((WB_BL_BASE + WB_OPCODE_REBOOT) << 16)
 #define WB_MSG_SET_INDEX 0xEF4'0000
 #define WB_MGS_ECU_STATUS 0xEF5'0000
+// TunerStudio over ISO-TP, plus the RusEfiIdx of the first channel
+// host to wideband
+#define WB_TS_RX_BASE 0xEF6'0000
+// wideband to host
+#define WB_TS_TX_BASE 0xEF7'0000
+// ThreadStatsData, plus the RusEfiIdx of the first channel
+#define WB_THREAD_STATS_BASE 0xEF8'0000
+// SensorResponseData, plus the RusEfiIdx of the channel
+#define WB_SENSOR_RESPONSE_BASE 0xEF9'0000
 #define WB_DATA_BASE_ADDR 0x190
 
 // we transmit every 10ms
@@ -52,7 +61,9 @@ struct StandardData
     uint16_t Lambda;
     uint16_t TemperatureC;
 
-    uint16_t pad;
+    // %, how far Lambda can be trusted, Valid is set from 50
+    uint8_t Confidence;
+    uint8_t pad;
 };
 
 struct DiagData
@@ -63,6 +74,33 @@ struct DiagData
     Fault Status;
 
     uint8_t HeaterDuty;
+    // ms Lambda lags the sensor by due to the configured filter, saturating
+    uint8_t LambdaDelay;
+};
+
+// One thread per frame in turn, see ThreadId in the wideband firmware
+struct ThreadStatsData
+{
+    uint8_t Thread;
+    // 0.5 %, 0xFF unknown
+    uint8_t CpuLoad;
+    // bytes, 0xFFFF unknown
+    uint16_t StackFree;
+    // longest loop pass, us
+    uint16_t LoopMaxUs;
+    // periodic loops only, saturating
+    uint16_t DeadlineMisses;
+};
+
+// Sensor modelled as a first order lag plus dead time, from the pump current
+// to the nernst voltage. Measured every minute or so, sent once a second.
+struct SensorResponseData
+{
+    // 0.1 ms, 0 until measured
+    uint16_t TimeConstant;
+    uint16_t Delay;
+    // measurements so far, saturating
+    uint8_t Count;
     uint8_t pad;
 };
 
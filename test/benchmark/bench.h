@@ -0,0 +1,64 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+
+/**
+ * Minimal micro-benchmark harness for the firmware hot paths.
+ *
+ *   BENCHMARK(Crc32_256)
+ *   {
+ *       for (size_t i = 0; i < iterations; i++)
+ *       {
+ *           DoNotOptimize(crc32(buffer, 256));
+ *       }
+ *   }
+ *
+ * The body runs the kernel `iterations` times, the runner picks the count
+ * and divides the time by it. Inputs should vary or be hidden behind
+ * DoNotOptimize() so the compiler can't hoist the work out of the loop.
+ */
+
+using BenchFunction = void (*)(size_t iterations);
+
+struct BenchEntry
+{
+    const char* Name;
+    BenchFunction Run;
+    // Bytes processed per iteration, reported as throughput if non-zero
+    size_t Bytes;
+    BenchEntry* Next;
+};
+
+// Adds to the list the runner walks, in registration order
+struct BenchRegistrar
+{
+    BenchRegistrar(BenchEntry& entry);
+};
+
+#define BENCHMARK_BYTES(name, bytes) \
+    static void Bench_##name(size_t iterations); \
+    static BenchEntry BenchEntry_##name = { #name, Bench_##name, bytes, nullptr }; \
+    static BenchRegistrar BenchRegistrar_##name(BenchEntry_##name); \
+    static void Bench_##name(size_t iterations)
+
+#define BENCHMARK(name) BENCHMARK_BYTES(name, 0)
+
+// Make the compiler believe value is used, and was possibly changed
+template <typename T>
+inline void DoNotOptimize(T& value)
+{
+    asm volatile("" : "+m"(value) : : "memory");
+}
+
+template <typename T>
+inline void DoNotOptimize(const T& value)
+{
+    asm volatile("" : : "m"(value) : "memory");
+}
+
+// Make the compiler believe all memory was read and written
+inline void ClobberMemory()
+{
+    asm volatile("" : : : "memory");
+}
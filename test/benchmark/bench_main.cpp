@@ -0,0 +1,270 @@
+/**
+ * Host benchmark runner, see bench.h
+ *
+ *   build/wideband_bench [--filter=<substring>] [--json=<file>|-]
+ *                        [--min-time=<seconds>] [--repetitions=<n>]
+ *                        [--commit=<id>]
+ *
+ * A table goes to stdout. --json writes Google Benchmark style JSON, one
+ * entry per benchmark with the median of the repetitions, so the usual
+ * comparison tooling works on it. --commit is copied into the context to
+ * tie a result file to a revision.
+ */
+
+#include "bench.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <string>
+#include <vector>
+
+#include <unistd.h>
+
+static BenchEntry* first = nullptr;
+static BenchEntry* last = nullptr;
+
+BenchRegistrar::BenchRegistrar(BenchEntry& entry)
+{
+    if (last)
+    {
+        last->Next = &entry;
+    }
+    else
+    {
+        first = &entry;
+    }
+
+    last = &entry;
+}
+
+struct Options
+{
+    const char* Filter = "";
+    const char* Json = nullptr;
+    const char* Commit = nullptr;
+    double MinTime = 0.1;
+    int Repetitions = 5;
+};
+
+struct Result
+{
+    const BenchEntry* Entry;
+    size_t Iterations;
+    // ns per iteration
+    double RealMedian;
+    double RealMin;
+    double CpuMedian;
+};
+
+static double Now(clockid_t clock)
+{
+    timespec ts;
+    clock_gettime(clock, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static double Median(std::vector<double> v)
+{
+    std::sort(v.begin(), v.end());
+    size_t n = v.size();
+    return n % 2 ? v[n / 2] : (v[n / 2 - 1] + v[n / 2]) / 2;
+}
+
+static Result Run(const BenchEntry& e, const Options& o)
+{
+    // Grow the iteration count until one run takes at least MinTime
+    size_t iterations = 1;
+
+    while (true)
+    {
+        double start = Now(CLOCK_MONOTONIC);
+        e.Run(iterations);
+        double elapsed = Now(CLOCK_MONOTONIC) - start;
+
+        if (elapsed >= o.MinTime || iterations >= 1000000000)
+        {
+            break;
+        }
+
+        double scale = elapsed > 0 ? o.MinTime * 1.2 / elapsed : 100;
+        scale = std::min(std::max(scale, 2.0), 100.0);
+        iterations = std::min<size_t>(iterations * scale, 1000000000);
+    }
+
+    std::vector<double> real;
+    std::vector<double> cpu;
+
+    for (int r = 0; r < o.Repetitions; r++)
+    {
+        double startReal = Now(CLOCK_MONOTONIC);
+        double startCpu = Now(CLOCK_PROCESS_CPUTIME_ID);
+        e.Run(iterations);
+        cpu.push_back((Now(CLOCK_PROCESS_CPUTIME_ID) - startCpu) * 1e9 / iterations);
+        real.push_back((Now(CLOCK_MONOTONIC) - startReal) * 1e9 / iterations);
+    }
+
+    return { &e, iterations, Median(real), *std::min_element(real.begin(), real.end()), Median(cpu) };
+}
+
+static std::string Escape(const char* s)
+{
+    std::string out;
+
+    for (; *s; s++)
+    {
+        if (*s == '"' || *s == '\\')
+        {
+            out += '\\';
+        }
+
+        if ((unsigned char)*s >= 0x20)
+        {
+            out += *s;
+        }
+    }
+
+    return out;
+}
+
+static bool WriteJson(const char* path, const char* executable, const Options& o, const std::vector<Result>& results)
+{
+    FILE* f = strcmp(path, "-") ? fopen(path, "w") : stdout;
+
+    if (!f)
+    {
+        perror(path);
+        return false;
+    }
+
+    char host[256] = "";
+    gethostname(host, sizeof(host) - 1);
+
+    char date[64];
+    time_t t = time(nullptr);
+    strftime(date, sizeof(date), "%Y-%m-%dT%H:%M:%S%z", localtime(&t));
+
+    fprintf(f, "{\n  \"context\": {\n");
+    fprintf(f, "    \"date\": \"%s\",\n", date);
+    fprintf(f, "    \"host_name\": \"%s\",\n", Escape(host).c_str());
+    fprintf(f, "    \"executable\": \"%s\",\n", Escape(executable).c_str());
+    fprintf(f, "    \"num_cpus\": %ld,\n", sysconf(_SC_NPROCESSORS_ONLN));
+    if (o.Commit)
+    {
+        fprintf(f, "    \"git_commit\": \"%s\",\n", Escape(o.Commit).c_str());
+    }
+    fprintf(f, "    \"library_build_type\": \"release\"\n  },\n  \"benchmarks\": [\n");
+
+    for (size_t i = 0; i < results.size(); i++)
+    {
+        const auto& r = results[i];
+
+        fprintf(f, "    {\n");
+        fprintf(f, "      \"name\": \"%s\",\n", r.Entry->Name);
+        fprintf(f, "      \"run_name\": \"%s\",\n", r.Entry->Name);
+        fprintf(f, "      \"run_type\": \"iteration\",\n");
+        fprintf(f, "      \"repetitions\": %d,\n", o.Repetitions);
+        fprintf(f, "      \"iterations\": %zu,\n", r.Iterations);
+        fprintf(f, "      \"real_time\": %.3f,\n", r.RealMedian);
+        fprintf(f, "      \"cpu_time\": %.3f,\n", r.CpuMedian);
+        fprintf(f, "      \"min_real_time\": %.3f,\n", r.RealMin);
+        if (r.Entry->Bytes)
+        {
+            fprintf(f, "      \"bytes_per_second\": %.0f,\n", r.Entry->Bytes * 1e9 / r.RealMedian);
+        }
+        fprintf(f, "      \"time_unit\": \"ns\"\n");
+        fprintf(f, "    }%s\n", i + 1 < results.size() ? "," : "");
+    }
+
+    fprintf(f, "  ]\n}\n");
+
+    if (f != stdout)
+    {
+        fclose(f);
+    }
+
+    return true;
+}
+
+static bool ParseArg(const char* arg, const char* name, const char** value)
+{
+    size_t n = strlen(name);
+
+    if (strncmp(arg, name, n) == 0 && arg[n] == '=')
+    {
+        *value = arg + n + 1;
+        return true;
+    }
+
+    return false;
+}
+
+int main(int argc, char** argv)
+{
+    Options o;
+
+    for (int i = 1; i < argc; i++)
+    {
+        const char* value;
+
+        if (ParseArg(argv[i], "--filter", &value))
+        {
+            o.Filter = value;
+        }
+        else if (ParseArg(argv[i], "--json", &value))
+        {
+            o.Json = value;
+        }
+        else if (ParseArg(argv[i], "--commit", &value))
+        {
+            o.Commit = value;
+        }
+        else if (ParseArg(argv[i], "--min-time", &value))
+        {
+            o.MinTime = atof(value);
+        }
+        else if (ParseArg(argv[i], "--repetitions", &value))
+        {
+            o.Repetitions = std::max(1, atoi(value));
+        }
+        else
+        {
+            fprintf(stderr, "usage: %s [--filter=<substring>] [--json=<file>|-] [--min-time=<s>] [--repetitions=<n>] [--commit=<id>]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    // JSON on stdout replaces the table
+    FILE* table = (o.Json && !strcmp(o.Json, "-")) ? stderr : stdout;
+
+    fprintf(table, "%-28s %12s %12s %12s %12s\n", "Benchmark", "Iterations", "Median ns", "Min ns", "MB/s");
+
+    std::vector<Result> results;
+
+    for (const BenchEntry* e = first; e; e = e->Next)
+    {
+        if (!strstr(e->Name, o.Filter))
+        {
+            continue;
+        }
+
+        Result r = Run(*e, o);
+        results.push_back(r);
+
+        fprintf(table, "%-28s %12zu %12.2f %12.2f", e->Name, r.Iterations, r.RealMedian, r.RealMin);
+        if (e->Bytes)
+        {
+            fprintf(table, " %12.1f", e->Bytes * 1e3 / r.RealMedian);
+        }
+        fprintf(table, "\n");
+    }
+
+    if (o.Json && !WriteJson(o.Json, argv[0], o, results))
+    {
+        return 1;
+    }
+
+    return 0;
+}
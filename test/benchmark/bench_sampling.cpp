@@ -0,0 +1,96 @@
+#include "bench.h"
+
+#include "sampling.h"
+#include "lambda_conversion.h"
+#include "pid.h"
+#include "port.h"
+
+static constexpr float virtualGroundVoltage = 1.65f;
+
+// Nernst toggling with the ESR drive, pump current sweeping a little
+static AnalogChannelResult MakeSample(size_t i)
+{
+    AnalogChannelResult r;
+    r.NernstVoltage = (i & 1) ? 0.55f : 0.35f;
+    r.PumpCurrentVoltage = 1.75f + (i & 0xF) * 0.001f;
+    r.HeaterSupplyVoltage = 13.5f;
+    r.NernstClamped = false;
+    return r;
+}
+
+// Samplers settled at a few different pump currents
+static Sampler* WarmSamplers()
+{
+    static Sampler samplers[4];
+    static bool warm = false;
+
+    if (!warm)
+    {
+        for (size_t s = 0; s < 4; s++)
+        {
+            for (size_t i = 0; i < 5000; i++)
+            {
+                auto r = MakeSample(i);
+                r.PumpCurrentVoltage = 1.6f + s * 0.1f;
+                samplers[s].ApplySample(r, virtualGroundVoltage);
+            }
+        }
+
+        warm = true;
+    }
+
+    return samplers;
+}
+
+BENCHMARK(Sampler_ApplySample)
+{
+    static Sampler dut;
+
+    AnalogChannelResult samples[16];
+    for (size_t i = 0; i < 16; i++)
+    {
+        samples[i] = MakeSample(i);
+    }
+
+    for (size_t i = 0; i < iterations; i++)
+    {
+        dut.ApplySample(samples[i & 0xF], virtualGroundVoltage);
+    }
+
+    DoNotOptimize(dut);
+}
+
+BENCHMARK(GetLambda)
+{
+    const Sampler* samplers = WarmSamplers();
+
+    for (size_t i = 0; i < iterations; i++)
+    {
+        DoNotOptimize(GetLambda(samplers[i & 3]));
+    }
+}
+
+BENCHMARK(GetSensorTemperature)
+{
+    const Sampler* samplers = WarmSamplers();
+
+    for (size_t i = 0; i < iterations; i++)
+    {
+        DoNotOptimize(samplers[i & 3].GetSensorTemperature());
+    }
+}
+
+BENCHMARK(Pid_GetOutput)
+{
+    static const PidConfig config = { 0.5f, 2.0f, 0.01f, 1.0f };
+    Pid pid(config, 2);
+
+    float observation = 0.45f;
+
+    for (size_t i = 0; i < iterations; i++)
+    {
+        DoNotOptimize(observation);
+        float output = pid.GetOutput(0.45f, observation + (i & 7) * 0.001f);
+        DoNotOptimize(output);
+    }
+}
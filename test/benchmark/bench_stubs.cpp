@@ -0,0 +1,20 @@
+#include "sampling.h"
+#include "port.h"
+
+// Board hooks the benchmarked code calls into
+
+SensorType GetSensorType()
+{
+    return SensorType::LSU49;
+}
+
+int GetESRSupplyR()
+{
+    return 22000;
+}
+
+const ISampler& GetSampler(int)
+{
+    static Sampler sampler;
+    return sampler;
+}
@@ -0,0 +1,124 @@
+#include "bench.h"
+
+#include <cstring>
+
+#include <rusefi/crc.h>
+#include <rusefi/fragments.h>
+#include <rusefi/interpolation.h>
+
+#include "fast_crc.h"
+#include "fixed_point.h"
+
+// Same shape as the aux out curve from the default configuration
+BENCHMARK(Interpolate2d_AuxOut)
+{
+    float bins[8];
+    float values[8];
+
+    for (int i = 0; i < 8; i++)
+    {
+        bins[i] = 8.5f + (18.0f - 8.5f) / 7 * i;
+        values[i] = 5.0f / 7 * i;
+    }
+
+    DoNotOptimize(bins);
+    DoNotOptimize(values);
+
+    for (size_t i = 0; i < iterations; i++)
+    {
+        // Sweep the whole curve and a little past both ends
+        float input = 8.0f + (i & 0x3FF) * (11.0f / 1024);
+        DoNotOptimize(interpolate2d(input, bins, values));
+    }
+}
+
+BENCHMARK(ScaledValue_ToFloat)
+{
+    ScaledValue<int16_t, 1, 10> raw[16];
+    for (int i = 0; i < 16; i++)
+    {
+        raw[i].setRaw(i * 1000 - 8000);
+    }
+
+    DoNotOptimize(raw);
+
+    for (size_t i = 0; i < iterations; i++)
+    {
+        DoNotOptimize(raw[i & 0xF].getValue());
+    }
+}
+
+BENCHMARK(ScaledValue_FromFloat)
+{
+    ScaledValue<int16_t, 1, 10> v;
+
+    for (size_t i = 0; i < iterations; i++)
+    {
+        // In range, and clamped at both ends
+        v = (float)((int)(i & 0x3FF) - 512) * 10.0f;
+        DoNotOptimize(v);
+    }
+}
+
+static uint8_t crcBuffer[256];
+
+BENCHMARK_BYTES(Crc32_256, sizeof(crcBuffer))
+{
+    DoNotOptimize(crcBuffer);
+
+    for (size_t i = 0; i < iterations; i++)
+    {
+        DoNotOptimize(crc32(crcBuffer, sizeof(crcBuffer)));
+    }
+}
+
+BENCHMARK_BYTES(FastCrc32_256, sizeof(crcBuffer))
+{
+    DoNotOptimize(crcBuffer);
+
+    for (size_t i = 0; i < iterations; i++)
+    {
+        DoNotOptimize(FastCrc32(crcBuffer, sizeof(crcBuffer)));
+    }
+}
+
+// Output channel layout: a handful of fragments making up 256 bytes
+struct Fragment32
+{
+    uint8_t data[32];
+};
+
+struct Fragment16
+{
+    uint8_t data[16];
+};
+
+static Fragment32 common, afr0, afr1, boot, threads0, threads1;
+static Fragment16 egt0, egt1;
+
+static const FragmentEntry fragments[] = {
+    &common, &afr0, &afr1, &egt0, &egt1, &boot, &threads0, &threads1,
+};
+
+BENCHMARK_BYTES(CopyRange_Livedata, 256)
+{
+    uint8_t image[256];
+
+    for (size_t i = 0; i < iterations; i++)
+    {
+        copyRange(image, { fragments, sizeof(fragments) / sizeof(fragments[0]) }, 0, sizeof(image));
+        DoNotOptimize(image);
+    }
+}
+
+// Scattered reads: a few bytes from the middle of a fragment
+BENCHMARK(CopyRange_Scattered)
+{
+    uint8_t value[4];
+
+    for (size_t i = 0; i < iterations; i++)
+    {
+        copyRange(value, { fragments, sizeof(fragments) / sizeof(fragments[0]) }, (i * 36) & 0xF8, sizeof(value));
+        DoNotOptimize(value);
+    }
+}
@@ -0,0 +1,100 @@
+/**
+ * Benchmark runner for the QEMU image, see run_qemu_bench.py
+ *
+ * Takes its command line from semihosting:
+ *
+ *   wideband_bench --list              name and bytes of each benchmark
+ *   wideband_bench <name> <iterations> runs one benchmark, then exits
+ *
+ * There's no clock worth reading under QEMU, the runner counts the
+ * instructions executed by whole runs instead.
+ */
+
+#include "../bench.h"
+#include "semihosting.h"
+
+#include <cstdlib>
+#include <cstring>
+
+static BenchEntry* first = nullptr;
+static BenchEntry* last = nullptr;
+
+BenchRegistrar::BenchRegistrar(BenchEntry& entry)
+{
+    if (last)
+    {
+        last->Next = &entry;
+    }
+    else
+    {
+        first = &entry;
+    }
+
+    last = &entry;
+}
+
+static void WriteNumber(size_t value)
+{
+    char buffer[12];
+    char* p = buffer + sizeof(buffer) - 1;
+    *p = '\0';
+
+    do
+    {
+        *--p = '0' + value % 10;
+        value /= 10;
+    } while (value);
+
+    SemihostingWrite(p);
+}
+
+static void List()
+{
+    for (const BenchEntry* e = first; e; e = e->Next)
+    {
+        SemihostingWrite(e->Name);
+        SemihostingWrite(" ");
+        WriteNumber(e->Bytes);
+        SemihostingWrite("\n");
+    }
+}
+
+int main()
+{
+    static char cmdline[128];
+
+    if (!SemihostingGetCommandLine(cmdline, sizeof(cmdline)))
+    {
+        SemihostingWrite("no command line\n");
+        return 1;
+    }
+
+    // Skip the program name
+    strtok(cmdline, " ");
+    const char* name = strtok(nullptr, " ");
+    const char* iterations = strtok(nullptr, " ");
+
+    if (name && !strcmp(name, "--list"))
+    {
+        List();
+        return 0;
+    }
+
+    if (!name || !iterations)
+    {
+        SemihostingWrite("usage: wideband_bench --list | <name> <iterations>\n");
+        return 1;
+    }
+
+    for (const BenchEntry* e = first; e; e = e->Next)
+    {
+        if (!strcmp(e->Name, name))
+        {
+            e->Run(strtoul(iterations, nullptr, 10));
+            return 0;
+        }
+    }
+
+    SemihostingWrite("unknown benchmark\n");
+    return 1;
+}
@@ -0,0 +1,176 @@
+#!/usr/bin/env python3
+"""
+Instruction counts per benchmark kernel on the firmware's own cores, under
+qemu-system-arm.
+
+    run_qemu_bench.py                         both boards, table on stdout
+    run_qemu_bench.py --board f0_module --filter Crc
+    run_qemu_bench.py --json qemu_bench.json --commit $(git rev-parse HEAD)
+
+Builds the image for each board (make BOARD=...), then runs every kernel
+twice with a different iteration count under QEMU's instruction counting
+plugin (libinsn). The difference divided by the extra iterations is the
+count per iteration, with startup, warm up and exit cancelled out.
+
+These are instructions, not cycles: QEMU doesn't model the pipeline, flash
+wait states or the M0's multi-cycle loads. That's still enough to see what
+soft float, the M0's missing divide and its smaller instruction set cost.
+"""
+
+import argparse
+import glob
+import json
+import os
+import re
+import socket
+import subprocess
+import sys
+import tempfile
+import time
+
+HERE = os.path.dirname(os.path.abspath(__file__))
+
+# Any machine with the right core will do, the kernels only touch RAM
+BOARDS = {
+    "f0_module": ("cortex-m0", "microbit"),
+    "f1_rev3": ("cortex-m3", "mps2-an385"),
+}
+
+PLUGIN_SEARCH = [
+    "/usr/lib/*/qemu/libinsn.so",
+    "/usr/lib/qemu/libinsn.so",
+    "/usr/local/lib/qemu/libinsn.so",
+    "/usr/local/libexec/qemu/plugins/libinsn.so",
+]
+
+
+def find_plugin(path):
+    if path:
+        return path
+
+    for pattern in PLUGIN_SEARCH:
+        found = glob.glob(pattern)
+        if found:
+            return found[0]
+
+    sys.exit("libinsn.so not found, build QEMU's tests/tcg/plugins and pass --plugin")
+
+
+def build(board):
+    subprocess.run(["make", "-s", "-C", HERE, "BOARD=" + board], check=True)
+    return os.path.join(HERE, "build", board, "wideband_bench.elf")
+
+
+def run(args, machine, elf, plugin, *cmdline):
+    """Runs the image with cmdline, returns (semihosting output, instructions)"""
+    with tempfile.NamedTemporaryFile(suffix=".log") as log:
+        semihosting = "enable=on,target=native,arg=wideband_bench"
+        for arg in cmdline:
+            semihosting += ",arg=" + str(arg)
+
+        result = subprocess.run([
+            args.qemu,
+            "-M", machine,
+            "-nographic",
+            "-monitor", "none",
+            "-serial", "none",
+            "-kernel", elf,
+            "-semihosting-config", semihosting,
+            "-plugin", plugin,
+            "-d", "plugin",
+            "-D", log.name,
+        ], capture_output=True, text=True, timeout=args.timeout)
+
+        if result.returncode != 0:
+            sys.exit("%s %s failed: %s%s" % (machine, " ".join(map(str, cmdline)), result.stdout, result.stderr))
+
+        match = re.search(r"insns: (\d+)", open(log.name).read())
+        if not match:
+            sys.exit("no instruction count from the plugin")
+
+        return result.stdout, int(match.group(1))
+
+
+def bench_board(args, board, plugin):
+    mcu, machine = BOARDS[board]
+    elf = build(board)
+
+    listing, _ = run(args, machine, elf, plugin, "--list")
+
+    results = []
+
+    for line in listing.splitlines():
+        name, size = line.split()
+
+        if args.filter not in name:
+            continue
+
+        _, low = run(args, machine, elf, plugin, name, args.iterations)
+        _, high = run(args, machine, elf, plugin, name, 2 * args.iterations)
+
+        results.append({
+            "name": "%s/%s" % (board, name),
+            "run_name": "%s/%s" % (board, name),
+            "run_type": "iteration",
+            "repetitions": 1,
+            "iterations": args.iterations,
+            "board": board,
+            "mcu": mcu,
+            "machine": machine,
+            "bytes": int(size),
+            "instructions": (high - low) / args.iterations,
+        })
+
+    return results
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.split("\n\n")[0].strip())
+    parser.add_argument("--board", action="append", choices=sorted(BOARDS), help="default: all")
+    parser.add_argument("--filter", default="", help="only benchmarks containing this")
+    parser.add_argument("--iterations", type=int, default=64, help="extra iterations of the second run")
+    parser.add_argument("--qemu", default="qemu-system-arm")
+    parser.add_argument("--plugin", help="path to QEMU's libinsn.so")
+    parser.add_argument("--timeout", type=float, default=60, help="seconds per QEMU run")
+    parser.add_argument("--json", help="Google Benchmark style results, - for stdout")
+    parser.add_argument("--commit", help="recorded in the JSON context")
+    args = parser.parse_args()
+
+    plugin = find_plugin(args.plugin)
+    boards = args.board or sorted(BOARDS)
+
+    # JSON on stdout replaces the table
+    table = sys.stderr if args.json == "-" else sys.stdout
+
+    results = []
+    for board in boards:
+        board_results = bench_board(args, board, plugin)
+        results += board_results
+
+        print("%-38s %10s %12s" % ("Benchmark", "Insns", "Insns/byte"), file=table)
+        for r in board_results:
+            per_byte = "%12.2f" % (r["instructions"] / r["bytes"]) if r["bytes"] else ""
+            print("%-38s %10.1f %s" % (r["name"], r["instructions"], per_byte), file=table)
+        print(file=table)
+
+    if args.json:
+        context = {
+            "date": time.strftime("%Y-%m-%dT%H:%M:%S%z"),
+            "host_name": socket.gethostname(),
+            "executable": args.qemu,
+            "library_build_type": "release",
+        }
+        if args.commit:
+            context["git_commit"] = args.commit
+
+        text = json.dumps({"context": context, "benchmarks": results}, indent=2)
+
+        if args.json == "-":
+            print(text)
+        else:
+            with open(args.json, "w") as f:
+                f.write(text + "\n")
+
+
+if __name__ == "__main__":
+    main()
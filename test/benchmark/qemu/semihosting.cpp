@@ -0,0 +1,45 @@
+#include "semihosting.h"
+
+#include <cstdint>
+
+#define SYS_WRITE0 0x04
+#define SYS_GET_CMDLINE 0x15
+#define SYS_EXIT 0x18
+#define SYS_EXIT_EXTENDED 0x20
+
+#define ADP_STOPPED_APPLICATION_EXIT 0x20026
+
+static uintptr_t Call(uintptr_t op, const void* arg)
+{
+    register uintptr_t r0 asm("r0") = op;
+    register const void* r1 asm("r1") = arg;
+
+    // Same encoding on v6-M and v7-M
+    asm volatile("bkpt 0xAB" : "+r"(r0) : "r"(r1) : "memory");
+
+    return r0;
+}
+
+void SemihostingWrite(const char* str)
+{
+    Call(SYS_WRITE0, str);
+}
+
+bool SemihostingGetCommandLine(char* buffer, size_t size)
+{
+    uintptr_t block[2] = { (uintptr_t)buffer, size };
+
+    return Call(SYS_GET_CMDLINE, block) == 0;
+}
+
+void SemihostingExit(int status)
+{
+    // The extended call passes the exit code through to QEMU's own
+    uintptr_t block[2] = { ADP_STOPPED_APPLICATION_EXIT, (uintptr_t)status };
+    Call(SYS_EXIT_EXTENDED, block);
+
+    // Older QEMU without it only has success
+    Call(SYS_EXIT, (const void*)ADP_STOPPED_APPLICATION_EXIT);
+
+    while (true) ;
+}
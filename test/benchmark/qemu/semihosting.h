@@ -0,0 +1,13 @@
+#pragma once
+
+#include <cstddef>
+
+// ARM semihosting, QEMU needs -semihosting-config enable=on,target=native
+
+// Prints a null terminated string on QEMU's stdout
+void SemihostingWrite(const char* str);
+
+// Command line from -semihosting-config arg=..., returns false if it didn't fit
+bool SemihostingGetCommandLine(char* buffer, size_t size);
+
+[[noreturn]] void SemihostingExit(int status);
@@ -0,0 +1,76 @@
+#include <cstdint>
+
+#include "semihosting.h"
+
+/**
+ * Bare metal startup for the QEMU benchmark image. No ChibiOS and no clock
+ * or peripheral setup: the kernels only need the core, RAM and semihosting.
+ */
+
+extern "C"
+{
+extern uint32_t __stack_top__;
+extern uint32_t __data_load__;
+extern uint32_t __data_start__;
+extern uint32_t __data_end__;
+extern uint32_t __bss_start__;
+extern uint32_t __bss_end__;
+
+extern void (*__init_array_start__[])();
+extern void (*__init_array_end__[])();
+
+int main();
+
+void Reset_Handler();
+void Fault_Handler();
+}
+
+void Reset_Handler()
+{
+    const uint32_t* src = &__data_load__;
+    for (uint32_t* dst = &__data_start__; dst < &__data_end__; )
+    {
+        *dst++ = *src++;
+    }
+
+    for (uint32_t* dst = &__bss_start__; dst < &__bss_end__; )
+    {
+        *dst++ = 0;
+    }
+
+    // Static constructors, this is where the benchmarks register
+    for (auto f = __init_array_start__; f < __init_array_end__; f++)
+    {
+        (*f)();
+    }
+
+    SemihostingExit(main());
+}
+
+// Anything ending up here is a bug in a kernel, fail the run
+void Fault_Handler()
+{
+    SemihostingWrite("fault\n");
+    SemihostingExit(1);
+}
+
+// Only the core exceptions, nothing here enables an interrupt
+__attribute__((section(".vectors"), used))
+static void* const vectors[16] = {
+    &__stack_top__,
+    (void*)Reset_Handler,
+    (void*)Fault_Handler,   // NMI
+    (void*)Fault_Handler,   // HardFault
+    (void*)Fault_Handler,   // MemManage
+    (void*)Fault_Handler,   // BusFault
+    (void*)Fault_Handler,   // UsageFault
+    nullptr,
+    nullptr,
+    nullptr,
+    nullptr,
+    (void*)Fault_Handler,   // SVCall
+    (void*)Fault_Handler,   // DebugMonitor
+    nullptr,
+    (void*)Fault_Handler,   // PendSV
+    (void*)Fault_Handler,   // SysTick
+};
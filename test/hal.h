@@ -0,0 +1,20 @@
+#pragma once
+
+// Just enough of ChibiOS for the TunerStudio protocol code to build on the host
+
+#include <cstdint>
+
+#define HAL_USE_SERIAL FALSE
+#define HAL_USE_UART FALSE
+
+#define TIME_MS2I(ms) (ms)
+
+typedef int tprio_t;
+#define NORMALPRIO 128
+
+struct thread_t;
+#define THD_WORKING_AREA(name, size) uint8_t name[size]
+
+// Reported by the test that tripped it
+void chDbgAssertFailed(const char* reason);
+#define chDbgAssert(c, reason) do { if (!(c)) { chDbgAssertFailed(reason); } } while (0)
@@ -0,0 +1,97 @@
+#include <gtest/gtest.h>
+
+#include <cstring>
+#include <vector>
+
+#include "app_image.h"
+
+static std::vector<uint8_t> MakeImage(size_t size)
+{
+    std::vector<uint8_t> image(size, 0xFF);
+
+    // Some "code" at the start, rest is erased flash padding
+    for (size_t i = 0; i < size / 4; i++)
+    {
+        image[i] = i * 7 + 3;
+    }
+
+    // Trailer is big endian CRC of everything before it
+    uint32_t crc = AppImageCrcSoftware(image.data(), size - AppImageCrcSize);
+    image[size - 4] = crc >> 24;
+    image[size - 3] = crc >> 16;
+    image[size - 2] = crc >> 8;
+    image[size - 1] = crc;
+
+    return image;
+}
+
+TEST(AppImage, SoftwareCrcKnownValue)
+{
+    // Standard CRC32 check value
+    const char* check = "123456789";
+    EXPECT_EQ(0xCBF43926, AppImageCrcSoftware(reinterpret_cast<const uint8_t*>(check), strlen(check)));
+}
+
+TEST(AppImage, StoredCrcIsBigEndian)
+{
+    uint8_t image[8] = { 0, 0, 0, 0, 0x12, 0x34, 0x56, 0x78 };
+
+    EXPECT_EQ(0x12345678u, AppImageStoredCrc(image, sizeof(image)));
+}
+
+TEST(AppImage, ValidImage)
+{
+    auto image = MakeImage(25600);
+
+    EXPECT_TRUE(AppImageIsValid(image.data(), image.size()));
+}
+
+TEST(AppImage, CorruptImage)
+{
+    auto image = MakeImage(25600);
+
+    // Flip a bit in the padding
+    image[20000] ^= 0x10;
+    EXPECT_FALSE(AppImageIsValid(image.data(), image.size()));
+}
+
+TEST(AppImage, ErasedImage)
+{
+    std::vector<uint8_t> image(25600, 0xFF);
+
+    EXPECT_FALSE(AppImageIsValid(image.data(), image.size()));
+}
+
+TEST(AppImage, TooSmall)
+{
+    uint8_t image[4] = {};
+
+    EXPECT_FALSE(AppImageIsValid(image, sizeof(image)));
+}
+
+TEST(AppImage, CustomCrcFunction)
+{
+    auto image = MakeImage(1024);
+
+    // Bogus CRC unit never matches
+    EXPECT_FALSE(AppImageIsValid(image.data(), image.size(), [](const uint8_t*, size_t) { return 0u; }));
+}
+
+TEST(AppImage, ValidCache)
+{
+    AppImageValidCache cache;
+
+    // Power-up garbage
+    memset(&cache, 0xA5, sizeof(cache));
+    EXPECT_FALSE(AppImageCacheHit(cache, 0xA5A5A5A5));
+
+    AppImageCacheSet(cache, 0x12345678);
+    EXPECT_TRUE(AppImageCacheHit(cache, 0x12345678));
+
+    // Different image
+    EXPECT_FALSE(AppImageCacheHit(cache, 0x12345679));
+
+    AppImageCacheClear(cache);
+    EXPECT_FALSE(AppImageCacheHit(cache, 0x12345678));
+    EXPECT_FALSE(AppImageCacheHit(cache, 0));
+}
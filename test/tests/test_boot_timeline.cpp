@@ -0,0 +1,49 @@
+#include <gtest/gtest.h>
+
+#include "boot_timeline.h"
+#include "timer.h"
+
+TEST(BootTimeline, Pending)
+{
+    Timer::setMockTime(0);
+    BootTimelineStart();
+
+    EXPECT_EQ(0, BootTimelineCount());
+
+    for (int i = 0; i < static_cast<int>(BootStage::Count); i++)
+    {
+        EXPECT_EQ(BOOT_STAGE_PENDING, BootTimelineGetMs(static_cast<BootStage>(i)));
+        EXPECT_EQ(BOOT_STAGE_PENDING, GetBootTimeline()->stageMs[i]);
+    }
+}
+
+TEST(BootTimeline, MarkFirstOnly)
+{
+    Timer::setMockTime(1'000'000);
+    BootTimelineStart();
+
+    Timer::advanceMockTime(12'500);
+    BootTimelineMark(BootStage::Config);
+    EXPECT_EQ(12, BootTimelineGetMs(BootStage::Config));
+    EXPECT_EQ(1, BootTimelineCount());
+
+    // Later marks of the same stage don't move it
+    Timer::advanceMockTime(100'000);
+    BootTimelineMark(BootStage::Config);
+    EXPECT_EQ(12, BootTimelineGetMs(BootStage::Config));
+    EXPECT_EQ(1, BootTimelineCount());
+
+    BootTimelineMark(BootStage::ClosedLoop);
+    EXPECT_EQ(112, BootTimelineGetMs(BootStage::ClosedLoop));
+    EXPECT_EQ(2, BootTimelineCount());
+}
+
+TEST(BootTimeline, Saturates)
+{
+    Timer::setMockTime(0);
+    BootTimelineStart();
+
+    Timer::advanceMockTime(100'000'000);
+    BootTimelineMark(BootStage::ClosedLoop);
+    EXPECT_EQ(BOOT_STAGE_PENDING - 1, BootTimelineGetMs(BootStage::ClosedLoop));
+}
@@ -19,6 +19,7 @@ namespace ConfigSizes {
     constexpr size_t EGT_CHANNEL = 8;
     constexpr size_t EGT_SETTINGS = EGT_CHANNEL * 2;
     constexpr size_t HEATER_CONFIG = 8;
+    constexpr size_t LAMBDA_FILTER = 4;
 }
 #pragma GCC diagnostic pop
 
@@ -210,6 +211,30 @@ TEST(ConfigLayout, BinaryCompatibility_HeaterConfig) {
     EXPECT_FLOAT_EQ(config.heaterConfig.PreheatTimeSec, 125.0f);
 }
 
+TEST(ConfigLayout, BinaryCompatibility_LambdaFilter) {
+    Configuration config = {};
+
+    size_t offset = ConfigSizes::TAG
+                  + ConfigSizes::NO_LONGER_USED_0
+                  + ConfigSizes::AUX_OUT_BINS
+                  + ConfigSizes::AUX_OUT_VALUES
+                  + ConfigSizes::AUX_OUTPUT_SOURCE
+                  + ConfigSizes::SENSOR_TYPE
+                  + ConfigSizes::AFR_SETTINGS
+                  + ConfigSizes::EGT_SETTINGS
+                  + ConfigSizes::HEATER_CONFIG
+                  + ConfigSizes::LAMBDA_FILTER; // AemNet
+
+    WriteAtOffset(config, offset++, static_cast<uint8_t>(2)); // Type
+    WriteAtOffset(config, offset++, static_cast<uint8_t>(7)); // MedianLength
+    WriteAtOffset(config, offset++, static_cast<uint8_t>(35)); // CutoffHz
+
+    const auto& filter = config.lambdaFilter[static_cast<int>(LambdaOutput::AemNet)];
+    EXPECT_EQ(filter.Type, LambdaFilterType::Median);
+    EXPECT_EQ(filter.MedianLength, 7);
+    EXPECT_FLOAT_EQ(filter.CutoffHz, 3.5f);
+}
+
 TEST(ConfigLayout, SizeVerification) {
     // Verify the total size is exactly 256 bytes
     EXPECT_EQ(sizeof(Configuration), 256UL);
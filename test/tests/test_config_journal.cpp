@@ -0,0 +1,386 @@
+#include <gtest/gtest.h>
+
+#include <cstring>
+#include <vector>
+
+#include "config_journal.h"
+
+// NOR flash emulator: erase sets a bank to 0xFF, bytes can only be programmed once
+// after that. Writes can be cut off after a number of bytes to simulate power loss.
+class FlashEmulator : public IJournalFlash
+{
+public:
+    FlashEmulator(int bankCount, size_t bankSize)
+        : m_eraseCount(bankCount, 0)
+        , m_bankSize(bankSize)
+        , m_data(bankCount, std::vector<uint8_t>(bankSize, 0xFF))
+    {
+    }
+
+    int BankCount() const override
+    {
+        return m_data.size();
+    }
+
+    size_t BankSize() const override
+    {
+        return m_bankSize;
+    }
+
+    void Read(int bank, size_t offset, uint8_t* buffer, size_t size) const override
+    {
+        EXPECT_LE(offset + size, m_bankSize);
+        memcpy(buffer, m_data[bank].data() + offset, size);
+    }
+
+    bool Erase(int bank) override
+    {
+        if (m_powerLost)
+        {
+            return true;
+        }
+
+        std::fill(m_data[bank].begin(), m_data[bank].end(), 0xFF);
+        m_eraseCount[bank]++;
+
+        return true;
+    }
+
+    bool Write(int bank, size_t offset, const uint8_t* buffer, size_t size) override
+    {
+        EXPECT_EQ(0u, offset % 4);
+        EXPECT_EQ(0u, size % 4);
+        EXPECT_LE(offset + size, m_bankSize);
+
+        for (size_t i = 0; i < size; i++)
+        {
+            if (m_powerLost)
+            {
+                break;
+            }
+
+            auto& b = m_data[bank][offset + i];
+
+            // Programming an already programmed byte is a journal bug
+            EXPECT_EQ(0xFF, b) << "bank " << bank << " offset " << offset + i;
+            b = buffer[i];
+
+            m_bytesWritten++;
+
+            if (m_bytesWritten == m_powerLossAt)
+            {
+                m_powerLost = true;
+            }
+        }
+
+        return true;
+    }
+
+    // Lose power once this many more bytes have been written
+    void CutPowerAfter(size_t bytes)
+    {
+        m_powerLossAt = m_bytesWritten + bytes;
+    }
+
+    void PowerOn()
+    {
+        m_powerLost = false;
+        m_powerLossAt = 0;
+    }
+
+    size_t m_bytesWritten = 0;
+    std::vector<int> m_eraseCount;
+
+private:
+    size_t m_bankSize;
+    std::vector<std::vector<uint8_t>> m_data;
+
+    bool m_powerLost = false;
+    size_t m_powerLossAt = 0;
+};
+
+constexpr size_t ImageSize = 256;
+
+struct Image
+{
+    uint8_t data[ImageSize];
+
+    Image(uint8_t seed)
+    {
+        for (size_t i = 0; i < ImageSize; i++)
+        {
+            data[i] = seed + i;
+        }
+    }
+
+    bool operator==(const Image& other) const
+    {
+        return memcmp(data, other.data, ImageSize) == 0;
+    }
+};
+
+static Image Reload(FlashEmulator& flash)
+{
+    ConfigJournal journal(flash, ImageSize);
+    Image loaded(0);
+
+    EXPECT_TRUE(journal.Mount());
+    EXPECT_TRUE(journal.Load(loaded.data));
+
+    return loaded;
+}
+
+TEST(ConfigJournal, EmptyFlash)
+{
+    FlashEmulator flash(2, 1024);
+    ConfigJournal journal(flash, ImageSize);
+
+    Image img(0);
+
+    EXPECT_FALSE(journal.Mount());
+    EXPECT_FALSE(journal.IsMounted());
+    EXPECT_FALSE(journal.Load(img.data));
+}
+
+TEST(ConfigJournal, SaveLoad)
+{
+    FlashEmulator flash(2, 1024);
+    ConfigJournal journal(flash, ImageSize);
+
+    Image img(10);
+
+    journal.Mount();
+    EXPECT_TRUE(journal.Save(img.data));
+    EXPECT_TRUE(journal.IsMounted());
+    EXPECT_EQ(1u, journal.GetSequence());
+
+    EXPECT_TRUE(Reload(flash) == img);
+}
+
+TEST(ConfigJournal, OtherImageSizeIgnored)
+{
+    FlashEmulator flash(2, 1024);
+
+    {
+        ConfigJournal journal(flash, ImageSize - 4);
+        Image img(10);
+        journal.Save(img.data);
+    }
+
+    ConfigJournal journal(flash, ImageSize);
+    EXPECT_FALSE(journal.Mount());
+}
+
+TEST(ConfigJournal, OnlyChangedBytesWritten)
+{
+    FlashEmulator flash(2, 1024);
+    ConfigJournal journal(flash, ImageSize);
+
+    Image img(10);
+    journal.Mount();
+    journal.Save(img.data);
+
+    // Saving the same thing again writes nothing
+    size_t before = flash.m_bytesWritten;
+    EXPECT_TRUE(journal.Save(img.data));
+    EXPECT_EQ(before, flash.m_bytesWritten);
+
+    // One byte: record header + run header + 1 byte, padded, + CRC
+    img.data[100] = 0;
+    EXPECT_TRUE(journal.Save(img.data));
+    EXPECT_EQ(before + 16, flash.m_bytesWritten);
+
+    // Bytes close together go in the same run
+    before = flash.m_bytesWritten;
+    img.data[4] = 0;
+    img.data[6] = 0;
+    EXPECT_TRUE(journal.Save(img.data));
+    EXPECT_EQ(before + 16, flash.m_bytesWritten);
+
+    // No erase besides the first one
+    EXPECT_EQ(1, flash.m_eraseCount[0] + flash.m_eraseCount[1]);
+
+    EXPECT_TRUE(Reload(flash) == img);
+}
+
+TEST(ConfigJournal, ManyRunsFallBackToFullImage)
+{
+    FlashEmulator flash(2, 1024);
+    ConfigJournal journal(flash, ImageSize);
+
+    Image img(10);
+    journal.Mount();
+    journal.Save(img.data);
+
+    for (size_t i = 0; i < ImageSize; i += 8)
+    {
+        img.data[i] ^= 0xFF;
+    }
+
+    EXPECT_TRUE(journal.Save(img.data));
+    EXPECT_TRUE(Reload(flash) == img);
+}
+
+TEST(ConfigJournal, CompactionWearLevels)
+{
+    FlashEmulator flash(2, 1024);
+    ConfigJournal journal(flash, ImageSize);
+
+    Image img(10);
+    journal.Mount();
+
+    for (int i = 0; i < 1000; i++)
+    {
+        // Typical re-index: one byte changes
+        img.data[37] = i;
+        ASSERT_TRUE(journal.Save(img.data));
+    }
+
+    EXPECT_TRUE(Reload(flash) == img);
+
+    // Each compaction erases the other bank
+    EXPECT_GT(journal.GetSequence(), 1u);
+    EXPECT_NEAR(flash.m_eraseCount[0], flash.m_eraseCount[1], 1);
+    EXPECT_EQ(journal.GetSequence(), (uint32_t)(flash.m_eraseCount[0] + flash.m_eraseCount[1]));
+
+    // A full rewrite every save would have erased once per save
+    EXPECT_LT(journal.GetSequence(), 1000u / 10);
+}
+
+TEST(ConfigJournal, PowerLossDuringRecord)
+{
+    FlashEmulator base(2, 1024);
+    Image oldImg(10);
+
+    {
+        ConfigJournal journal(base, ImageSize);
+        journal.Mount();
+        journal.Save(oldImg.data);
+    }
+
+    Image newImg = oldImg;
+    newImg.data[3] = 0;
+    newImg.data[200] = 0;
+
+    // Cut at every byte of the record
+    for (size_t cut = 1; cut < 24; cut++)
+    {
+        FlashEmulator flash = base;
+
+        {
+            ConfigJournal journal(flash, ImageSize);
+            journal.Mount();
+            flash.CutPowerAfter(cut);
+            journal.Save(newImg.data);
+        }
+
+        flash.PowerOn();
+
+        // All or nothing
+        Image loaded = Reload(flash);
+        EXPECT_TRUE(loaded == oldImg || loaded == newImg) << "cut " << cut;
+
+        // And the journal keeps working after that
+        ConfigJournal journal(flash, ImageSize);
+        journal.Mount();
+        Image next(77);
+        EXPECT_TRUE(journal.Save(next.data));
+        EXPECT_TRUE(Reload(flash) == next) << "cut " << cut;
+    }
+}
+
+TEST(ConfigJournal, PowerLossDuringCompaction)
+{
+    FlashEmulator base(2, 1024);
+    Image img(10);
+
+    // Fill the first bank until the next save has to compact
+    {
+        ConfigJournal journal(base, ImageSize);
+        journal.Mount();
+        journal.Save(img.data);
+
+        while (journal.GetFreeSpace() >= 16)
+        {
+            img.data[0]++;
+            journal.Save(img.data);
+        }
+    }
+
+    Image newImg = img;
+    newImg.data[0]++;
+
+    for (size_t cut = 1; cut < 300; cut += 7)
+    {
+        FlashEmulator flash = base;
+
+        {
+            ConfigJournal journal(flash, ImageSize);
+            journal.Mount();
+            flash.CutPowerAfter(cut);
+            journal.Save(newImg.data);
+        }
+
+        flash.PowerOn();
+
+        Image loaded = Reload(flash);
+        EXPECT_TRUE(loaded == img || loaded == newImg) << "cut " << cut;
+    }
+}
+
+TEST(ConfigJournal, TornHeaderCompactsOnNextSave)
+{
+    FlashEmulator flash(2, 1024);
+    Image img(10);
+
+    {
+        ConfigJournal journal(flash, ImageSize);
+        journal.Mount();
+        journal.Save(img.data);
+
+        // Only the size gets programmed, not its inverted copy
+        img.data[5] = 0;
+        flash.CutPowerAfter(2);
+        journal.Save(img.data);
+    }
+
+    flash.PowerOn();
+
+    ConfigJournal journal(flash, ImageSize);
+    EXPECT_TRUE(journal.Mount());
+    EXPECT_EQ(0u, journal.GetFreeSpace());
+
+    Image loaded = Reload(flash);
+    EXPECT_EQ(15, loaded.data[5]);
+
+    EXPECT_TRUE(journal.Save(img.data));
+    EXPECT_EQ(2u, journal.GetSequence());
+    EXPECT_TRUE(Reload(flash) == img);
+}
+
+TEST(ConfigJournal, SingleBank)
+{
+    FlashEmulator flash(1, 1024);
+    ConfigJournal journal(flash, ImageSize);
+
+    Image img(10);
+    journal.Mount();
+
+    for (int i = 0; i < 100; i++)
+    {
+        img.data[i] = 0;
+        ASSERT_TRUE(journal.Save(img.data));
+    }
+
+    EXPECT_GT(journal.GetSequence(), 1u);
+    EXPECT_TRUE(Reload(flash) == img);
+}
+
+TEST(ConfigJournal, ImageTooBigForBank)
+{
+    FlashEmulator flash(2, 128);
+    ConfigJournal journal(flash, ImageSize);
+
+    Image img(10);
+    EXPECT_FALSE(journal.Save(img.data));
+}
@@ -0,0 +1,171 @@
+#include <gtest/gtest.h>
+
+#include <cstring>
+#include "port.h"
+
+// Builds configuration images the way older firmware left them in flash
+struct StoredBlob
+{
+    uint8_t bytes[256];
+
+    StoredBlob(uint32_t tag, size_t size)
+    {
+        // Past the layout's size flash was left erased
+        memset(bytes, 0xFF, sizeof(bytes));
+        memset(bytes, 0, size);
+        Write(0, tag);
+    }
+
+    template<typename T>
+    void Write(size_t offset, T value)
+    {
+        memcpy(bytes + offset, &value, sizeof(T));
+    }
+
+    Configuration Load() const
+    {
+        Configuration cfg;
+        memcpy(&cfg, bytes, sizeof(cfg));
+        return cfg;
+    }
+};
+
+TEST(ConfigMigration, CurrentIsUnchanged)
+{
+    Configuration cfg;
+    cfg.LoadDefaults();
+    cfg.afr[0].RusEfiIdx = 5;
+    cfg.heaterConfig.PreheatTimeSec = 20;
+
+    Configuration before = cfg;
+
+    EXPECT_TRUE(cfg.IsValid());
+    EXPECT_EQ(Configuration::Version, cfg.GetVersion());
+    EXPECT_TRUE(MigrateConfiguration(cfg));
+    EXPECT_EQ(0, memcmp(&before, &cfg, sizeof(cfg)));
+}
+
+TEST(ConfigMigration, NotAConfiguration)
+{
+    // Erased flash
+    StoredBlob erased(0xFFFFFFFF, 0);
+    Configuration cfg = erased.Load();
+    EXPECT_EQ(0, cfg.GetVersion());
+    EXPECT_FALSE(MigrateConfiguration(cfg));
+
+    StoredBlob other(0x12345601, 256);
+    cfg = other.Load();
+    EXPECT_FALSE(MigrateConfiguration(cfg));
+}
+
+TEST(ConfigMigration, NewerVersionRejected)
+{
+    StoredBlob blob(0xDEADBE00 | (Configuration::Version + 1), 256);
+    Configuration cfg = blob.Load();
+
+    EXPECT_FALSE(MigrateConfiguration(cfg));
+}
+
+TEST(ConfigMigration, FromV1)
+{
+    // 128 bytes, only the CAN index offset
+    StoredBlob blob(0xDEADBE01, 128);
+    blob.Write<uint8_t>(4, 3);
+
+    Configuration cfg = blob.Load();
+    EXPECT_EQ(1, cfg.GetVersion());
+    ASSERT_TRUE(MigrateConfiguration(cfg));
+    EXPECT_TRUE(cfg.IsValid());
+
+    // Index carried over, the rest is defaults
+    EXPECT_EQ(3, cfg.afr[0].RusEfiIdx);
+    EXPECT_TRUE(cfg.afr[0].RusEfiTx);
+    EXPECT_EQ(0, cfg.NoLongerUsed0);
+
+    Configuration defaults;
+    defaults.LoadDefaults();
+    EXPECT_EQ(0, memcmp(defaults.auxOutBins, cfg.auxOutBins, sizeof(cfg.auxOutBins)));
+    EXPECT_EQ(0, memcmp(defaults.auxOutValues, cfg.auxOutValues, sizeof(cfg.auxOutValues)));
+    EXPECT_EQ(defaults.sensorType, cfg.sensorType);
+    EXPECT_FLOAT_EQ(HEATER_SUPPLY_OFF_VOLTAGE, cfg.heaterConfig.HeaterSupplyOffVoltage);
+    EXPECT_FLOAT_EQ(HEATER_SUPPLY_ON_VOLTAGE, cfg.heaterConfig.HeaterSupplyOnVoltage);
+    EXPECT_FLOAT_EQ(HEATER_PREHEAT_TIME, cfg.heaterConfig.PreheatTimeSec);
+}
+
+TEST(ConfigMigration, FromV2)
+{
+    // Everything up to the EGT settings, no heater config yet
+    StoredBlob blob(0xDEADBE02, 168);
+
+    for (int i = 0; i < 8; i++)
+    {
+        blob.Write<float>(5 + 4 * i, 10.0f + i);            // auxOutBins[0]
+        blob.Write<float>(5 + 32 + 4 * i, 20.0f + i);       // auxOutBins[1]
+        blob.Write<float>(69 + 4 * i, 0.5f * i);            // auxOutValues[0]
+        blob.Write<float>(69 + 32 + 4 * i, 0.25f * i);      // auxOutValues[1]
+    }
+    blob.Write<uint8_t>(133, static_cast<uint8_t>(AuxOutputMode::Lambda0));
+    blob.Write<uint8_t>(134, static_cast<uint8_t>(AuxOutputMode::Egt1));
+    blob.Write<uint8_t>(135, static_cast<uint8_t>(SensorType::LSU42));
+    blob.Write<uint8_t>(136, 0b101);    // RusEfiTx, AemNetTx
+    blob.Write<uint8_t>(137, 7);        // RusEfiIdx
+    blob.Write<uint8_t>(138, 2);        // AemNetIdOffset
+
+    Configuration cfg = blob.Load();
+    EXPECT_EQ(2, cfg.GetVersion());
+    ASSERT_TRUE(MigrateConfiguration(cfg));
+    EXPECT_TRUE(cfg.IsValid());
+
+    // Calibration kept
+    for (int i = 0; i < 8; i++)
+    {
+        EXPECT_FLOAT_EQ(10.0f + i, cfg.auxOutBins[0][i]);
+        EXPECT_FLOAT_EQ(20.0f + i, cfg.auxOutBins[1][i]);
+        EXPECT_FLOAT_EQ(0.5f * i, cfg.auxOutValues[0][i]);
+        EXPECT_FLOAT_EQ(0.25f * i, cfg.auxOutValues[1][i]);
+    }
+    EXPECT_EQ(AuxOutputMode::Lambda0, cfg.auxOutputSource[0]);
+    EXPECT_EQ(AuxOutputMode::Egt1, cfg.auxOutputSource[1]);
+    EXPECT_EQ(SensorType::LSU42, cfg.sensorType);
+    EXPECT_TRUE(cfg.afr[0].RusEfiTx);
+    EXPECT_FALSE(cfg.afr[0].RusEfiTxDiag);
+    EXPECT_TRUE(cfg.afr[0].AemNetTx);
+    EXPECT_EQ(7, cfg.afr[0].RusEfiIdx);
+    EXPECT_EQ(2, cfg.afr[0].AemNetIdOffset);
+
+    // New heater settings get defaults, not the erased flash behind the old layout
+    EXPECT_FLOAT_EQ(HEATER_SUPPLY_OFF_VOLTAGE, cfg.heaterConfig.HeaterSupplyOffVoltage);
+    EXPECT_FLOAT_EQ(HEATER_SUPPLY_ON_VOLTAGE, cfg.heaterConfig.HeaterSupplyOnVoltage);
+    EXPECT_FLOAT_EQ(HEATER_PREHEAT_TIME, cfg.heaterConfig.PreheatTimeSec);
+}
+
+TEST(ConfigMigration, FromV3)
+{
+    // Everything up to the heater settings
+    StoredBlob blob(0xDEADBE03, 176);
+    blob.Write<uint8_t>(137, 4);        // afr[0].RusEfiIdx
+    blob.Write<uint8_t>(170, 20);       // PreheatTimeSec
+
+    Configuration cfg = blob.Load();
+    EXPECT_EQ(3, cfg.GetVersion());
+    ASSERT_TRUE(MigrateConfiguration(cfg));
+    EXPECT_TRUE(cfg.IsValid());
+
+    EXPECT_EQ(4, cfg.afr[0].RusEfiIdx);
+    EXPECT_FLOAT_EQ(100, cfg.heaterConfig.PreheatTimeSec);
+
+    // Outputs stay unfiltered
+    for (int i = 0; i < LAMBDA_OUTPUT_COUNT; i++)
+    {
+        EXPECT_EQ(LambdaFilterType::Bypass, cfg.lambdaFilter[i].Type);
+        EXPECT_EQ(LAMBDA_FILTER_DEFAULT_MEDIAN, cfg.lambdaFilter[i].MedianLength);
+        EXPECT_FLOAT_EQ(LAMBDA_FILTER_DEFAULT_CUTOFF_HZ, cfg.lambdaFilter[i].CutoffHz);
+    }
+
+    // Erased flash behind the v3 layout doesn't survive in to the spare bytes
+    auto raw = reinterpret_cast<const uint8_t*>(&cfg);
+    for (size_t i = 176 + sizeof(cfg.lambdaFilter); i < sizeof(cfg); i++)
+    {
+        EXPECT_EQ(0, raw[i]) << i;
+    }
+}
@@ -0,0 +1,126 @@
+#include <gtest/gtest.h>
+
+#include "cycle_profiler.h"
+
+// Stands in for the DWT cycle counter
+struct MockCounter
+{
+    uint32_t Now = 0;
+
+    uint32_t Advance(uint32_t cycles)
+    {
+        Now += cycles;
+        return Now;
+    }
+};
+
+static uint32_t GetU32(const uint8_t* p)
+{
+    return p[0] | p[1] << 8 | p[2] << 16 | (uint32_t)p[3] << 24;
+}
+
+TEST(CycleProfiler, StagesAndTotal)
+{
+    CycleProfiler p(3);
+    MockCounter c;
+
+    for (uint32_t pass = 0; pass < 4; pass++)
+    {
+        p.Begin(c.Now);
+        p.Mark(0, c.Advance(100));
+        p.Mark(1, c.Advance(1000 + pass * 100));
+        p.Mark(2, c.Advance(10));
+        p.End();
+
+        // Time between passes isn't charged to anything
+        c.Advance(5000);
+    }
+
+    EXPECT_EQ(4u, p.GetStage(0).Count);
+    EXPECT_EQ(100u, p.GetStage(0).Min);
+    EXPECT_EQ(100u, p.GetStage(0).Max);
+
+    EXPECT_EQ(1000u, p.GetStage(1).Min);
+    EXPECT_EQ(1300u, p.GetStage(1).Max);
+    EXPECT_EQ(4600u, p.GetStage(1).Sum);
+
+    EXPECT_EQ(1110u, p.GetStage(3).Min);
+    EXPECT_EQ(1410u, p.GetStage(3).Max);
+}
+
+TEST(CycleProfiler, Histogram)
+{
+    CycleProfiler p(1);
+    MockCounter c;
+
+    // Below the first bucket, then one in each of the next two
+    for (uint32_t cycles : { 10u, 63u, 64u, 127u, 128u })
+    {
+        p.Begin(c.Now);
+        p.Mark(0, c.Advance(cycles));
+        p.End();
+    }
+
+    // Far past the last bucket, and across a counter wrap
+    c.Now = 0xFFFFFF00;
+    p.Begin(c.Now);
+    p.Mark(0, c.Advance(0x10000000));
+    p.End();
+
+    const auto& h = p.GetStage(0).Histogram;
+    EXPECT_EQ(2, h[0]);
+    EXPECT_EQ(2, h[1]);
+    EXPECT_EQ(1, h[2]);
+    EXPECT_EQ(1, h[PROFILER_HISTOGRAM_BUCKETS - 1]);
+    EXPECT_EQ(0x10000000u, p.GetStage(0).Max);
+}
+
+TEST(CycleProfiler, ReportAndReset)
+{
+    CycleProfiler p(2);
+    MockCounter c;
+
+    p.Begin(c.Now);
+    p.Mark(0, c.Advance(200));
+    p.Mark(1, c.Advance(300));
+    p.End();
+
+    p.Begin(c.Now);
+    p.Mark(0, c.Advance(400));
+    p.Mark(1, c.Advance(300));
+    p.End();
+
+    uint8_t buffer[256];
+    size_t length = p.Report(buffer, sizeof(buffer));
+
+    ASSERT_EQ(4u + 3 * PROFILER_STAGE_REPORT_SIZE, length);
+    EXPECT_EQ(3, buffer[0]);
+    EXPECT_EQ(PROFILER_HISTOGRAM_BUCKETS, buffer[1]);
+    EXPECT_EQ(PROFILER_HISTOGRAM_SHIFT, buffer[2]);
+
+    const uint8_t* stage0 = buffer + 4;
+    EXPECT_EQ(200u, GetU32(stage0));
+    EXPECT_EQ(300u, GetU32(stage0 + 4));
+    EXPECT_EQ(400u, GetU32(stage0 + 8));
+    EXPECT_EQ(2u, GetU32(stage0 + 12));
+
+    const uint8_t* total = buffer + 4 + 2 * PROFILER_STAGE_REPORT_SIZE;
+    EXPECT_EQ(500u, GetU32(total));
+    EXPECT_EQ(600u, GetU32(total + 4));
+    EXPECT_EQ(700u, GetU32(total + 8));
+
+    // Too small
+    EXPECT_EQ(0u, p.Report(buffer, length - 1));
+
+    // Reset lands on the next pass
+    p.RequestReset();
+    EXPECT_EQ(2u, p.GetStage(0).Count);
+
+    p.Begin(c.Now);
+    p.Mark(0, c.Advance(50));
+    p.End();
+
+    EXPECT_EQ(1u, p.GetStage(0).Count);
+    EXPECT_EQ(50u, p.GetStage(0).Max);
+    EXPECT_EQ(0u, p.GetStage(1).Count);
+}
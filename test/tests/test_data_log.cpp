@@ -0,0 +1,174 @@
+#include <gtest/gtest.h>
+
+#include <vector>
+
+#include <rusefi/crc.h>
+
+#include "data_log.h"
+
+struct VectorSink : public IDataLogSink
+{
+    void Write(const uint8_t* buffer, size_t size) override
+    {
+        Data.insert(Data.end(), buffer, buffer + size);
+    }
+
+    std::vector<uint8_t> Data;
+};
+
+// Reference decoder for the format documented in data_log.h
+struct DecodedBlock
+{
+    uint8_t Version;
+    uint16_t IntervalMs;
+    uint32_t FirstRecord;
+    std::vector<uint8_t> Types;
+    // [record][column]
+    std::vector<std::vector<int>> Values;
+};
+
+static uint32_t ReadVarint(const std::vector<uint8_t>& d, size_t& pos)
+{
+    uint32_t value = 0;
+    int shift = 0;
+
+    while (true)
+    {
+        uint8_t b = d.at(pos++);
+        value |= (b & 0x7F) << shift;
+        shift += 7;
+
+        if (!(b & 0x80))
+        {
+            return value;
+        }
+    }
+}
+
+static int ReadSigned(const std::vector<uint8_t>& d, size_t& pos)
+{
+    uint32_t v = ReadVarint(d, pos);
+    return (v >> 1) ^ -(int)(v & 1);
+}
+
+static DecodedBlock Decode(const std::vector<uint8_t>& d, size_t& pos)
+{
+    size_t start = pos;
+    DecodedBlock b;
+
+    EXPECT_EQ('W', d.at(pos));
+    EXPECT_EQ('L', d.at(pos + 1));
+    b.Version = d.at(pos + 2);
+    size_t columns = d.at(pos + 3);
+    size_t records = d.at(pos + 4);
+    b.IntervalMs = d.at(pos + 6) | d.at(pos + 7) << 8;
+    b.FirstRecord = d.at(pos + 8) | d.at(pos + 9) << 8 | d.at(pos + 10) << 16 | d.at(pos + 11) << 24;
+    pos += 12;
+
+    b.Types.assign(d.begin() + pos, d.begin() + pos + columns);
+    pos += columns;
+
+    b.Values.assign(records, std::vector<int>(columns));
+    for (size_t c = 0; c < columns; c++)
+    {
+        b.Values[0][c] = ReadSigned(d, pos);
+
+        size_t r = 1;
+        while (r < records)
+        {
+            int delta = ReadSigned(d, pos);
+            b.Values[r][c] = b.Values[r - 1][c] + delta;
+            r++;
+
+            if (delta == 0)
+            {
+                for (uint32_t run = ReadVarint(d, pos); run; run--, r++)
+                {
+                    b.Values.at(r)[c] = b.Values[r - 1][c];
+                }
+            }
+        }
+    }
+
+    uint32_t crc = d.at(pos) | d.at(pos + 1) << 8 | d.at(pos + 2) << 16 | (uint32_t)d.at(pos + 3) << 24;
+    EXPECT_EQ(crc32(d.data() + start, pos - start), crc);
+    pos += 4;
+
+    return b;
+}
+
+static const uint8_t types[] = { 0x01, 0x02, 0x03, 0x04, 0x11 };
+
+TEST(DataLog, RoundTrip)
+{
+    DataLogEncoder e(types, sizeof(types), 100);
+    VectorSink sink;
+
+    std::vector<std::vector<int>> expected;
+
+    for (int i = 0; i < DATALOG_BLOCK_RECORDS; i++)
+    {
+        // Noisy lambda, slowly rising temperature, a fault half way, a big jump
+        int16_t values[] = { (int16_t)(1000 + (i % 3) - 1), (int16_t)(780 + i / 8), (int16_t)(i >= 16 ? 4 : 0), 2, (int16_t)(i == 5 ? -32768 : 32767) };
+        expected.emplace_back(values, values + 5);
+
+        EXPECT_EQ(i == DATALOG_BLOCK_RECORDS - 1, e.Add(values));
+    }
+
+    e.Flush(sink);
+
+    size_t pos = 0;
+    auto b = Decode(sink.Data, pos);
+    EXPECT_EQ(sink.Data.size(), pos);
+
+    EXPECT_EQ(DATALOG_VERSION, b.Version);
+    EXPECT_EQ(100, b.IntervalMs);
+    EXPECT_EQ(0u, b.FirstRecord);
+    EXPECT_EQ(std::vector<uint8_t>(types, types + 5), b.Types);
+    EXPECT_EQ(expected, b.Values);
+}
+
+TEST(DataLog, SteadyColumnsAreSmall)
+{
+    DataLogEncoder e(types, sizeof(types), 100);
+    VectorSink sink;
+
+    int16_t values[] = { 1000, 780, 0, 2, 25 };
+    for (int i = 0; i < DATALOG_BLOCK_RECORDS; i++)
+    {
+        e.Add(values);
+    }
+    e.Flush(sink);
+
+    // Header, types, ~4 bytes per column, CRC
+    EXPECT_LE(sink.Data.size(), 12u + 5 + 5 * 4 + 4);
+}
+
+TEST(DataLog, BlocksFollowOn)
+{
+    DataLogEncoder e(types, 2, 50);
+    VectorSink sink;
+
+    int16_t values[] = { 1, 2 };
+    for (int i = 0; i < DATALOG_BLOCK_RECORDS + 3; i++)
+    {
+        if (e.Add(values))
+        {
+            e.Flush(sink);
+        }
+    }
+
+    // Partial block on demand, nothing more once empty
+    e.Flush(sink);
+    e.Flush(sink);
+
+    size_t pos = 0;
+    auto first = Decode(sink.Data, pos);
+    auto second = Decode(sink.Data, pos);
+    EXPECT_EQ(sink.Data.size(), pos);
+
+    EXPECT_EQ((size_t)DATALOG_BLOCK_RECORDS, first.Values.size());
+    EXPECT_EQ(3u, second.Values.size());
+    EXPECT_EQ((uint32_t)DATALOG_BLOCK_RECORDS, second.FirstRecord);
+    EXPECT_EQ(2u, second.Types.size());
+}
@@ -0,0 +1,135 @@
+#include <gtest/gtest.h>
+
+#include <cmath>
+
+#include "esr_demodulator.h"
+
+// Nernst voltage with the ESR square wave on top, n samples per half-period
+struct NernstSignal
+{
+    uint32_t SamplesPerHalfPeriod;
+    float Amplitude;
+    float Dc = 0.45f;
+    // Volts per sample
+    float Slope = 0;
+    // Sine interference, amplitude and cycles per sample
+    float Noise = 0;
+    float NoiseFrequency = 0;
+
+    uint32_t Sample = 0;
+
+    float Next()
+    {
+        bool high = (Sample / SamplesPerHalfPeriod) % 2;
+        float v = Dc + Slope * Sample + (high ? Amplitude / 2 : -Amplitude / 2);
+        v += Noise * sinf(2 * 3.14159265f * NoiseFrequency * Sample);
+        Sample++;
+        return v;
+    }
+};
+
+TEST(EsrDemodulator, Amplitude)
+{
+    EsrDemodulator dut(4, 2, 5, 2500);
+    NernstSignal signal { 4, 0.2f };
+
+    // 2 * 2 + 1 half-periods for the first window, then 4 more for each
+    int outputs = 0;
+    for (int i = 0; i < 20 * 4 + 4 * 4; i++)
+    {
+        if (dut.Add(signal.Next()))
+        {
+            outputs++;
+        }
+    }
+
+    EXPECT_EQ(5, outputs);
+    EXPECT_NEAR(0.2f, dut.GetAc(), 1e-5);
+    EXPECT_NEAR(0.45f, dut.GetDc(), 1e-5);
+}
+
+TEST(EsrDemodulator, SlopeRejected)
+{
+    EsrDemodulator dut(3, 4, 5, 2500);
+
+    // Nernst drifting 0.5V over the run, much faster than in real life
+    NernstSignal signal { 3, 0.1f, 0.2f, 0.5f / 3000 };
+
+    for (int i = 0; i < 3000; i++)
+    {
+        dut.Add(signal.Next());
+    }
+
+    EXPECT_NEAR(0.1f, dut.GetAc(), 1e-4);
+
+    // The DC estimate lags by a half-period
+    EXPECT_NEAR(0.2f + 0.5f / 3000 * (3000 - 3 - 1.5f), dut.GetDc(), 1e-4);
+}
+
+TEST(EsrDemodulator, NoiseRejected)
+{
+    EsrDemodulator dut(2, 8, 5, 2500);
+
+    // Heater PWM ripple aliased to ~390Hz, half the ESR amplitude
+    NernstSignal signal { 2, 0.2f };
+    signal.Noise = 0.1f;
+    signal.NoiseFrequency = 390.0f / 2500;
+
+    for (int i = 0; i < 5000; i++)
+    {
+        dut.Add(signal.Next());
+    }
+
+    EXPECT_NEAR(0.2f, dut.GetAc(), 0.005);
+}
+
+TEST(EsrDemodulator, Bandwidth)
+{
+    // 5Hz is a time constant of ~32ms or 80 samples
+    EsrDemodulator dut(1, 2, 5, 2500);
+    NernstSignal signal { 1, 0.1f };
+
+    for (int i = 0; i < 2500; i++)
+    {
+        dut.Add(signal.Next());
+    }
+
+    EXPECT_NEAR(0.1f, dut.GetAc(), 1e-4);
+
+    // Step up, the sensor heated up a little
+    signal.Amplitude = 0.2f;
+
+    for (int i = 0; i < 80; i++)
+    {
+        dut.Add(signal.Next());
+    }
+
+    // 1 - 1/e of the way there, give or take a window
+    EXPECT_NEAR(0.1f + 0.1f * 0.63f, dut.GetAc(), 0.01);
+
+    for (int i = 0; i < 5 * 80; i++)
+    {
+        dut.Add(signal.Next());
+    }
+
+    EXPECT_NEAR(0.2f, dut.GetAc(), 0.002);
+}
+
+TEST(EsrDemodulator, WarmupAverages)
+{
+    EsrDemodulator dut(1, 4, 5, 2500);
+    NernstSignal signal { 1, 0.2f };
+
+    EXPECT_EQ(0u, dut.GetOutputCount());
+
+    // First window is 9 half-periods
+    for (int i = 0; i < 9; i++)
+    {
+        dut.Add(signal.Next());
+    }
+
+    EXPECT_EQ(1u, dut.GetOutputCount());
+
+    // Right from the first output, no decay up from zero
+    EXPECT_NEAR(0.2f, dut.GetAc(), 1e-5);
+}
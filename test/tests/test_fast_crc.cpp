@@ -0,0 +1,58 @@
+#include <gtest/gtest.h>
+
+#include <vector>
+
+#include <rusefi/crc.h>
+
+#include "util/fast_crc.h"
+
+static std::vector<uint8_t> TestData(size_t size)
+{
+    std::vector<uint8_t> data(size);
+
+    uint32_t x = 12345;
+    for (auto& b : data)
+    {
+        x = x * 1103515245 + 12345;
+        b = x >> 16;
+    }
+
+    return data;
+}
+
+TEST(FastCrc, KnownValue)
+{
+    const char* check = "123456789";
+    EXPECT_EQ(0xCBF43926u, FastCrc32(check, 9));
+    EXPECT_EQ(0u, FastCrc32(check, 0));
+}
+
+TEST(FastCrc, MatchesLibfirmware)
+{
+    auto data = TestData(600);
+
+    // Every length and alignment the TS framing can produce
+    for (size_t offset = 0; offset < 8; offset++)
+    {
+        for (size_t size = 0; size + offset <= 300; size++)
+        {
+            ASSERT_EQ(crc32(data.data() + offset, size), FastCrc32(data.data() + offset, size))
+                << "offset " << offset << " size " << size;
+        }
+    }
+}
+
+TEST(FastCrc, IncrementalMatchesLibfirmware)
+{
+    auto data = TestData(300);
+
+    // Split the way writeHeader/writeBody do: response code first, then the body in pieces
+    for (size_t split = 0; split <= data.size(); split += 7)
+    {
+        uint32_t expected = crc32inc(data.data() + split, crc32(data.data(), split), data.size() - split);
+        uint32_t actual = FastCrc32Inc(data.data() + split, FastCrc32(data.data(), split), data.size() - split);
+
+        ASSERT_EQ(expected, actual) << "split " << split;
+        ASSERT_EQ(crc32(data.data(), data.size()), actual);
+    }
+}
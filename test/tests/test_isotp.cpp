@@ -0,0 +1,230 @@
+#include <gtest/gtest.h>
+
+#include <cstring>
+#include <deque>
+#include <vector>
+
+#include "isotp.h"
+
+// One end of a frame loopback. Receive on an empty queue lets the peer run
+// once, the way the other node would meanwhile on a real bus.
+class LoopbackLink : public IIsoTpLink
+{
+public:
+    bool Transmit(const IsoTpFrame& frame) override
+    {
+        Peer->Queue.push_back(frame);
+        Sent.push_back(frame);
+        return true;
+    }
+
+    bool Receive(IsoTpFrame& frame, int) override
+    {
+        if (Queue.empty() && PeerNode && !s_running)
+        {
+            s_running = true;
+            PeerNode->Poll();
+            s_running = false;
+        }
+
+        if (Queue.empty())
+        {
+            return false;
+        }
+
+        frame = Queue.front();
+        Queue.pop_front();
+        return true;
+    }
+
+    void DelayUs(uint32_t us) override
+    {
+        Delays.push_back(us);
+    }
+
+    LoopbackLink* Peer = nullptr;
+    IsoTp* PeerNode = nullptr;
+
+    std::deque<IsoTpFrame> Queue;
+    std::vector<IsoTpFrame> Sent;
+    std::vector<uint32_t> Delays;
+
+private:
+    static bool s_running;
+};
+
+bool LoopbackLink::s_running = false;
+
+struct Loopback
+{
+    Loopback()
+    {
+        deviceLink.Peer = &hostLink;
+        hostLink.Peer = &deviceLink;
+        deviceLink.PeerNode = &host;
+        hostLink.PeerNode = &device;
+    }
+
+    LoopbackLink deviceLink;
+    LoopbackLink hostLink;
+    IsoTp device{deviceLink};
+    IsoTp host{hostLink};
+};
+
+static std::vector<uint8_t> Pattern(size_t size)
+{
+    std::vector<uint8_t> data(size);
+    for (size_t i = 0; i < size; i++)
+    {
+        data[i] = i * 7 + 3;
+    }
+    return data;
+}
+
+static IsoTpFrame Frame(std::initializer_list<uint8_t> bytes)
+{
+    IsoTpFrame f = {};
+    f.Length = bytes.size();
+    size_t i = 0;
+    for (auto b : bytes)
+    {
+        f.Data[i++] = b;
+    }
+    return f;
+}
+
+TEST(IsoTp, SingleFrame)
+{
+    Loopback l;
+    auto data = Pattern(5);
+
+    ASSERT_TRUE(l.host.Send(data.data(), data.size(), 0));
+    ASSERT_EQ(1u, l.hostLink.Sent.size());
+    EXPECT_EQ(0x05, l.hostLink.Sent[0].Data[0]);
+    EXPECT_EQ(8, l.hostLink.Sent[0].Length);
+
+    uint8_t buffer[16];
+    ASSERT_EQ(5u, l.device.Receive(buffer, sizeof(buffer), 0));
+    EXPECT_EQ(0, memcmp(buffer, data.data(), 5));
+}
+
+TEST(IsoTp, MultiFrameBothWays)
+{
+    Loopback l;
+
+    // Up to the largest TS request, in blocks of 4 from the host for the replies
+    l.host.SetFlowControl(4, 0);
+
+    for (size_t size : { 8, 13, 263, ISOTP_RX_BUFFER_SIZE })
+    {
+        auto data = Pattern(size);
+        std::vector<uint8_t> received(size);
+
+        ASSERT_TRUE(l.host.Send(data.data(), size, 0)) << size;
+        ASSERT_EQ(size, l.device.Receive(received.data(), size, 0)) << size;
+        EXPECT_EQ(data, received);
+
+        // Host side reads in pieces, like TS would
+        ASSERT_TRUE(l.device.Send(data.data(), size, 0)) << size;
+
+        size_t done = 0;
+        while (done < size)
+        {
+            size_t n = l.host.Receive(received.data() + done, std::min<size_t>(100, size - done), 0);
+            ASSERT_GT(n, 0u);
+            done += n;
+        }
+        EXPECT_EQ(data, received);
+    }
+
+    EXPECT_EQ(0u, l.device.GetErrorCount());
+    EXPECT_EQ(0u, l.host.GetErrorCount());
+}
+
+TEST(IsoTp, DeviceGrantsBlocks)
+{
+    Loopback l;
+    auto data = Pattern(200);
+
+    ASSERT_TRUE(l.host.Send(data.data(), data.size(), 0));
+
+    // First frame + 28 consecutive, a flow control after the FF and every ISOTP_BLOCK_SIZE frames
+    EXPECT_EQ(29u, l.hostLink.Sent.size());
+    EXPECT_EQ(1u + (28 - 1) / ISOTP_BLOCK_SIZE, l.deviceLink.Sent.size());
+    for (auto& fc : l.deviceLink.Sent)
+    {
+        EXPECT_EQ(ISOTP_PCI_FLOW_CONTROL | ISOTP_FC_CONTINUE, fc.Data[0]);
+        EXPECT_EQ(ISOTP_BLOCK_SIZE, fc.Data[1]);
+    }
+
+    std::vector<uint8_t> received(data.size());
+    ASSERT_EQ(data.size(), l.device.Receive(received.data(), received.size(), 0));
+    EXPECT_EQ(data, received);
+}
+
+TEST(IsoTp, SeparationTimeHonored)
+{
+    Loopback l;
+    auto data = Pattern(6 + 7 * 3);
+
+    l.host.SetFlowControl(0, 0xF5);
+    ASSERT_TRUE(l.device.Send(data.data(), data.size(), 0));
+    EXPECT_EQ((std::vector<uint32_t>{ 500, 500 }), l.deviceLink.Delays);
+
+    l.deviceLink.Delays.clear();
+    l.host.SetFlowControl(0, 2);
+    ASSERT_TRUE(l.device.Send(data.data(), data.size(), 0));
+    EXPECT_EQ((std::vector<uint32_t>{ 2000, 2000 }), l.deviceLink.Delays);
+}
+
+TEST(IsoTp, OverflowRefused)
+{
+    Loopback l;
+    auto data = Pattern(ISOTP_RX_BUFFER_SIZE + 1);
+
+    EXPECT_FALSE(l.host.Send(data.data(), data.size(), 0));
+    ASSERT_EQ(1u, l.deviceLink.Sent.size());
+    EXPECT_EQ(ISOTP_PCI_FLOW_CONTROL | ISOTP_FC_OVERFLOW, l.deviceLink.Sent[0].Data[0]);
+
+    uint8_t buffer[8];
+    EXPECT_EQ(0u, l.device.Receive(buffer, sizeof(buffer), 0));
+}
+
+TEST(IsoTp, WaitThenContinue)
+{
+    LoopbackLink link;
+    LoopbackLink peer;
+    link.Peer = &peer;
+    peer.Peer = &link;
+    IsoTp node(link);
+
+    auto data = Pattern(20);
+    link.Queue.push_back(Frame({ 0x31, 0, 0 }));
+    link.Queue.push_back(Frame({ 0x30, 0, 0 }));
+
+    ASSERT_TRUE(node.Send(data.data(), data.size(), 0));
+    EXPECT_EQ(3u, peer.Queue.size());
+
+    // Peer never answers
+    EXPECT_FALSE(node.Send(data.data(), data.size(), 0));
+}
+
+TEST(IsoTp, LostFrameDropsMessage)
+{
+    LoopbackLink link;
+    LoopbackLink peer;
+    link.Peer = &peer;
+    peer.Peer = &link;
+    IsoTp node(link);
+
+    link.Queue.push_back(Frame({ 0x10, 20, 1, 2, 3, 4, 5, 6 }));
+    link.Queue.push_back(Frame({ 0x21, 7, 8, 9, 10, 11, 12, 13 }));
+    // Sequence 2 is missing
+    link.Queue.push_back(Frame({ 0x23, 14, 15, 16, 17, 18, 19, 20 }));
+    link.Queue.push_back(Frame({ 0x03, 0xA, 0xB, 0xC }));
+
+    uint8_t buffer[32];
+    ASSERT_EQ(3u, node.Receive(buffer, sizeof(buffer), 0));
+    EXPECT_EQ(0xA, buffer[0]);
+    EXPECT_EQ(1u, node.GetErrorCount());
+}
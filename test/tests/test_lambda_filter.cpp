@@ -0,0 +1,210 @@
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <cmath>
+#include <utility>
+
+#include "lambda_filter.h"
+
+static LambdaFilterConfig MakeConfig(LambdaFilterType type, uint8_t medianLength = 5, float cutoffHz = 5)
+{
+    LambdaFilterConfig config = {};
+    config.Type = type;
+    config.MedianLength = medianLength;
+    config.CutoffHz = cutoffHz;
+    return config;
+}
+
+// After settling on a ramp an LTI filter lags it by exactly its group delay at DC
+static float MeasureRampLagMs(LambdaFilter& f)
+{
+    const float slope = 0.001f;
+    float out = 0;
+    int n;
+
+    for (n = 0; n < 2000; n++)
+    {
+        out = f.Update(0.8f + slope * n);
+    }
+
+    float input = 0.8f + slope * (n - 1);
+    return (input - out) / slope * 1000 / LAMBDA_FILTER_RATE_HZ;
+}
+
+TEST(LambdaFilter, BypassByDefault)
+{
+    LambdaFilter f;
+
+    EXPECT_EQ(LambdaFilterType::Bypass, f.GetType());
+    EXPECT_FLOAT_EQ(0.9f, f.Update(0.9f));
+    EXPECT_FLOAT_EQ(1.3f, f.Update(1.3f));
+    EXPECT_FLOAT_EQ(0, f.GetGroupDelayMs());
+}
+
+TEST(LambdaFilter, InvalidSettingsBypass)
+{
+    LambdaFilter f;
+
+    // No cutoff
+    f.Configure(MakeConfig(LambdaFilterType::Ema, 5, 0));
+    EXPECT_EQ(LambdaFilterType::Bypass, f.GetType());
+
+    // Past Nyquist
+    f.Configure(MakeConfig(LambdaFilterType::Butterworth, 5, 25.5f), 40);
+    EXPECT_EQ(LambdaFilterType::Bypass, f.GetType());
+
+    // Window of one
+    f.Configure(MakeConfig(LambdaFilterType::Median, 1));
+    EXPECT_EQ(LambdaFilterType::Bypass, f.GetType());
+
+    // Unknown type
+    f.Configure(MakeConfig(static_cast<LambdaFilterType>(7)));
+    EXPECT_EQ(LambdaFilterType::Bypass, f.GetType());
+    EXPECT_FLOAT_EQ(1.1f, f.Update(1.1f));
+}
+
+TEST(LambdaFilter, StartsSettled)
+{
+    for (auto type : { LambdaFilterType::Ema, LambdaFilterType::Median, LambdaFilterType::Butterworth, LambdaFilterType::Kalman })
+    {
+        LambdaFilter f;
+        f.Configure(MakeConfig(type));
+
+        for (int i = 0; i < 10; i++)
+        {
+            EXPECT_NEAR(1.05f, f.Update(1.05f), 1e-5) << static_cast<int>(type);
+        }
+    }
+}
+
+TEST(LambdaFilter, Ema)
+{
+    LambdaFilter f;
+    f.Configure(MakeConfig(LambdaFilterType::Ema, 5, 1.6f));
+
+    // Time constant is 1 / (2 pi 1.6Hz) ~= 100ms, 10 samples
+    f.Update(1.0f);
+    float out = 0;
+    for (int i = 0; i < 10; i++)
+    {
+        out = f.Update(2.0f);
+    }
+    EXPECT_NEAR(1.63f, out, 0.01f);
+
+    // Slightly under the RC's time constant, the discrete filter reacts within the sample
+    EXPECT_NEAR(94.5f, f.GetGroupDelayMs(), 0.5f);
+
+    LambdaFilter ramp;
+    ramp.Configure(MakeConfig(LambdaFilterType::Ema, 5, 1.6f));
+    EXPECT_NEAR(ramp.GetGroupDelayMs(), MeasureRampLagMs(ramp), 0.1f);
+}
+
+TEST(LambdaFilter, Median)
+{
+    LambdaFilter f;
+    f.Configure(MakeConfig(LambdaFilterType::Median, 5));
+
+    EXPECT_FLOAT_EQ(20, f.GetGroupDelayMs());
+
+    for (int i = 0; i < 5; i++)
+    {
+        f.Update(1.0f);
+    }
+
+    // Two sample spikes are gone entirely
+    EXPECT_FLOAT_EQ(1.0f, f.Update(3.0f));
+    EXPECT_FLOAT_EQ(1.0f, f.Update(0.1f));
+
+    for (int i = 0; i < 5; i++)
+    {
+        f.Update(1.0f);
+    }
+
+    // A step comes through after half the window
+    f.Update(1.2f);
+    f.Update(1.2f);
+    EXPECT_FLOAT_EQ(1.0f, f.Get());
+    EXPECT_FLOAT_EQ(1.2f, f.Update(1.2f));
+
+    // Longest window is capped
+    f.Configure(MakeConfig(LambdaFilterType::Median, 50));
+    EXPECT_FLOAT_EQ((LAMBDA_FILTER_MAX_MEDIAN - 1) / 2 * 10, f.GetGroupDelayMs());
+
+    LambdaFilter ramp;
+    ramp.Configure(MakeConfig(LambdaFilterType::Median, 7));
+    EXPECT_NEAR(ramp.GetGroupDelayMs(), MeasureRampLagMs(ramp), 0.1f);
+}
+
+TEST(LambdaFilter, Butterworth)
+{
+    LambdaFilter f;
+    f.Configure(MakeConfig(LambdaFilterType::Butterworth, 5, 5));
+
+    // Analog prototype would be sqrt(2) / (2 pi 5Hz) = 45ms
+    EXPECT_NEAR(45, f.GetGroupDelayMs(), 1.5f);
+
+    LambdaFilter ramp;
+    ramp.Configure(MakeConfig(LambdaFilterType::Butterworth, 5, 5));
+    EXPECT_NEAR(ramp.GetGroupDelayMs(), MeasureRampLagMs(ramp), 0.1f);
+
+    // -3dB at the cutoff, past it a bit steeper than the analog -40dB/decade
+    for (auto [hz, gain] : { std::pair{ 5.0f, 0.707f }, std::pair{ 25.0f, 0.025f } })
+    {
+        LambdaFilter sine;
+        sine.Configure(MakeConfig(LambdaFilterType::Butterworth, 5, 5));
+
+        float peak = 0;
+        for (int n = 0; n < 1000; n++)
+        {
+            float out = sine.Update(1 + 0.1f * sinf(2 * 3.14159265f * hz * n / LAMBDA_FILTER_RATE_HZ));
+            if (n > 500)
+            {
+                peak = std::max(peak, std::abs(out - 1));
+            }
+        }
+
+        EXPECT_NEAR(gain, peak / 0.1f, 0.03f) << hz;
+    }
+}
+
+TEST(LambdaFilter, KalmanFollowsRamps)
+{
+    LambdaFilter f;
+    f.Configure(MakeConfig(LambdaFilterType::Kalman, 5, 5));
+
+    EXPECT_FLOAT_EQ(0, f.GetGroupDelayMs());
+    EXPECT_NEAR(0, MeasureRampLagMs(f), 0.1f);
+
+    // Still a low pass on noise
+    LambdaFilter noise;
+    noise.Configure(MakeConfig(LambdaFilterType::Kalman, 5, 1));
+
+    float peak = 0;
+    for (int n = 0; n < 1000; n++)
+    {
+        float out = noise.Update((n & 1) ? 1.1f : 0.9f);
+        if (n > 500)
+        {
+            peak = std::max(peak, std::abs(out - 1));
+        }
+    }
+    EXPECT_LT(peak, 0.01f);
+}
+
+TEST(LambdaFilter, ReconfigureOnlyOnChange)
+{
+    LambdaFilter f;
+    f.Configure(MakeConfig(LambdaFilterType::Ema, 5, 1));
+
+    f.Update(1.0f);
+    float out = f.Update(2.0f);
+
+    // Same settings every loop keep the state
+    f.Configure(MakeConfig(LambdaFilterType::Ema, 5, 1));
+    EXPECT_LT(out, f.Update(2.0f));
+    EXPECT_GT(1.5f, f.Get());
+
+    // A change starts over on the next sample
+    f.Configure(MakeConfig(LambdaFilterType::Ema, 5, 2));
+    EXPECT_FLOAT_EQ(2.0f, f.Update(2.0f));
+}
@@ -0,0 +1,117 @@
+#include <gtest/gtest.h>
+
+#include "sample_blanking.h"
+
+// Heater PWM as configured: 1024 ticks per period
+static PwmEdges MakeEdges(uint16_t compare)
+{
+    PwmEdges edges = {};
+    edges.Period = 1024;
+    edges.AddChannel(compare);
+    return edges;
+}
+
+TEST(SampleBlanking, Edges)
+{
+    // Always off or always on never switches
+    EXPECT_EQ(0, MakeEdges(0).Count);
+    EXPECT_EQ(0, MakeEdges(1024).Count);
+
+    auto edges = MakeEdges(300);
+    ASSERT_EQ(2, edges.Count);
+    EXPECT_EQ(0, edges.Position[0]);
+    EXPECT_EQ(300, edges.Position[1]);
+
+    // A second channel shares the wrap
+    edges.AddChannel(700);
+    ASSERT_EQ(3, edges.Count);
+    EXPECT_EQ(700, edges.Position[2]);
+}
+
+TEST(SampleBlanking, Mask)
+{
+    auto edges = MakeEdges(300);
+
+    // 24 oversamples over ticks 280..326, one per 2 ticks: 8..12 are within 4 of 300
+    uint32_t mask = CleanSampleMask(edges, 280, 326, 24, 4);
+    for (int i = 0; i < 24; i++)
+    {
+        bool near = i >= 8 && i <= 12;
+        EXPECT_EQ(!near, (bool)(mask & (1u << i))) << i;
+    }
+
+    // Across the counter wrap
+    mask = CleanSampleMask(edges, 1000, 22, 24, 4);
+    for (int i = 0; i < 24; i++)
+    {
+        bool near = i >= 10 && i <= 14;
+        EXPECT_EQ(!near, (bool)(mask & (1u << i))) << i;
+    }
+
+    // Oversamples closer than a tick apart, each lands on the tick it was taken in
+    mask = CleanSampleMask(MakeEdges(285), 280, 290, 24, 1);
+    for (int i = 0; i < 24; i++)
+    {
+        bool near = i >= 10 && i <= 16;
+        EXPECT_EQ(!near, (bool)(mask & (1u << i))) << i;
+    }
+
+    // Nowhere near an edge, no edges at all, or blanking off
+    EXPECT_EQ(0xFFFFFFu, CleanSampleMask(edges, 400, 450, 24, 4));
+    EXPECT_EQ(0xFFFFFFu, CleanSampleMask(MakeEdges(0), 280, 326, 24, 4));
+    EXPECT_EQ(0xFFFFFFu, CleanSampleMask(edges, 280, 326, 24, 0));
+}
+
+// Two interleaved channels, channel 0 takes a spike on the oversamples near the edge
+struct CorruptedBuffer
+{
+    static constexpr size_t Channels = 2;
+    static constexpr size_t Oversample = 24;
+
+    uint16_t Samples[Channels * Oversample];
+
+    CorruptedBuffer(uint16_t value, uint16_t spike, size_t from, size_t to)
+    {
+        for (size_t i = 0; i < Oversample; i++)
+        {
+            bool hit = i >= from && i <= to;
+            Samples[i * Channels] = hit ? value + spike : value;
+            Samples[i * Channels + 1] = 1000;
+        }
+    }
+};
+
+TEST(SampleBlanking, AverageRejectsEdge)
+{
+    auto edges = MakeEdges(300);
+
+    // Ringing on the oversamples closest to the edge
+    CorruptedBuffer buffer(2000, 400, 9, 11);
+    uint32_t mask = CleanSampleMask(edges, 280, 326, 24, 4);
+
+    float plain = AverageClean(buffer.Samples, 0, 2, 24, 0xFFFFFF, 0);
+    float clean = AverageClean(buffer.Samples, 0, 2, 24, mask, 12);
+
+    EXPECT_FLOAT_EQ(2000 + 400 * 3 / 24.0f, plain);
+    EXPECT_FLOAT_EQ(2000, clean);
+
+    // Other channel untouched either way
+    EXPECT_FLOAT_EQ(1000, AverageClean(buffer.Samples, 1, 2, 24, mask, 12));
+}
+
+TEST(SampleBlanking, AverageFallsBackToAll)
+{
+    CorruptedBuffer buffer(2000, 240, 0, 11);
+
+    // Only half clean, but we want more than that
+    float v = AverageClean(buffer.Samples, 0, 2, 24, 0xFFF000, 13);
+    EXPECT_FLOAT_EQ(2120, v);
+
+    // Enough
+    v = AverageClean(buffer.Samples, 0, 2, 24, 0xFFF000, 12);
+    EXPECT_FLOAT_EQ(2000, v);
+
+    // Nothing clean at all
+    v = AverageClean(buffer.Samples, 0, 2, 24, 0, 0);
+    EXPECT_FLOAT_EQ(2120, v);
+}
@@ -0,0 +1,168 @@
+#include <gtest/gtest.h>
+
+#include "sample_stream.h"
+#include "port.h"
+
+static AnalogChannelResult channels[2];
+
+static void AddSamples(SampleStream& s, int count)
+{
+    for (int i = 0; i < count; i++)
+    {
+        channels[0].NernstVoltage = 0.001f * i;
+        channels[1].NernstVoltage = -0.001f * i;
+        s.Add(channels, 2, 0, i & 1, i);
+    }
+}
+
+struct Chunk
+{
+    SampleStreamHeader header;
+    SampleStreamRecord records[(256 - sizeof(SampleStreamHeader)) / sizeof(SampleStreamRecord)];
+};
+
+TEST(SampleStream, DisabledRecordsNothing)
+{
+    SampleStream s;
+    Chunk c;
+
+    AddSamples(s, 10);
+
+    EXPECT_FALSE(s.IsEnabled());
+    EXPECT_EQ(sizeof(SampleStreamHeader), s.Read(reinterpret_cast<uint8_t*>(&c), sizeof(c)));
+    EXPECT_EQ(0, c.header.Count);
+    EXPECT_EQ(0, c.header.Dropped);
+}
+
+TEST(SampleStream, Records)
+{
+    SampleStream s;
+    Chunk c;
+
+    s.Configure(0x01, 1);
+    channels[0].PumpCurrentVoltage = 1.5f;
+    channels[0].NernstClamped = true;
+    AddSamples(s, 3);
+
+    EXPECT_EQ(sizeof(SampleStreamHeader) + 3 * sizeof(SampleStreamRecord), s.Read(reinterpret_cast<uint8_t*>(&c), sizeof(c)));
+    ASSERT_EQ(3, c.header.Count);
+
+    for (int i = 0; i < 3; i++)
+    {
+        auto& r = c.records[i];
+        EXPECT_EQ(i, r.Sequence);
+        EXPECT_EQ(i, r.HeaterPhase);
+        EXPECT_EQ(i & 1, r.Flags & SAMPLE_STREAM_FLAG_ESR_PHASE);
+        EXPECT_TRUE(r.Flags & SAMPLE_STREAM_FLAG_CLAMPED);
+        EXPECT_EQ(0, r.Flags >> SAMPLE_STREAM_CHANNEL_SHIFT);
+        EXPECT_NEAR(i * 10, r.NernstRaw, 1);
+        EXPECT_EQ(15000, r.PumpCurrent);
+    }
+
+    channels[0] = {};
+
+    // Drained
+    s.Read(reinterpret_cast<uint8_t*>(&c), sizeof(c));
+    EXPECT_EQ(0, c.header.Count);
+}
+
+TEST(SampleStream, ChannelMaskAndDecimation)
+{
+    SampleStream s;
+    Chunk c;
+
+    s.Configure(0x02, 4);
+    AddSamples(s, 16);
+
+    s.Read(reinterpret_cast<uint8_t*>(&c), sizeof(c));
+    ASSERT_EQ(4, c.header.Count);
+
+    for (int i = 0; i < 4; i++)
+    {
+        EXPECT_EQ(1, c.records[i].Flags >> SAMPLE_STREAM_CHANNEL_SHIFT);
+        EXPECT_EQ(4 * i + 3, c.records[i].Sequence);
+    }
+}
+
+TEST(SampleStream, OverflowCountsDropped)
+{
+    SampleStream s;
+    Chunk c;
+
+    s.Configure(0x03, 1);
+    AddSamples(s, SAMPLE_STREAM_DEPTH);
+
+    s.Read(reinterpret_cast<uint8_t*>(&c), sizeof(c));
+    EXPECT_EQ(SAMPLE_STREAM_DEPTH, c.header.Dropped);
+
+    // Oldest records are kept, the reader sees a gap rather than a jump back
+    EXPECT_EQ(0, c.records[0].Sequence);
+
+    size_t total = c.header.Count;
+    while (c.header.Count)
+    {
+        s.Read(reinterpret_cast<uint8_t*>(&c), sizeof(c));
+        EXPECT_EQ(0, c.header.Dropped);
+        total += c.header.Count;
+    }
+
+    EXPECT_EQ((size_t)SAMPLE_STREAM_DEPTH, total);
+}
+
+TEST(SampleStream, ChunkLimitedByBuffer)
+{
+    SampleStream s;
+    uint8_t buffer[sizeof(SampleStreamHeader) + 2 * sizeof(SampleStreamRecord) + 3];
+
+    s.Configure(0x01, 1);
+    AddSamples(s, 5);
+
+    EXPECT_EQ(sizeof(buffer) - 3, s.Read(buffer, sizeof(buffer)));
+    EXPECT_EQ(2, reinterpret_cast<SampleStreamHeader*>(buffer)->Count);
+
+    EXPECT_EQ(0u, s.Read(buffer, 2));
+}
+
+TEST(SampleStream, SaturatesOutOfRange)
+{
+    SampleStream s;
+    Chunk c;
+
+    s.Configure(0x01, 1);
+    channels[0].NernstVoltage = 5;
+    channels[0].PumpCurrentVoltage = -5;
+    s.Add(channels, 1, 0, false, 0);
+    channels[0] = {};
+
+    s.Read(reinterpret_cast<uint8_t*>(&c), sizeof(c));
+    ASSERT_EQ(1, c.header.Count);
+    EXPECT_EQ(INT16_MAX, c.records[0].NernstRaw);
+    EXPECT_EQ(INT16_MIN, c.records[0].PumpCurrent);
+}
+
+TEST(SampleStream, OwnedByLastConfigure)
+{
+    SampleStream s;
+    Chunk c;
+    int primary, secondary;
+
+    // Nobody streaming yet, anyone sees it empty
+    EXPECT_EQ(sizeof(SampleStreamHeader), s.Read(reinterpret_cast<uint8_t*>(&c), sizeof(c), &secondary));
+
+    ASSERT_TRUE(s.Configure(0x01, 1, &primary));
+    AddSamples(s, 3);
+
+    // Not taken from under the channel that asked for them
+    EXPECT_EQ(0u, s.Read(reinterpret_cast<uint8_t*>(&c), sizeof(c), &secondary));
+
+    s.Read(reinterpret_cast<uint8_t*>(&c), sizeof(c), &primary);
+    EXPECT_EQ(3, c.header.Count);
+
+    // Taken over by configuring it
+    ASSERT_TRUE(s.Configure(0x01, 1, &secondary));
+    AddSamples(s, 2);
+    EXPECT_EQ(0u, s.Read(reinterpret_cast<uint8_t*>(&c), sizeof(c), &primary));
+
+    s.Read(reinterpret_cast<uint8_t*>(&c), sizeof(c), &secondary);
+    EXPECT_EQ(2, c.header.Count);
+}
@@ -61,3 +61,38 @@ TEST(Sampler, TestAc)
     EXPECT_FLOAT_EQ(0.45f, dut.GetNernstDc());
     EXPECT_NEAR(-0.1616, dut.GetPumpNominalCurrent(), 1e-3);
 }
+
+TEST(Sampler, TestWarmup)
+{
+    Sampler dut;
+
+    AnalogChannelResult dataLow;
+    dataLow.NernstVoltage = 0.45f - 0.1f;
+    dataLow.PumpCurrentVoltage = 1.75f;
+    dataLow.NernstClamped = false;
+
+    AnalogChannelResult dataHigh;
+    dataHigh.NernstVoltage = 0.45f + 0.1f;
+    dataHigh.PumpCurrentVoltage = 1.75f;
+    dataHigh.NernstClamped = false;
+
+    constexpr float virtualGroundVoltage = 1.65f;
+
+    EXPECT_FALSE(dut.IsStable());
+
+    for (size_t i = 0; i < ESR_SENSE_STABLE_SAMPLES / 2; i++)
+    {
+        dut.ApplySample(dataLow,  virtualGroundVoltage);
+        dut.ApplySample(dataHigh, virtualGroundVoltage);
+    }
+
+    // Only the first two samples are missing, everything else is averaged
+    EXPECT_FALSE(dut.IsStable());
+    dut.ApplySample(dataLow,  virtualGroundVoltage);
+    dut.ApplySample(dataHigh, virtualGroundVoltage);
+    EXPECT_TRUE(dut.IsStable());
+
+    // Settled already, no slow decay up from zero
+    EXPECT_NEAR(0.2, dut.GetNernstAc(), 1e-3);
+    EXPECT_NEAR(-0.1616, dut.GetPumpNominalCurrent(), 1e-3);
+}
@@ -0,0 +1,168 @@
+#include <gtest/gtest.h>
+
+#include "sensor_estimator.h"
+
+// Closed loop pump, sensor at temperature
+static SensorEstimatorInputs Good()
+{
+    SensorEstimatorInputs in = {};
+    in.Lambda = 1.0f;
+    in.NernstDc = NERNST_TARGET;
+    in.PumpDuty = 0.5f;
+    in.PumpActive = true;
+    in.EsrTemperature = 780;
+    in.TargetTemperature = 780;
+    in.HeaterEffectiveVoltage = 8;
+    return in;
+}
+
+// Pump loop passes
+static void RunFor(SensorEstimator& e, const SensorEstimatorInputs& in, int ms)
+{
+    for (int i = 0; i < ms / PUMP_CONTROL_PERIOD; i++)
+    {
+        e.Update(in);
+    }
+}
+
+TEST(SensorEstimator, NothingKnownAtStart)
+{
+    SensorEstimator e;
+
+    EXPECT_FALSE(e.IsValid());
+    EXPECT_LT(e.GetConfidence(), 0.01f);
+}
+
+TEST(SensorEstimator, ValidInClosedLoop)
+{
+    SensorEstimator e;
+    auto in = Good();
+    in.Lambda = 0.85f;
+
+    RunFor(e, in, 100);
+
+    EXPECT_TRUE(e.IsValid());
+    EXPECT_GT(e.GetConfidence(), 0.9f);
+    EXPECT_NEAR(0.85f, e.GetLambda(), 1e-4);
+    EXPECT_NEAR(780, e.GetTemperature(), 0.1f);
+    EXPECT_LT(e.GetLambdaSigma(), 0.005f);
+
+    // Follows lambda within a few loops
+    in.Lambda = 1.2f;
+    RunFor(e, in, 20);
+    EXPECT_NEAR(1.2f, e.GetLambda(), 0.01f);
+}
+
+TEST(SensorEstimator, ConfidenceFallsWithNernstError)
+{
+    float last = 1;
+
+    // About where the old +-0.1V band check was
+    for (float error : { 0.0f, 0.02f, 0.05f, 0.08f, 0.12f, 0.2f })
+    {
+        SensorEstimator e;
+        auto in = Good();
+        in.NernstDc = NERNST_TARGET + error;
+
+        RunFor(e, in, 200);
+
+        EXPECT_LT(e.GetConfidence(), last) << error;
+        EXPECT_EQ(error < 0.1f, e.IsValid()) << error;
+        last = e.GetConfidence();
+    }
+}
+
+TEST(SensorEstimator, PumpAtItsStops)
+{
+    SensorEstimator e;
+    auto in = Good();
+    RunFor(e, in, 100);
+
+    in.PumpDuty = 0.93f;
+    RunFor(e, in, 100);
+    EXPECT_TRUE(e.IsValid());
+
+    in.PumpDuty = 1.0f;
+    RunFor(e, in, 100);
+    EXPECT_FALSE(e.IsValid());
+
+    // Back in range
+    in.PumpDuty = 0.12f;
+    RunFor(e, in, 100);
+    EXPECT_TRUE(e.IsValid());
+}
+
+TEST(SensorEstimator, OutOfSensorRange)
+{
+    SensorEstimator e;
+    auto in = Good();
+    in.Lambda = 0.5f;
+
+    RunFor(e, in, 100);
+    EXPECT_FALSE(e.IsValid());
+}
+
+TEST(SensorEstimator, DecaysWithoutPump)
+{
+    SensorEstimator e;
+    auto in = Good();
+    RunFor(e, in, 100);
+
+    in.PumpActive = false;
+    in.Lambda = 2;
+
+    RunFor(e, in, 20);
+    EXPECT_TRUE(e.IsValid());
+    // Nothing measured, nothing moves
+    EXPECT_FLOAT_EQ(1.0f, e.GetLambda());
+
+    RunFor(e, in, 100);
+    EXPECT_FALSE(e.IsValid());
+}
+
+TEST(SensorEstimator, ValidBeforeHeaterClosedLoop)
+{
+    SensorEstimator e;
+    auto in = Good();
+
+    // Warming up, pump just started 200C below target
+    for (float t = 580; t < 780; t += 1)
+    {
+        in.EsrTemperature = t;
+        RunFor(e, in, 20);
+
+        // Invalid until about 100C from target, no need to wait for the heater
+        if (t < 650)
+        {
+            EXPECT_FALSE(e.IsValid()) << t;
+        }
+        if (t > 720)
+        {
+            EXPECT_TRUE(e.IsValid()) << t;
+        }
+    }
+}
+
+TEST(SensorEstimator, TemperatureFollowsHeaterSteps)
+{
+    SensorEstimator steady;
+    SensorEstimator stepped;
+    auto in = Good();
+    RunFor(steady, in, 1000);
+    RunFor(stepped, in, 1000);
+
+    in.EsrTemperature = 800;
+    steady.Update(in);
+
+    // Same measurement, but right after the heater voltage went up
+    in.HeaterEffectiveVoltage = 10;
+    stepped.Update(in);
+
+    EXPECT_GT(stepped.GetTemperature() - 780, 2 * (steady.GetTemperature() - 780));
+
+    // No ESR, the estimate holds
+    in.EsrTemperature = 0;
+    float before = stepped.GetTemperature();
+    RunFor(stepped, in, 100);
+    EXPECT_FLOAT_EQ(before, stepped.GetTemperature());
+}
@@ -0,0 +1,212 @@
+#include <gtest/gtest.h>
+
+#include <cmath>
+
+#include "sensor_response.h"
+
+// First order sensor plus dead time, in the pump loop with an integral controller
+struct SensorLoop
+{
+    SensorLoop(float tauMs, int delayPasses)
+        : Alpha(1 - expf(-PUMP_CONTROL_PERIOD / tauMs))
+        , DelayPasses(delayPasses)
+    {
+    }
+
+    // Optional lambda change the loop has to follow, in pump mA
+    float Disturbance = 0;
+    float DisturbanceHz = 0;
+
+    float Alpha;
+    int DelayPasses;
+
+    float Cavity = 0;
+    float Pump = 0;
+    float History[32] = {};
+    int Pass = 0;
+
+    void Run(SensorResponseEstimator& e, int ms, bool canRun = true)
+    {
+        for (int i = 0; i < ms / PUMP_CONTROL_PERIOD; i++)
+        {
+            float nernst = NERNST_TARGET + 0.5f * Cavity;
+
+            float t = Pass * PUMP_CONTROL_PERIOD / 1000.0f;
+            float exhaust = Disturbance * sinf(2 * 3.14159265f * DisturbanceHz * t);
+
+            Pump += 0.02f * (NERNST_TARGET - nernst);
+            float current = Pump + e.GetDither();
+            e.Update(current, nernst, canRun);
+            // CAN Tx thread, on target
+            e.Process();
+
+            History[Pass % 32] = current;
+            float delayed = History[(Pass + 32 - DelayPasses) % 32];
+            Cavity += Alpha * (delayed - exhaust - Cavity);
+
+            Pass++;
+        }
+    }
+};
+
+static SensorResponseEstimator Fast()
+{
+    // Every second instead of every minute
+    return SensorResponseEstimator(SENSOR_RESPONSE_PERIOD_SAMPLES, SENSOR_RESPONSE_BURST_PERIODS, 1000);
+}
+
+TEST(SensorResponse, NoDitherUntilBurst)
+{
+    SensorResponseEstimator e;
+    SensorLoop loop(20, 0);
+
+    loop.Run(e, SENSOR_RESPONSE_HOLDOFF_MS - 10);
+    EXPECT_EQ(0, e.GetDither());
+    EXPECT_FALSE(e.HasResult());
+
+    // First burst once valid for the holdoff
+    loop.Run(e, 20);
+    EXPECT_NE(0, e.GetDither());
+
+    // Zero mean over a period
+    float sum = 0;
+    for (int i = 0; i < SENSOR_RESPONSE_PERIOD_SAMPLES; i++)
+    {
+        sum += e.GetDither();
+        e.Update(0, NERNST_TARGET, true);
+    }
+    EXPECT_NEAR(0, sum, 1e-6);
+}
+
+TEST(SensorResponse, MeasuresLagAndDelay)
+{
+    struct Case { float tauMs; int delayPasses; };
+
+    for (auto c : { Case{ 5, 0 }, Case{ 20, 0 }, Case{ 20, 3 }, Case{ 60, 2 }, Case{ 120, 5 } })
+    {
+        SensorResponseEstimator e;
+        SensorLoop loop(c.tauMs, c.delayPasses);
+
+        // Holdoff, then one burst
+        loop.Run(e, SENSOR_RESPONSE_HOLDOFF_MS + 2600);
+
+        ASSERT_TRUE(e.HasResult()) << c.tauMs;
+        EXPECT_EQ(0, e.GetDither());
+        EXPECT_NEAR(c.tauMs, e.GetTimeConstantMs(), 0.05f * c.tauMs + 0.5f) << c.tauMs;
+        EXPECT_NEAR(c.delayPasses * PUMP_CONTROL_PERIOD, e.GetDelayMs(), 0.5f) << c.tauMs;
+    }
+}
+
+TEST(SensorResponse, ResultLeftToProcess)
+{
+    auto e = Fast();
+
+    // Burst and well past the interval without anybody processing it
+    for (int i = 0; i < 3000; i++)
+    {
+        e.Update(e.GetDither(), NERNST_TARGET + 0.1f * e.GetDither(), true);
+    }
+
+    // Done, but no result yet and no new burst either
+    EXPECT_FALSE(e.HasResult());
+    EXPECT_EQ(0, e.GetDither());
+
+    e.Process();
+    EXPECT_EQ(1u, e.GetResultCount());
+
+    // Only once
+    e.Process();
+    EXPECT_EQ(1u, e.GetResultCount());
+}
+
+TEST(SensorResponse, LambdaChangesRejected)
+{
+    SensorResponseEstimator e;
+    SensorLoop loop(30, 2);
+
+    // Much bigger than the dither, and not at its frequencies
+    loop.Disturbance = 1;
+    loop.DisturbanceHz = 1.3f;
+
+    loop.Run(e, SENSOR_RESPONSE_HOLDOFF_MS + 2600);
+
+    ASSERT_TRUE(e.HasResult());
+    EXPECT_NEAR(30, e.GetTimeConstantMs(), 3);
+    EXPECT_NEAR(4, e.GetDelayMs(), 1);
+}
+
+static void ExpectNeverMeasures(SensorResponseEstimator& e)
+{
+    SensorLoop loop(20, 1);
+    loop.Disturbance = 0.1f;
+    loop.DisturbanceHz = 10;
+
+    EXPECT_FALSE(e.IsEnabled());
+
+    // Whatever the pump current does
+    loop.Run(e, 30000);
+
+    EXPECT_EQ(0, e.GetDither());
+    EXPECT_FALSE(e.HasResult());
+    EXPECT_FALSE(std::isnan(e.GetTimeConstantMs()));
+    EXPECT_FALSE(std::isnan(e.GetDelayMs()));
+}
+
+TEST(SensorResponse, TurnedOffByInterval)
+{
+    SensorResponseEstimator e(SENSOR_RESPONSE_PERIOD_SAMPLES, SENSOR_RESPONSE_BURST_PERIODS, 0);
+    ExpectNeverMeasures(e);
+}
+
+TEST(SensorResponse, TurnedOffByDither)
+{
+    SensorResponseEstimator e(SENSOR_RESPONSE_PERIOD_SAMPLES, SENSOR_RESPONSE_BURST_PERIODS, 1000, PUMP_CONTROL_PERIOD, 0);
+    ExpectNeverMeasures(e);
+}
+
+TEST(SensorResponse, AbortedBurstRetried)
+{
+    SensorResponseEstimator e;
+    SensorLoop loop(20, 0);
+
+    loop.Run(e, SENSOR_RESPONSE_HOLDOFF_MS + 1000);
+    EXPECT_NE(0, e.GetDither());
+
+    // Sensor no longer valid halfway through
+    loop.Run(e, 10, false);
+    EXPECT_EQ(0, e.GetDither());
+    EXPECT_FALSE(e.HasResult());
+
+    // Not counting while invalid
+    loop.Run(e, 100000, false);
+    EXPECT_FALSE(e.HasResult());
+
+    // Another holdoff and it's measured after all
+    loop.Run(e, SENSOR_RESPONSE_HOLDOFF_MS + 2600);
+    EXPECT_TRUE(e.HasResult());
+    EXPECT_EQ(1u, e.GetResultCount());
+}
+
+TEST(SensorResponse, FollowsAgeing)
+{
+    auto e = Fast();
+    SensorLoop loop(20, 1);
+
+    loop.Run(e, SENSOR_RESPONSE_HOLDOFF_MS + 2600);
+    ASSERT_TRUE(e.HasResult());
+    EXPECT_NEAR(20, e.GetTimeConstantMs(), 1);
+
+    // Slower sensor, one burst only moves it part of the way
+    loop.Alpha = 1 - expf(-PUMP_CONTROL_PERIOD / 40.0f);
+    uint32_t before = e.GetResultCount();
+    while (e.GetResultCount() == before)
+    {
+        loop.Run(e, 100);
+    }
+    EXPECT_GT(e.GetTimeConstantMs(), 22);
+    EXPECT_LT(e.GetTimeConstantMs(), 35);
+
+    // Then settles there
+    loop.Run(e, 60000);
+    EXPECT_NEAR(40, e.GetTimeConstantMs(), 2);
+}
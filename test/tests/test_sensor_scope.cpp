@@ -0,0 +1,206 @@
+#include <gtest/gtest.h>
+
+#include <cstring>
+#include <vector>
+
+#include "sensor_scope.h"
+#include "port.h"
+
+static AnalogChannelResult channels[2];
+
+static void AddSamples(SensorScope& s, int count)
+{
+    for (int i = 0; i < count; i++)
+    {
+        s.Add(channels, 2, 0, false, 0);
+    }
+}
+
+static ScopeControl ReadControl(const SensorScope& s)
+{
+    ScopeControl c;
+    s.ReadPage(0, reinterpret_cast<uint8_t*>(&c), sizeof(c));
+    return c;
+}
+
+static std::vector<SampleStreamRecord> ReadRecords(const SensorScope& s)
+{
+    auto c = ReadControl(s);
+    std::vector<SampleStreamRecord> records(c.Count);
+    s.ReadPage(sizeof(ScopeControl), reinterpret_cast<uint8_t*>(records.data()), c.Count * sizeof(SampleStreamRecord));
+    return records;
+}
+
+static void SetState(SensorScope& s, ScopeState state)
+{
+    uint8_t v = static_cast<uint8_t>(state);
+    EXPECT_TRUE(s.WritePage(offsetof(ScopeControl, State), &v, 1));
+}
+
+TEST(SensorScope, ArmedAtBoot)
+{
+    SensorScope s;
+
+    EXPECT_EQ(ScopeState::Armed, s.GetState());
+
+    auto c = ReadControl(s);
+    EXPECT_EQ(SCOPE_DEFAULT_TRIGGERS, c.TriggerMask);
+    EXPECT_EQ(SCOPE_DEPTH, c.Depth);
+    EXPECT_EQ(0, c.Count);
+    EXPECT_EQ(0xFFFF, c.TriggerIndex);
+    EXPECT_EQ(sizeof(ScopeControl) + SCOPE_DEPTH * sizeof(SampleStreamRecord), s.GetPageSize());
+}
+
+TEST(SensorScope, RingKeepsLatest)
+{
+    SensorScope s;
+
+    AddSamples(s, SCOPE_DEPTH + 10);
+
+    EXPECT_EQ(ScopeState::Armed, s.GetState());
+
+    auto records = ReadRecords(s);
+    ASSERT_EQ((size_t)SCOPE_DEPTH, records.size());
+    EXPECT_EQ(10, records.front().Sequence);
+    EXPECT_EQ(SCOPE_DEPTH + 9, records.back().Sequence);
+}
+
+TEST(SensorScope, FaultFreezesWithPreTrigger)
+{
+    SensorScope s;
+
+    AddSamples(s, 1000);
+
+    // First check only latches the current values
+    s.CheckTriggers(0, 0, 1.0f);
+    AddSamples(s, 1);
+    s.CheckTriggers(0, 0, 1.0f);
+    AddSamples(s, 1);
+    EXPECT_EQ(ScopeState::Armed, s.GetState());
+
+    s.CheckTriggers(3, 0, 1.0f);
+    AddSamples(s, 1);
+    EXPECT_EQ(ScopeState::Triggered, s.GetState());
+
+    constexpr int post = SCOPE_DEPTH * SCOPE_POST_TRIGGER_PERCENT / 100;
+    AddSamples(s, post - 1);
+    EXPECT_EQ(ScopeState::Triggered, s.GetState());
+    AddSamples(s, 1);
+    EXPECT_EQ(ScopeState::Frozen, s.GetState());
+
+    // Frozen, more samples don't change the capture
+    AddSamples(s, 100);
+
+    auto c = ReadControl(s);
+    EXPECT_EQ(SCOPE_TRIGGER_FAULT, c.TriggeredBy);
+    EXPECT_EQ(SCOPE_DEPTH, c.Count);
+    EXPECT_EQ(SCOPE_DEPTH - 1 - post, c.TriggerIndex);
+
+    auto records = ReadRecords(s);
+    EXPECT_EQ(1002, records[c.TriggerIndex].Sequence);
+    EXPECT_EQ(1002 + post, records.back().Sequence);
+}
+
+TEST(SensorScope, MaskedTriggersIgnored)
+{
+    SensorScope s;
+
+    s.CheckTriggers(0, 0, 1.0f);
+
+    // Heater state and lambda step aren't enabled by default
+    s.CheckTriggers(0, 2, 0.5f);
+    channels[0].NernstClamped = true;
+    AddSamples(s, 1);
+    channels[0].NernstClamped = false;
+
+    EXPECT_EQ(ScopeState::Armed, s.GetState());
+
+    uint8_t mask = SCOPE_TRIGGER_LAMBDA_STEP;
+    s.WritePage(offsetof(ScopeControl, TriggerMask), &mask, 1);
+
+    s.CheckTriggers(0, 2, 0.55f);
+    AddSamples(s, 1);
+    EXPECT_EQ(ScopeState::Armed, s.GetState());
+
+    s.CheckTriggers(0, 2, 0.7f);
+    AddSamples(s, 1);
+    EXPECT_EQ(ScopeState::Triggered, s.GetState());
+    EXPECT_EQ(SCOPE_TRIGGER_LAMBDA_STEP, ReadControl(s).TriggeredBy);
+}
+
+TEST(SensorScope, ClampTrigger)
+{
+    SensorScope s;
+
+    uint8_t mask = SCOPE_TRIGGER_NERNST_CLAMP;
+    s.WritePage(offsetof(ScopeControl, TriggerMask), &mask, 1);
+
+    AddSamples(s, 5);
+    channels[0].NernstClamped = true;
+    AddSamples(s, 1);
+    channels[0].NernstClamped = false;
+
+    auto c = ReadControl(s);
+    EXPECT_EQ(ScopeState::Triggered, static_cast<ScopeState>(c.State));
+    EXPECT_EQ(5, c.TriggerIndex);
+    EXPECT_TRUE(ReadRecords(s)[5].Flags & SAMPLE_STREAM_FLAG_CLAMPED);
+}
+
+TEST(SensorScope, ManualTriggerAndRearm)
+{
+    SensorScope s;
+
+    uint8_t post = 0;
+    s.WritePage(offsetof(ScopeControl, PostTriggerPercent), &post, 1);
+
+    AddSamples(s, 20);
+    SetState(s, ScopeState::Triggered);
+    AddSamples(s, 1);
+
+    EXPECT_EQ(ScopeState::Frozen, s.GetState());
+    auto c = ReadControl(s);
+    EXPECT_EQ(SCOPE_TRIGGER_MANUAL, c.TriggeredBy);
+    EXPECT_EQ(21, c.Count);
+    EXPECT_EQ(20, c.TriggerIndex);
+
+    SetState(s, ScopeState::Armed);
+    EXPECT_EQ(ScopeState::Armed, s.GetState());
+    EXPECT_EQ(0, ReadControl(s).Count);
+    EXPECT_EQ(0, ReadControl(s).TriggeredBy);
+
+    SetState(s, ScopeState::Idle);
+    AddSamples(s, 10);
+    EXPECT_EQ(0, ReadControl(s).Count);
+}
+
+TEST(SensorScope, SelectedChannel)
+{
+    SensorScope s;
+
+    uint8_t ch = 1;
+    s.WritePage(offsetof(ScopeControl, Channel), &ch, 1);
+    channels[1].NernstVoltage = 0.1f;
+    AddSamples(s, 2);
+    channels[1] = {};
+
+    auto records = ReadRecords(s);
+    ASSERT_EQ(2u, records.size());
+    EXPECT_EQ(1, records[0].Flags >> SAMPLE_STREAM_CHANNEL_SHIFT);
+    EXPECT_EQ(1000, records[0].NernstRaw);
+
+    // Channel this board doesn't have records nothing
+    ch = 5;
+    s.WritePage(offsetof(ScopeControl, Channel), &ch, 1);
+    AddSamples(s, 2);
+    EXPECT_EQ(2, ReadControl(s).Count);
+}
+
+TEST(SensorScope, ReadOnlyFieldsRejected)
+{
+    SensorScope s;
+    uint8_t zero[4] = {};
+
+    EXPECT_FALSE(s.WritePage(offsetof(ScopeControl, TriggeredBy), zero, 1));
+    EXPECT_FALSE(s.WritePage(2, zero, 4));
+    EXPECT_FALSE(s.WritePage(sizeof(ScopeControl), zero, 4));
+}
@@ -0,0 +1,44 @@
+#include <gtest/gtest.h>
+
+#include <cstring>
+
+#include <rusefi/crc.h>
+
+#include "telemetry.h"
+
+TEST(Telemetry, FrameLayout)
+{
+    TelemetryAfrRecord record = {};
+    record.Lambda = 1000;
+    record.PumpCurrent = -1234;
+    record.Fault = 4;
+
+    uint8_t frame[64];
+    size_t length = TelemetryPack(frame, sizeof(frame), TelemetryFrameType::Status, 0x1234, 0xA0B0C0D0, &record, sizeof(record));
+
+    ASSERT_EQ(sizeof(record) + TELEMETRY_OVERHEAD, length);
+
+    EXPECT_EQ('W', frame[0]);
+    EXPECT_EQ('T', frame[1]);
+    EXPECT_EQ(TELEMETRY_VERSION, frame[2]);
+    EXPECT_EQ(static_cast<uint8_t>(TelemetryFrameType::Status), frame[3]);
+    EXPECT_EQ(sizeof(record), static_cast<size_t>(frame[4] | frame[5] << 8));
+    EXPECT_EQ(0x34, frame[6]);
+    EXPECT_EQ(0x12, frame[7]);
+    EXPECT_EQ(0xD0, frame[8]);
+    EXPECT_EQ(0xA0, frame[11]);
+    EXPECT_EQ(0, memcmp(frame + 12, &record, sizeof(record)));
+
+    uint32_t crc;
+    memcpy(&crc, frame + length - 4, sizeof(crc));
+    EXPECT_EQ(crc32(frame, length - 4), crc);
+}
+
+TEST(Telemetry, TooSmall)
+{
+    uint8_t payload[10] = {};
+    uint8_t frame[10 + TELEMETRY_OVERHEAD];
+
+    EXPECT_EQ(0u, TelemetryPack(frame, sizeof(frame) - 1, TelemetryFrameType::BootTimeline, 0, 0, payload, sizeof(payload)));
+    EXPECT_EQ(sizeof(frame), TelemetryPack(frame, sizeof(frame), TelemetryFrameType::BootTimeline, 0, 0, payload, sizeof(payload)));
+}
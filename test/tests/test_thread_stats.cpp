@@ -0,0 +1,133 @@
+#include <gtest/gtest.h>
+
+#include <cstring>
+
+#include "thread_stats.h"
+
+TEST(ThreadStats, LoopStatsKeepsMax)
+{
+    LoopStats l;
+
+    l.Begin(100);
+    l.End(150);
+    EXPECT_EQ(50u, l.GetLast());
+    EXPECT_EQ(50u, l.GetMax());
+
+    l.Begin(200);
+    l.End(220);
+    EXPECT_EQ(20u, l.GetLast());
+    EXPECT_EQ(50u, l.GetMax());
+
+    // Counter wraps during the pass
+    l.Begin(0xFFFFFFF0);
+    l.End(0x40);
+    EXPECT_EQ(0x50u, l.GetMax());
+
+    // Unpaired End is ignored
+    l.End(0x10000);
+    EXPECT_EQ(0x50u, l.GetLast());
+}
+
+TEST(ThreadStats, StackUnused)
+{
+    uint8_t stack[64];
+    memset(stack, 0x55, sizeof(stack));
+
+    EXPECT_EQ(64u, StackUnusedBytes(stack, sizeof(stack), 0x55));
+
+    // Deepest use so far, the top is in use
+    stack[20] = 0;
+    stack[40] = 0x12;
+    EXPECT_EQ(20u, StackUnusedBytes(stack, sizeof(stack), 0x55));
+
+    stack[0] = 0xAA;
+    EXPECT_EQ(0u, StackUnusedBytes(stack, sizeof(stack), 0x55));
+}
+
+TEST(ThreadStats, Load)
+{
+    EXPECT_EQ(0, LoadHalfPercent(0, 0));
+    EXPECT_EQ(0, LoadHalfPercent(0, 1000));
+    EXPECT_EQ(1, LoadHalfPercent(5, 1000));
+    EXPECT_EQ(100, LoadHalfPercent(500, 1000));
+    EXPECT_EQ(200, LoadHalfPercent(1000, 1000));
+    EXPECT_EQ(200, LoadHalfPercent(2000, 1000));
+    EXPECT_EQ(50, LoadHalfPercent(72000000ull * 30, 72000000ull * 120));
+}
+
+TEST(ThreadStats, DeadlineOnTime)
+{
+    DeadlineMonitor d;
+    d.SetPeriod(800);
+
+    // First pass only starts the clock
+    EXPECT_FALSE(d.Tick(1000));
+
+    // Exactly on time, then a bit late, then early (windowed sleep catching up)
+    EXPECT_FALSE(d.Tick(1800));
+    EXPECT_FALSE(d.Tick(2650));
+    EXPECT_FALSE(d.Tick(3300));
+
+    EXPECT_EQ(0, d.GetMisses());
+    EXPECT_EQ(50u, d.GetWorstLate());
+    EXPECT_EQ(3, d.GetHistogram()[0]);
+}
+
+TEST(ThreadStats, DeadlineMiss)
+{
+    DeadlineMonitor d;
+    d.SetPeriod(800);
+
+    d.Tick(0);
+    // 3/8 late, below the miss threshold
+    EXPECT_FALSE(d.Tick(1100));
+    // Exactly half a period late
+    EXPECT_TRUE(d.Tick(2300));
+    // Stalled for several periods
+    EXPECT_TRUE(d.Tick(10000));
+
+    EXPECT_EQ(2, d.GetMisses());
+    EXPECT_EQ(10000u - 2300 - 800, d.GetWorstLate());
+
+    const uint16_t* h = d.GetHistogram();
+    EXPECT_EQ(1, h[3]);
+    EXPECT_EQ(1, h[4]);
+    EXPECT_EQ(1, h[DEADLINE_HISTOGRAM_BUCKETS - 1]);
+}
+
+TEST(ThreadStats, DeadlineHistogramKeepsShape)
+{
+    DeadlineMonitor d;
+    d.SetPeriod(100);
+
+    uint32_t t = 0;
+    d.Tick(t);
+
+    for (int i = 0; i < UINT16_MAX; i++)
+    {
+        t += 100;
+        d.Tick(t);
+    }
+
+    t += 150;
+    d.Tick(t);
+
+    EXPECT_EQ(UINT16_MAX, d.GetHistogram()[0]);
+    EXPECT_EQ(1, d.GetHistogram()[4]);
+
+    // The next on-time pass halves everything first
+    t += 100;
+    d.Tick(t);
+
+    EXPECT_EQ(UINT16_MAX / 2 + 1, d.GetHistogram()[0]);
+    EXPECT_EQ(0, d.GetHistogram()[4]);
+}
+
+TEST(ThreadStats, DeadlineOff)
+{
+    DeadlineMonitor d;
+
+    EXPECT_FALSE(d.Tick(0));
+    EXPECT_FALSE(d.Tick(1000000));
+    EXPECT_EQ(0u, d.GetWorstLate());
+}
@@ -0,0 +1,114 @@
+#include <gtest/gtest.h>
+
+#include <cstring>
+#include <vector>
+
+#include "tunerstudio.h"
+#include "livedata.h"
+#include "sampling.h"
+#include "fast_crc.h"
+#include "sensor_scope.h"
+#include "byteswap.h"
+
+// The protocol code without its thread, transport or livedata
+static uint8_t image[LIVEDATA_SIZE];
+
+const uint8_t* LiveDataAcquire()
+{
+    return image;
+}
+
+void LiveDataRelease(const uint8_t*)
+{
+}
+
+void chDbgAssertFailed(const char* reason)
+{
+    ADD_FAILURE() << "assert: " << reason;
+}
+
+tunerstudio_counters_s tsState;
+
+void tunerStudioError(TsChannelBase*, const char*)
+{
+}
+
+void sendErrorCode(TsChannelBase*, uint8_t)
+{
+}
+
+void TunerStudio::sendErrorCode(TsChannelBase*, uint8_t)
+{
+}
+
+void sendOkResponse(TsChannelBase*, ts_response_format_e)
+{
+}
+
+size_t GetSamplingProfile(uint8_t*, size_t, bool)
+{
+    return 0;
+}
+
+struct CaptureChannel : public TsChannelBase
+{
+    CaptureChannel() : TsChannelBase("Test") { }
+
+    void write(const uint8_t* buffer, size_t size, bool) override
+    {
+        Sent.insert(Sent.end(), buffer, buffer + size);
+    }
+
+    size_t readTimeout(uint8_t*, size_t, int) override
+    {
+        return 0;
+    }
+
+    std::vector<uint8_t> Sent;
+};
+
+TEST(TunerStudio, OutputChannelsWholeImage)
+{
+    for (size_t i = 0; i < sizeof(image); i++)
+    {
+        image[i] = i * 7;
+    }
+
+    // More than fits scratchBuffer, as TS reads it with the ini's blockingFactor
+    static_assert(LIVEDATA_SIZE > BLOCKING_FACTOR + 7, "no longer a large packet");
+
+    CaptureChannel channel;
+    TunerStudio ts;
+    ts.cmdOutputChannels(&channel, 0, LIVEDATA_SIZE);
+
+    const auto& sent = channel.Sent;
+    ASSERT_EQ(3u + LIVEDATA_SIZE + 4, sent.size());
+
+    // Length covers the response code and the data
+    EXPECT_EQ(LIVEDATA_SIZE + 1, sent[0] << 8 | sent[1]);
+    EXPECT_EQ(TS_RESPONSE_OK, sent[2]);
+    EXPECT_EQ(0, memcmp(image, &sent[3], LIVEDATA_SIZE));
+
+    uint32_t crc;
+    memcpy(&crc, &sent[3 + LIVEDATA_SIZE], sizeof(crc));
+    EXPECT_EQ(FastCrc32(&sent[2], LIVEDATA_SIZE + 1), SWAP_UINT32(crc));
+}
+
+TEST(TunerStudio, ScopePageFullRead)
+{
+    // As much of the scope page as TS asks for at once
+    size_t count = GetSensorScope().GetPageSize();
+    if (count > TS_READ_BLOCKING_FACTOR)
+    {
+        count = TS_READ_BLOCKING_FACTOR;
+    }
+
+    CaptureChannel channel;
+    TunerStudio ts;
+    ts.handleScopeReadCommand(&channel, 0, count);
+
+    const auto& sent = channel.Sent;
+    ASSERT_EQ(3 + count + 4, sent.size());
+    EXPECT_EQ(count + 1, static_cast<size_t>(sent[0] << 8 | sent[1]));
+    EXPECT_EQ(TS_RESPONSE_OK, sent[2]);
+}